@@ -0,0 +1,993 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+// Microbenchmarks for the hot kernels of the motion optimizer:
+//
+//   metric_*            banded multiply/solve with the smoothness metric
+//   collision_evaluate  CollisionFunction::evaluate over a DtGrid map
+//   collision_lod       CollisionFunction::evaluate for a robot made of
+//                       spheres, with its full and coarse body sets
+//   collision_coherence the same robot on a slowly moving trajectory,
+//                       with and without temporal coherence skipping
+//   collision_chain     ChainCollisionFunction for an arm made of spheres
+//   dtgrid_edt          the exact distance transform (via
+//                       computeDistsFromBinary, which runs it twice)
+//   dtgrid_sample       sample( v, grad ) on dense, sparse and
+//                       quantized distance fields, and sampleBatch
+//   dtgrid_layout       sample( v, grad ) with each DtGrid memory layout
+//   trajectory_upsample Trajectory::upsample
+//   constraint_evaluate ConstraintFactory::evaluate
+//
+// Each benchmark is calibrated so that a sample takes roughly
+// min_time / samples seconds, and the per-operation times of all
+// samples are reported as JSON so runs can be compared by a script.
+
+#include "MotionOptimizer.h"
+#include "containers/ChainCollisionFunction.h"
+#include "containers/DistanceFieldCollisionFunction.h"
+#include <mzcommon/DtGrid.h>
+#include <mzcommon/SparseDtGrid.h>
+#include <getopt.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using namespace mopt;
+
+//////////////////////////////////////////////////////////////////////
+// the benchmark harness
+
+// results get accumulated here so the compiler can't drop the work.
+static volatile double bench_sink = 0;
+
+class Benchmark {
+  public:
+    typedef std::vector< std::pair< std::string, double > > ParamList;
+
+    std::string name;
+    ParamList params;
+
+    Benchmark( const std::string & name ) : name( name ) {}
+    virtual ~Benchmark(){}
+
+    // allocate whatever the benchmark needs. Not timed.
+    virtual void setup(){}
+
+    // do one operation.
+    virtual void run() = 0;
+
+    // free up memory. Not timed.
+    virtual void teardown(){}
+
+    Benchmark * param( const char * key, double value ){
+        params.push_back( std::make_pair( std::string( key ), value ) );
+        return this;
+    }
+
+    std::string fullName() const {
+        std::ostringstream ostr;
+        ostr << name;
+        for ( size_t i = 0; i < params.size(); ++i ){
+            ostr << "/" << params[i].first << "=" << params[i].second;
+        }
+        return ostr.str();
+    }
+};
+
+struct BenchResult {
+    std::string name;
+    Benchmark::ParamList params;
+    size_t iterations;
+    double total_seconds;
+    double mean_ns, median_ns, min_ns, max_ns;
+};
+
+static double timeBatch( Benchmark * b, size_t batch ){
+    uint64_t start = Profiler::now();
+    for ( size_t i = 0; i < batch; ++i ){ b->run(); }
+    return double( Profiler::now() - start ) * 1e-9;
+}
+
+BenchResult measure( Benchmark * b, double min_time, int samples ){
+
+    b->setup();
+
+    // warm up, then double the batch until a sample is long enough.
+    b->run();
+    const double sample_time = min_time / samples;
+    size_t batch = 1;
+    while ( timeBatch( b, batch ) < sample_time && batch < (1u<<30) ){
+        batch *= 2;
+    }
+
+    std::vector< double > per_op( samples );
+    double total = 0;
+    for ( int i = 0; i < samples; ++i ){
+        double t = timeBatch( b, batch );
+        total += t;
+        per_op[i] = t * 1e9 / batch;
+    }
+
+    b->teardown();
+
+    BenchResult result;
+    result.name = b->name;
+    result.params = b->params;
+    result.iterations = batch * samples;
+    result.total_seconds = total;
+    result.mean_ns = total * 1e9 / result.iterations;
+
+    std::sort( per_op.begin(), per_op.end() );
+    result.min_ns = per_op.front();
+    result.max_ns = per_op.back();
+    result.median_ns = per_op[ samples / 2 ];
+
+    return result;
+}
+
+static void writeJSON( std::ostream & ostr,
+                       const std::vector< BenchResult > & results,
+                       double min_time, int samples )
+{
+    char buf[64];
+    time_t t = time( NULL );
+    strftime( buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", localtime( &t ) );
+
+    ostr << "{\n"
+         << "  \"suite\": \"chomp_bench\",\n"
+         << "  \"date\": \"" << buf << "\",\n"
+         << "  \"min_time\": " << min_time << ",\n"
+         << "  \"samples\": " << samples << ",\n"
+         << "  \"results\": [";
+
+    for ( size_t i = 0; i < results.size(); ++i ){
+        const BenchResult & r = results[i];
+        ostr << ( i ? ",\n" : "\n" )
+             << "    {\"name\": \"" << r.name << "\", \"params\": {";
+        for ( size_t j = 0; j < r.params.size(); ++j ){
+            ostr << ( j ? ", " : "" ) << "\"" << r.params[j].first
+                 << "\": " << r.params[j].second;
+        }
+        snprintf( buf, sizeof(buf), "%.1f", r.mean_ns );
+        ostr << "}, \"iterations\": " << r.iterations
+             << ", \"mean_ns\": " << buf;
+        snprintf( buf, sizeof(buf), "%.1f", r.median_ns );
+        ostr << ", \"median_ns\": " << buf;
+        snprintf( buf, sizeof(buf), "%.1f", r.min_ns );
+        ostr << ", \"min_ns\": " << buf;
+        snprintf( buf, sizeof(buf), "%.1f", r.max_ns );
+        ostr << ", \"max_ns\": " << buf << "}";
+    }
+
+    ostr << "\n  ]\n}\n";
+}
+
+//////////////////////////////////////////////////////////////////////
+// fixtures
+
+// deterministic pseudo random numbers in [0, 1), so every run
+//  benchmarks the same maps.
+class BenchRandom {
+    uint32_t state;
+  public:
+    BenchRandom( uint32_t seed ) : state( seed ) {}
+    double operator()(){
+        state = state * 1664525u + 1013904223u;
+        return ( state >> 8 ) / double( 1 << 24 );
+    }
+};
+
+// fills a unit sized grid with random boxes of occupied (-1) cells
+//  on a free (+1) background. nz == 1 gives a 2D map.
+void makeObstacleGrid( size_t nx, size_t ny, size_t nz, DtGridf & grid,
+                       size_t num_boxes = 24, uint32_t seed = 1 )
+{
+    grid.resize( nx, ny, nz, DtGridf::AXIS_Z, 1.0f / nx, vec3f(0, 0, 0) );
+
+    for ( size_t i = 0; i < grid.size(); ++i ){ grid[i] = 1; }
+
+    BenchRandom rand( seed );
+    for ( size_t b = 0; b < num_boxes; ++b ){
+        size_t n[3] = { nx, ny, nz };
+        size_t lo[3], hi[3];
+        for ( int a = 0; a < 3; ++a ){
+            lo[a] = size_t( rand() * n[a] );
+            hi[a] = std::min( n[a], lo[a] + 1 + size_t( rand() * n[a] / 6 ) );
+        }
+        if ( nz == 1 ){ lo[2] = 0; hi[2] = 1; }
+        for ( size_t z = lo[2]; z < hi[2]; ++z ){
+            for ( size_t y = lo[1]; y < hi[1]; ++y ){
+                for ( size_t x = lo[0]; x < hi[0]; ++x ){
+                    grid( x, y, z ) = -1;
+                }
+            }
+        }
+    }
+}
+
+// A point robot moving through a DtGrid, costed like the map2d demo.
+class GridCollisionFunction : public CollisionFunction {
+  private:
+    const DtGridf * grid;
+    size_t dims;
+    float eps;
+
+  public:
+    GridCollisionFunction( const DtGridf * grid, size_t dims,
+                           float eps = 0.05 ) :
+        CollisionFunction( dims, 3, 1, 0.5 ),
+        grid( grid ), dims( dims ), eps( eps )
+    {}
+
+    virtual double getCost( const MatX& q, size_t body_index,
+                            MatX& dx_dq, MatX& cgrad )
+    {
+        dx_dq.setZero( 3, dims );
+        for ( size_t i = 0; i < dims; ++i ){ dx_dq( i, i ) = 1; }
+
+        vec3f p( q(0), q(1), dims > 2 ? q(2) : 0.5 * grid->cellSize() );
+        vec3f g;
+        float d = grid->sample( p, g );
+
+        double dc;
+        const double c = DistanceFieldCollisionFunction::distanceCost( d, eps,
+                                                                      &dc );
+
+        cgrad.resize( 3, 1 );
+        cgrad << g[0]*dc, g[1]*dc, g[2]*dc;
+        return c;
+    }
+};
+
+// A disc shaped robot translating in the plane of a 2D DtGrid,
+//  modeled as a ring of small spheres. Body set 1, if registered
+//  with useBoundingSphere(), is a single sphere bounding the ring.
+class SphereCollisionFunction : public CollisionFunction {
+  private:
+    const DtGridf * grid;
+    float radius, sphere_radius;
+    float eps;
+
+  public:
+    SphereCollisionFunction( const DtGridf * grid, size_t num_spheres,
+                             float radius, float eps = 0.05 ) :
+        CollisionFunction( 2, 3, num_spheres, 0.5 ),
+        grid( grid ), radius( radius ),
+        sphere_radius( radius * M_PI / num_spheres ), eps( eps )
+    {}
+
+    void useBoundingSphere( int max_N ){ addBodySet( 1, max_N ); }
+
+    virtual double getCost( const MatX& q, size_t body_index,
+                            MatX& dx_dq, MatX& cgrad )
+    {
+        dx_dq.setZero( 3, 2 );
+        dx_dq( 0, 0 ) = dx_dq( 1, 1 ) = 1;
+
+        vec3f p( q(0), q(1), 0.5 * grid->cellSize() );
+        float r;
+        if ( getBodySet() == 0 ){
+            const float a = 2 * M_PI * body_index / getNumberOfBodies();
+            p += vec3f( cos( a ), sin( a ), 0 ) * radius;
+            r = sphere_radius;
+        } else {
+            r = radius + sphere_radius;
+        }
+
+        vec3f g;
+        float d = grid->sample( p, g ) - r;
+
+        setClearance( DistanceFieldCollisionFunction::interpolatedClearance(
+                          d, eps, 2 ) );
+
+        double dc;
+        const double c = DistanceFieldCollisionFunction::distanceCost( d, eps,
+                                                                      &dc );
+
+        cgrad.resize( 3, 1 );
+        cgrad << g[0]*dc, g[1]*dc, g[2]*dc;
+        return c;
+    }
+};
+
+// a straight line trajectory from near one corner of the unit cube
+//  to near the opposite one.
+static void makeLineTrajectory( int N, int M, Trajectory & trajectory,
+                                ObjectiveType otype=MINIMIZE_ACCELERATION )
+{
+    MatX q0( 1, M ), q1( 1, M );
+    for ( int i = 0; i < M; ++i ){
+        q0( i ) = 0.05 + 0.01*i;
+        q1( i ) = 0.95 - 0.01*i;
+    }
+    trajectory.setObjectiveType( otype );
+    trajectory.initialize( q0, q1, N );
+}
+
+//////////////////////////////////////////////////////////////////////
+// the benchmarks
+
+class MetricBench : public Benchmark {
+  public:
+    enum Op { MULTIPLY, SOLVE, LOWER_INVERSE };
+
+  private:
+    Op op;
+    int N, M;
+    ObjectiveType otype;
+    Metric metric;
+    MatX x, y;
+
+  public:
+    MetricBench( Op op, int N, int M, ObjectiveType otype ) :
+        Benchmark( op == MULTIPLY ? "metric_multiply" :
+                   op == SOLVE    ? "metric_solve" :
+                                    "metric_multiply_lower_inverse" ),
+        op( op ), N( N ), M( M ), otype( otype )
+    {
+        param( "N", N )->param( "M", M )->param( "objective", otype );
+    }
+
+    virtual void setup(){
+        metric.initialize( N, otype );
+        x = MatX::Random( N, M );
+        y.resize( N, M );
+    }
+
+    virtual void run(){
+        switch ( op ){
+          case MULTIPLY:      metric.multiply( x, y ); break;
+          case SOLVE:         metric.solve( x, y ); break;
+          case LOWER_INVERSE: metric.multiplyLowerInverse( x, y ); break;
+        }
+        bench_sink += y( N/2, 0 );
+    }
+
+    virtual void teardown(){ x.resize(0, 0); y.resize(0, 0); }
+};
+
+// CollisionFunction::evaluate for a point robot, using either the
+//  GridCollisionFunction above or the library
+//  DistanceFieldCollisionFunction, which precomputes the costs.
+class CollisionBench : public Benchmark {
+  private:
+    size_t grid_size, dims;
+    int N;
+    bool precomputed;
+    DtGridf grid;
+    CollisionFunction * collision;
+    Trajectory trajectory;
+    MatX g;
+
+  public:
+    CollisionBench( size_t grid_size, size_t dims, int N,
+                    bool precomputed = false ) :
+        Benchmark( "collision_evaluate" ),
+        grid_size( grid_size ), dims( dims ), N( N ),
+        precomputed( precomputed ), collision( NULL )
+    {
+        param( "grid", grid_size )->param( "dims", dims )->param( "N", N )
+            ->param( "field", precomputed );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( grid_size, grid_size, dims > 2 ? grid_size : 1,
+                          grid );
+        grid.computeDistsFromBinary();
+        if ( precomputed ){
+            collision = new DistanceFieldCollisionFunction( &grid, dims,
+                                                            0.5, 0.05 );
+        } else {
+            collision = new GridCollisionFunction( &grid, dims );
+        }
+        makeLineTrajectory( N, dims, trajectory );
+        g.resize( N, dims );
+    }
+
+    virtual void run(){
+        g.setZero();
+        bench_sink += collision->evaluate( trajectory, g );
+    }
+
+    virtual void teardown(){
+        delete collision;
+        collision = NULL;
+        grid.clear();
+    }
+};
+
+// CollisionFunction::evaluate for a robot made of spheres, with the
+//  full model (body set 0) or the bounding sphere the coarse levels
+//  of a multigrid solve would use (body set 1).
+class CollisionLODBench : public Benchmark {
+  private:
+    size_t num_spheres, body_set;
+    int N;
+    DtGridf grid;
+    SphereCollisionFunction * collision;
+    Trajectory trajectory;
+    MatX g;
+
+  public:
+    CollisionLODBench( size_t num_spheres, size_t body_set, int N ) :
+        Benchmark( "collision_lod" ),
+        num_spheres( num_spheres ), body_set( body_set ), N( N ),
+        collision( NULL )
+    {
+        param( "spheres", num_spheres )->param( "set", body_set )
+            ->param( "N", N );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( 256, 256, 1, grid );
+        grid.computeDistsFromBinary();
+        collision = new SphereCollisionFunction( &grid, num_spheres, 0.02 );
+        collision->useBoundingSphere( N );
+        collision->selectBodySet( body_set ? N : N+1 );
+        makeLineTrajectory( N, 2, trajectory );
+        g.resize( N, 2 );
+    }
+
+    virtual void run(){
+        g.setZero();
+        bench_sink += collision->evaluate( trajectory, g );
+    }
+
+    virtual void teardown(){
+        delete collision;
+        collision = NULL;
+        grid.clear();
+    }
+};
+
+// late in an optimization, waypoints move a little each iteration.
+//  Each run nudges the trajectory back and forth before evaluating.
+class CoherenceBench : public Benchmark {
+  private:
+    int N;
+    bool coherence;
+    DtGridf grid;
+    SphereCollisionFunction * collision;
+    Trajectory trajectory;
+    MatX g;
+    double step;
+
+  public:
+    CoherenceBench( int N, bool coherence ) :
+        Benchmark( "collision_coherence" ),
+        N( N ), coherence( coherence ), collision( NULL ), step( 1e-4 )
+    {
+        param( "spheres", 32 )->param( "N", N )
+            ->param( "coherence", coherence );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( 256, 256, 1, grid );
+        grid.computeDistsFromBinary();
+        collision = new SphereCollisionFunction( &grid, 32, 0.02 );
+        collision->setTemporalCoherence( coherence ? 1.0 : 0.0 );
+        makeLineTrajectory( N, 2, trajectory );
+        g.resize( N, 2 );
+    }
+
+    virtual void run(){
+        for ( int t = 0; t < N; ++t ){ trajectory( t, 0 ) += step; }
+        step = -step;
+        g.setZero();
+        bench_sink += collision->evaluate( trajectory, g );
+    }
+
+    virtual void teardown(){
+        delete collision;
+        collision = NULL;
+        grid.clear();
+    }
+};
+
+// an arm of revolute joints with alternating axes reaching up from
+//  the floor of a 3D map, with spheres along each link.
+class ChainBench : public Benchmark {
+  private:
+    size_t num_links, spheres_per_link;
+    int N;
+    DtGridf grid;
+    KinematicChain chain;
+    ChainCollisionFunction * collision;
+    Trajectory trajectory;
+    MatX g;
+
+  public:
+    ChainBench( size_t num_links, size_t spheres_per_link, int N ) :
+        Benchmark( "collision_chain" ),
+        num_links( num_links ), spheres_per_link( spheres_per_link ),
+        N( N ), collision( NULL )
+    {
+        param( "links", num_links )->param( "spheres", spheres_per_link )
+            ->param( "N", N );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( 64, 64, 64, grid );
+        grid.computeDistsFromBinary();
+
+        const double length = 0.5 / num_links;
+        chain = KinematicChain();
+        chain.setBase( Transform( vec3d( 0.5, 0.5, 0.1 ) ) );
+        for ( size_t i = 0; i < num_links; ++i ){
+            chain.addLink( Transform( vec3d( 0, 0, i ? length : 0 ) ),
+                           i % 2 ? vec3d( 1, 0, 0 ) : vec3d( 0, 1, 0 ) );
+            for ( size_t s = 0; s < spheres_per_link; ++s ){
+                chain.addSphere( i, vec3d( 0, 0, length*s/spheres_per_link ),
+                                 0.5 * length / spheres_per_link );
+            }
+        }
+
+        collision = new ChainCollisionFunction( &chain, &grid, 0.5, 0.05 );
+        makeLineTrajectory( N, num_links, trajectory );
+        g.resize( N, num_links );
+    }
+
+    virtual void run(){
+        g.setZero();
+        bench_sink += collision->evaluate( trajectory, g );
+    }
+
+    virtual void teardown(){
+        delete collision;
+        collision = NULL;
+        grid.clear();
+    }
+};
+
+class EDTBench : public Benchmark {
+  private:
+    size_t nx, ny, nz;
+    DtGridf binary, grid;
+
+  public:
+    EDTBench( size_t nx, size_t ny, size_t nz ) :
+        Benchmark( "dtgrid_edt" ), nx( nx ), ny( ny ), nz( nz )
+    {
+        param( "nx", nx )->param( "ny", ny )->param( "nz", nz );
+    }
+
+    virtual void setup(){ makeObstacleGrid( nx, ny, nz, binary ); }
+
+    // the copy is part of the timing, but is negligible next to
+    //  the two transforms.
+    virtual void run(){
+        grid = binary;
+        grid.computeDistsFromBinary( false );
+        bench_sink += grid.maxDist();
+    }
+
+    virtual void teardown(){ binary.clear(); grid.clear(); }
+};
+
+// samples the same random points of a 3D map stored dense (one at
+//  a time or batched), sparse with floats, or sparse and quantized
+//  to 16 or 8 bits.
+class SampleBench : public Benchmark {
+  public:
+    enum Storage { DENSE=0, DENSE_BATCH=1, 
+                   SPARSE32=32, SPARSE16=16, SPARSE8=8 };
+
+  private:
+    size_t n;
+    Storage storage;
+    float band;
+    DtGridf dense;
+    SparseDtGridf sparse32;
+    SparseDtGrid16f sparse16;
+    SparseDtGrid8f sparse8;
+    std::vector< vec3f > points, grads;
+    std::vector< float > vals;
+
+    template <class Field>
+    void samplePoints( const Field & field ){
+        float f = 0;
+        vec3f g;
+        for ( size_t i = 0; i < points.size(); ++i ){
+            f += field.sample( points[i], g ) + g[0];
+        }
+        bench_sink += f;
+    }
+
+  public:
+    SampleBench( size_t n, Storage storage, float band ) :
+        Benchmark( "dtgrid_sample" ), n( n ), storage( storage ),
+        band( band )
+    {
+        param( "n", n )->param( "storage", storage )->param( "band", band );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( n, n, n, dense );
+        dense.computeDistsFromBinary( storage <= DENSE_BATCH );
+        switch ( storage ){
+        case SPARSE32: sparse32.build( dense, band ); break;
+        case SPARSE16: sparse16.build( dense, band ); break;
+        case SPARSE8:  sparse8.build( dense, band ); break;
+        default: break;
+        }
+        if ( storage > DENSE_BATCH ){ dense.clear(); }
+
+        BenchRandom rand( 2 );
+        points.resize( 4096 );
+        for ( size_t i = 0; i < points.size(); ++i ){
+            points[i] = vec3f( rand(), rand(), rand() );
+        }
+        vals.resize( points.size() );
+        grads.resize( points.size() );
+    }
+
+    virtual void run(){
+        switch ( storage ){
+        case DENSE:    samplePoints( dense ); break;
+        case DENSE_BATCH:
+            dense.sampleBatch( &points[0], points.size(),
+                               &vals[0], &grads[0] );
+            bench_sink += vals.back() + grads.back()[0];
+            break;
+        case SPARSE32: samplePoints( sparse32 ); break;
+        case SPARSE16: samplePoints( sparse16 ); break;
+        case SPARSE8:  samplePoints( sparse8 ); break;
+        }
+    }
+
+    virtual void teardown(){
+        dense.clear();
+        sparse32.clear();
+        sparse16.clear();
+        sparse8.clear();
+        points.clear();
+        grads.clear();
+        vals.clear();
+    }
+};
+
+// samples a 3D map in each memory layout, either at scattered random
+//  points or along random straight trajectories of 64 ticks.
+class LayoutBench : public Benchmark {
+  private:
+    size_t n;
+    DtGridf::Layout layout;
+    bool trajectories;
+    DtGridf grid;
+    std::vector< vec3f > points;
+
+  public:
+    LayoutBench( size_t n, DtGridf::Layout layout, bool trajectories ) :
+        Benchmark( "dtgrid_layout" ), n( n ), layout( layout ),
+        trajectories( trajectories )
+    {
+        param( "n", n )->param( "layout", layout )
+            ->param( "trajectories", trajectories );
+    }
+
+    virtual void setup(){
+        makeObstacleGrid( n, n, n, grid );
+        grid.computeDistsFromBinary( true );
+        grid.setLayout( layout );
+
+        BenchRandom rand( 3 );
+        const size_t ticks = trajectories ? 64 : 1;
+        while ( points.size() < 8192 ){
+            vec3f p0( rand(), rand(), rand() );
+            vec3f p1( rand(), rand(), rand() );
+            for ( size_t t = 0; t < ticks; ++t ){
+                points.push_back( p0 + ( p1 - p0 ) * ( float( t ) / ticks ) );
+            }
+        }
+    }
+
+    virtual void run(){
+        float f = 0;
+        vec3f g;
+        for ( size_t i = 0; i < points.size(); ++i ){
+            f += grid.sample( points[i], g ) + g[0];
+        }
+        bench_sink += f;
+    }
+
+    virtual void teardown(){ grid.clear(); points.clear(); }
+};
+
+class UpsampleBench : public Benchmark {
+  private:
+    int N, M;
+    Trajectory base, trajectory;
+
+  public:
+    UpsampleBench( int N, int M ) :
+        Benchmark( "trajectory_upsample" ), N( N ), M( M )
+    {
+        param( "N", N )->param( "M", M );
+    }
+
+    virtual void setup(){ makeLineTrajectory( N, M, base ); }
+
+    virtual void run(){
+        trajectory = base;
+        trajectory.upsample();
+        bench_sink += trajectory( trajectory.N()/2, 0 );
+    }
+};
+
+class ConstraintBench : public Benchmark {
+  private:
+    int N, M;
+    ConstraintFactory * factory;
+    std::vector< Constraint * > constraints;
+    Trajectory trajectory;
+    MatX h, H;
+
+  public:
+    ConstraintBench( int N, int M ) :
+        Benchmark( "constraint_evaluate" ), N( N ), M( M ), factory( NULL )
+    {
+        param( "N", N )->param( "M", M );
+    }
+
+    virtual void setup(){
+        makeLineTrajectory( N, M, trajectory );
+
+        // pin the first half of the dofs over the middle of the
+        //  trajectory.
+        std::vector< size_t > index;
+        std::vector< double > value;
+        for ( int i = 0; i < std::max( 1, M/2 ); ++i ){
+            index.push_back( i );
+            value.push_back( 0.5 );
+        }
+
+        factory = new ConstraintFactory();
+        constraints.push_back( new ConstantConstraint( index, value ) );
+        factory->addConstraint( constraints.back(), 0.25, 0.75 );
+        factory->getAll( N );
+
+        h.resize( factory->numOutput(), 1 );
+        H.resize( N*M, factory->numOutput() );
+    }
+
+    virtual void run(){
+        bench_sink += factory->evaluate( trajectory, h, H );
+    }
+
+    virtual void teardown(){
+        delete factory;
+        factory = NULL;
+        for ( size_t i = 0; i < constraints.size(); ++i ){
+            delete constraints[i];
+        }
+        constraints.clear();
+        h.resize( 0, 0 );
+        H.resize( 0, 0 );
+    }
+};
+
+//////////////////////////////////////////////////////////////////////
+
+void makeBenchmarks( std::vector< Benchmark * > & benchmarks, bool quick )
+{
+    const int Ns[] = { 31, 127, 511, 2047 };
+    const int Ms[] = { 2, 7 };
+    const int num_N = quick ? 2 : 4;
+
+    for ( int o = 0; o < 3; ++o ){
+        for ( int n = 0; n < num_N; ++n ){
+            for ( int m = 0; m < 2; ++m ){
+                for ( int t = 0; t < 2; ++t ){
+                    benchmarks.push_back(
+                        new MetricBench( MetricBench::Op( o ), Ns[n], Ms[m],
+                                         ObjectiveType( t ) ) );
+                }
+            }
+        }
+    }
+
+    for ( int n = 0; n < num_N; ++n ){
+        benchmarks.push_back( new CollisionBench( 256, 2, Ns[n] ) );
+        benchmarks.push_back( new CollisionBench( 64, 3, Ns[n] ) );
+        benchmarks.push_back( new CollisionBench( 256, 2, Ns[n], true ) );
+        benchmarks.push_back( new CollisionBench( 64, 3, Ns[n], true ) );
+    }
+
+    for ( int n = 0; n < num_N; ++n ){
+        for ( int set = 0; set < 2; ++set ){
+            benchmarks.push_back( new CollisionLODBench( 32, set, Ns[n] ) );
+        }
+        for ( int c = 0; c < 2; ++c ){
+            benchmarks.push_back( new CoherenceBench( Ns[n], c ) );
+        }
+    }
+
+    for ( int n = 0; n < std::min( num_N, 3 ); ++n ){
+        benchmarks.push_back( new ChainBench( 7, 4, Ns[n] ) );
+    }
+
+    benchmarks.push_back( new EDTBench( 256, 256, 1 ) );
+    benchmarks.push_back( new EDTBench( 1024, 1024, 1 ) );
+    benchmarks.push_back( new EDTBench( 32, 32, 32 ) );
+    benchmarks.push_back( new EDTBench( 64, 64, 64 ) );
+    if ( !quick ){
+        benchmarks.push_back( new EDTBench( 128, 128, 128 ) );
+        benchmarks.push_back( new EDTBench( 256, 256, 256 ) );
+    }
+
+    const SampleBench::Storage storages[] = {
+        SampleBench::DENSE, SampleBench::DENSE_BATCH, 
+        SampleBench::SPARSE32, SampleBench::SPARSE16, SampleBench::SPARSE8
+    };
+    for ( int s = 0; s < 5; ++s ){
+        benchmarks.push_back( new SampleBench( 64, storages[s], 0.1f ) );
+        if ( !quick ){
+            benchmarks.push_back( new SampleBench( 192, storages[s], 0.05f ) );
+        }
+    }
+
+    const DtGridf::Layout layouts[] = {
+        DtGridf::LAYOUT_LINEAR, DtGridf::LAYOUT_BRICKED, DtGridf::LAYOUT_MORTON
+    };
+    for ( int l = 0; l < 3; ++l ){
+        for ( int t = 0; t < 2; ++t ){
+            benchmarks.push_back( new LayoutBench( quick ? 96 : 256,
+                                                   layouts[l], t ) );
+        }
+    }
+
+    for ( int n = 0; n < num_N; ++n ){
+        benchmarks.push_back( new UpsampleBench( Ns[n], 2 ) );
+        benchmarks.push_back( new UpsampleBench( Ns[n], 7 ) );
+    }
+
+    // the constraint jacobian is dense, so keep N moderate.
+    for ( int n = 0; n < std::min( num_N, 3 ); ++n ){
+        benchmarks.push_back( new ConstraintBench( Ns[n], 7 ) );
+    }
+}
+
+void usage(int status) {
+  std::ostream& ostr = status ? std::cerr : std::cout;
+  ostr <<
+    "usage: chomp_bench OPTIONS\n"
+    "\n"
+    "OPTIONS:\n"
+    "\n"
+    "  -f, --filter             Only run benchmarks whose name contains this\n"
+    "  -t, --min-time           Seconds to spend on each benchmark\n"
+    "  -s, --samples            Number of timing samples per benchmark\n"
+    "  -o, --output             Write JSON here instead of stdout\n"
+    "  -q, --quick              Skip the largest problem sizes\n"
+    "  -l, --list               List the benchmarks and exit\n"
+    "  -j, --threads            Threads for distance transforms (0 = all)\n"
+    "      --help               See this message.\n";
+  exit(status);
+}
+
+int main(int argc, char** argv) {
+
+  const struct option long_options[] = {
+    { "filter",            required_argument, 0, 'f' },
+    { "min-time",          required_argument, 0, 't' },
+    { "samples",           required_argument, 0, 's' },
+    { "output",            required_argument, 0, 'o' },
+    { "quick",             no_argument,       0, 'q' },
+    { "list",              no_argument,       0, 'l' },
+    { "threads",           required_argument, 0, 'j' },
+    { "help",              no_argument,       0, 'h' },
+    { 0,                   0,                 0,  0  }
+  };
+
+  const char* short_options = "f:t:s:o:qlj:h";
+  int opt, option_index;
+
+  std::string filter, output;
+  double min_time = 0.2;
+  int samples = 5;
+  bool quick = false, list = false;
+
+  while ( (opt = getopt_long(argc, argv, short_options,
+                             long_options, &option_index) ) != -1 ) {
+
+    switch (opt) {
+    case 'f':
+      filter = optarg;
+      break;
+    case 't':
+      min_time = atof(optarg);
+      break;
+    case 's':
+      samples = std::max( 1, atoi(optarg) );
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'q':
+      quick = true;
+      break;
+    case 'l':
+      list = true;
+      break;
+    case 'j':
+      DtGridf::setNumThreads( atoi(optarg) );
+      break;
+    case 'h':
+      usage(0);
+      break;
+    default:
+      usage(1);
+      break;
+    }
+  }
+
+  std::vector< Benchmark * > benchmarks;
+  makeBenchmarks( benchmarks, quick );
+
+  std::vector< BenchResult > results;
+
+  for ( size_t i = 0; i < benchmarks.size(); ++i ){
+    Benchmark * b = benchmarks[i];
+    const std::string name = b->fullName();
+
+    if ( filter.empty() || name.find( filter ) != std::string::npos ){
+      if ( list ){
+        std::cout << name << "\n";
+      } else {
+        results.push_back( measure( b, min_time, samples ) );
+        std::cerr << name << ": " << results.back().median_ns << " ns\n";
+      }
+    }
+    delete b;
+  }
+
+  if ( list ){ return 0; }
+
+  if ( output.empty() ){
+    writeJSON( std::cout, results, min_time, samples );
+  } else {
+    std::ofstream ostr( output.c_str() );
+    if ( !ostr ){
+      std::cerr << "couldn't open " << output << " for writing\n";
+      return 1;
+    }
+    writeJSON( ostr, results, min_time, samples );
+  }
+
+  return 0;
+}
@@ -172,6 +172,7 @@ public:
 
 void Map2D::load(const char* filename) {
 
+  pyramid.clear();
   grid.clear();
   eps = 1;
 
@@ -249,6 +250,7 @@ void Map2D::load(const char* filename) {
   }
 
   grid.computeDistsFromBinary();
+  pyramid.build(grid, 4);
 
   /*
   quickPNG("foo.png", &(grid(0,0,0)),
@@ -312,6 +314,48 @@ float Map2D::sampleCost(const vec3f& p, vec3f& grad) const {
 
 }
 
+float Map2D::sampleCost(const vec3f& p, vec3f& grad, size_t level,
+                        float* dist) const {
+
+  float d = pyramid.level(level).sample(p, grad);
+  float g;
+
+  if (dist) { *dist = d; }
+
+  float c = distToCost(d, g);
+
+  grad *= g;
+  return c;
+
+}
+
+float Map2D::segmentCost(const vec3f& p0, const vec3f& p1,
+                         vec3f& pmax, vec3f& grad, size_t level) const {
+
+  const DtGridf& g = level ? pyramid.level(level) : grid;
+
+  // lineMin finds the cell nearest to collision, then sample where
+  // the segment passes that cell so that the cost changes smoothly
+  // with the endpoints.
+  vec3f cmin, cgrad;
+  g.lineMin(p0, p1, cmin, cgrad);
+
+  const vec3f d01 = p1 - p0;
+  const float l2 = vec3f::dot(d01, d01);
+  float s = l2 > 0 ? vec3f::dot(cmin - p0, d01) / l2 : 0;
+  s = std::max(0.0f, std::min(1.0f, s));
+  pmax = p0 + d01 * s;
+
+  float d = g.sample(pmax, grad);
+  float dc;
+
+  float c = distToCost(d, dc);
+
+  grad *= dc;
+  return c;
+
+}
+
 void Map2D::rasterize(RasterType type,
                       std::vector<unsigned char>& map,
                       size_t stride) const {
@@ -34,11 +34,13 @@
 #ifndef _MAP2D_H_
 #define _MAP2D_H_
 
-#include <mzcommon/DtGrid.h>
+#include <mzcommon/DtGridPyramid.h>
 
 class Map2D {
 public:
 
+  Map2D() {}
+
   enum RasterType {
     RASTER_OCCUPANCY = 0,
     RASTER_DISTANCE = 1,
@@ -50,6 +52,16 @@ public:
   float sampleCost(const vec3f& p) const;
   float sampleCost(const vec3f& p, vec3f& grad) const;
 
+  // samples the given level of the pyramid instead of the grid, 
+  // and stores the distance there in dist if it is given
+  float sampleCost(const vec3f& p, vec3f& grad, size_t level,
+                   float* dist=0) const;
+
+  // the largest cost along the segment from p0 to p1 (on the given
+  // pyramid level), found at pmax on the segment
+  float segmentCost(const vec3f& p0, const vec3f& p1,
+                    vec3f& pmax, vec3f& grad, size_t level=0) const;
+
   float distToCost(float d) const;
   float distToCost(float d, float& g) const;
 
@@ -58,8 +70,15 @@ public:
                  size_t stride=0) const;
 
   DtGridf grid;
+  DtGridPyramidf pyramid;
   float eps;
 
+private:
+
+  // the pyramid points at grid, so copies are not allowed
+  Map2D(const Map2D&);
+  Map2D& operator=(const Map2D&);
+
 };
 
 #endif
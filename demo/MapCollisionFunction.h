@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MAP_COLLISION_FUNCTION_H_
+#define _MAP_COLLISION_FUNCTION_H_
+
+#include "Map2D.h"
+#include "MotionOptimizer.h"
+
+//////////////////////////////////////////////////////////////////////
+// function to help evaluate collisons for gradients
+//  of a point robot moving through a Map2D. The map is only read,
+//  so one map may be shared by several optimizers.
+
+class MapCollisionFunction : public mopt::CollisionFunction {
+
+  private:
+    const Map2D * map;
+
+    // sample the map's pyramid at the level matching the
+    //  trajectory's resolution instead of the full grid.
+    bool use_pyramid;
+    size_t level;
+
+  public:
+    MapCollisionFunction( size_t cspace_dofs,
+                          size_t workspace_dofs, 
+                          size_t n_bodies,
+                          double gamma,
+                          const Map2D * map ) :
+        CollisionFunction(cspace_dofs, workspace_dofs, n_bodies, gamma ),
+        map( map ),
+        use_pyramid( false ),
+        level( 0 )
+    {}
+
+    void setUsePyramid( bool use ){ use_pyramid = use; level = 0; }
+
+    // picks the coarsest level whose cells are no larger than the
+    //  smallest step between consecutive waypoints.
+    virtual void prepareRun( const mopt::Trajectory & trajectory )
+    {
+        level = 0;
+        if ( !use_pyramid ){ return; }
+
+        double spacing = DtGridf::DT_INF;
+        for ( int t = 0; t <= trajectory.N(); ++t ){
+            const mopt::MatX d = trajectory.getTick( t ) - 
+                                 trajectory.getTick( t-1 );
+            spacing = std::min( spacing, d.norm() );
+        }
+        if ( spacing == DtGridf::DT_INF ){ return; }
+
+        level = map->pyramid.levelForSpacing( spacing );
+    }
+
+    virtual double getCost(const mopt::MatX& q, size_t body_index,
+                           mopt::MatX& dx_dq, mopt::MatX& cgrad ) 
+    {
+        assert( (q.rows() == 2 && q.cols() == 1) ||
+                (q.rows() == 1 && q.cols() == 2) );
+
+        dx_dq.resize(3, 2);
+        dx_dq.setZero();
+
+        dx_dq << 1, 0, 0, 1, 0, 0;
+
+        cgrad.resize(3, 1);
+
+        vec3f g;
+        float d;
+        
+        float c = map->sampleCost(vec3f(q(0), q(1), 0.0), g, level, &d);
+
+        cgrad << g[0], g[1], 0.0;
+
+        // the cost is zero until the distance drops below eps. The
+        //  bilinear interpolation of the grid can change by up to
+        //  sqrt(2) per unit moved, hence the division.
+        setClearance( (d - map->eps) / M_SQRT2 );
+
+        return c;
+    }
+
+    virtual double getSegmentCost(const mopt::MatX& qa, 
+                                  const mopt::MatX& qb,
+                                  size_t body_index, double& s,
+                                  mopt::MatX& dx_dq, mopt::MatX& cgrad )
+    {
+        dx_dq.resize(3, 2);
+        dx_dq << 1, 0, 0, 1, 0, 0;
+
+        cgrad.resize(3, 1);
+
+        const vec3f pa(qa(0), qa(1), 0.0), pb(qb(0), qb(1), 0.0);
+        vec3f pmax, g;
+
+        float c = map->segmentCost(pa, pb, pmax, g, level);
+
+        cgrad << g[0], g[1], 0.0;
+
+        // where along the segment pmax lies
+        const vec3f d = pb - pa;
+        const float l2 = vec3f::dot(d, d);
+        s = l2 > 0 ? vec3f::dot(pmax - pa, d) / l2 : 0;
+        s = std::max(0.0, std::min(1.0, s));
+
+        return c;
+    }
+};
+
+#endif
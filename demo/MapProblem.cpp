@@ -0,0 +1,327 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "MapProblem.h"
+#include <mzcommon/strutils.h>
+#include <fstream>
+
+using namespace mopt;
+
+//////////////////////////////////////////////////////////////////////
+// attribute helpers
+
+static bool boolAttribute(const TinyDomElement* e, 
+                          const std::string& key, 
+                          bool defaultValue) {
+
+  if (!e->haveAttribute(key)) { return defaultValue; }
+
+  std::string sval = lower(e->attribute(key));
+
+  if (sval == "true" || sval == "1") { 
+    return true;
+  } else if (sval == "false" || sval == "0") {
+    return false;
+  } 
+
+  throw std::runtime_error("error parsing boolean attribute: " + key);
+
+}
+
+static vec2f vec2Attribute(const TinyDomElement* e, 
+                           const std::string& key, 
+                           const vec2f& defaultValue) {
+
+  if (!e->haveAttribute(key)) { return defaultValue; }
+
+  std::istringstream istr(e->attribute(key));
+  float x, y;
+
+  if (!(istr >> x >> y) || !(istr >> std::ws).eof()) {
+    throw std::runtime_error("error parsing vector attribute: " + key);
+  }
+
+  return vec2f(x, y);
+
+}
+
+static vec2f pointElement(const TinyDomElement* e, const vec2f& p) {
+  return vec2f(e->attributeValue("x", p.x()), 
+               e->attributeValue("y", p.y()));
+}
+
+static OptimizationAlgorithm algorithmAttribute(const TinyDomElement* e, 
+                                                const std::string& key,
+                                                OptimizationAlgorithm a) {
+
+  if (!e->haveAttribute(key)) { return a; }
+
+  const std::string& sval = e->attribute(key);
+  OptimizationAlgorithm rval = algorithmFromString(sval);
+
+  if (rval == NONE && lower(sval) != "none") {
+    throw std::runtime_error("unknown algorithm: " + sval);
+  }
+  
+  return rval;
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+MapProblem::MapProblem():
+  have_endpoints(false),
+  p0(0, 0), p1(0, 0),
+  N(127), N_max(0),
+  subsample(false),
+  bounds(false),
+  lower(0, 0), upper(0, 0),
+  algorithm1(CHOMP), algorithm2(NONE),
+  otype(MINIMIZE_VELOCITY),
+  alpha(0.02), gamma(0.5),
+  covariant(false),
+  collision_constraint(false),
+  max_iter(500),
+  error_tol(1e-6),
+  timeout(0)
+{}
+
+void MapProblem::parse(const TinyDomElement* element, 
+                       const std::string& dir) {
+
+  name = element->attribute("name", name);
+
+  if (element->haveAttribute("map")) {
+    map = combineDir(dir, element->attribute("map"));
+  }
+
+  const TinyDomElement::ChildList& children = element->children();
+
+  for (TinyDomElement::ChildList::const_iterator i=children.begin();
+       i!=children.end(); ++i) {
+
+    if ((*i)->type() != TinyDomNode::TypeElement) { continue; }
+
+    const TinyDomElement* e = (const TinyDomElement*)(*i);
+    const std::string& tag = e->name();
+
+    if (tag == "start") {
+
+      p0 = pointElement(e, p0);
+      have_endpoints = true;
+
+    } else if (tag == "goal") {
+
+      p1 = pointElement(e, p1);
+      have_endpoints = true;
+
+    } else if (tag == "resolution") {
+
+      N = e->attributeValue("N", N);
+      N_max = e->attributeValue("N_max", N_max);
+      subsample = boolAttribute(e, "subsample", subsample);
+
+    } else if (tag == "bounds") {
+
+      bounds = boolAttribute(e, "enabled", true);
+      lower = vec2Attribute(e, "lower", lower);
+      upper = vec2Attribute(e, "upper", upper);
+
+    } else if (tag == "constraint") {
+
+      MapProblemConstraint c;
+      c.start = e->attributeValue("start", 0.0);
+      c.stop = e->attributeValue("stop", 1.0);
+
+      if (c.start < 0 || c.stop >= 1 || c.start > c.stop) {
+        throw std::runtime_error("constraint interval must lie in [0, 1)");
+      }
+
+      const TinyDomElement::ChildList& dofs = e->children();
+      for (TinyDomElement::ChildList::const_iterator j=dofs.begin();
+           j!=dofs.end(); ++j) {
+        if ((*j)->type() != TinyDomNode::TypeElement) { continue; }
+        const TinyDomElement* d = (const TinyDomElement*)(*j);
+        if (d->name() != "dof") { 
+          throw std::runtime_error("unexpected element in constraint: " +
+                                   d->name());
+        }
+        c.index.push_back(d->attributeValue("index", size_t(0)));
+        c.value.push_back(d->attributeValue("value", 0.0));
+      }
+
+      if (c.index.empty()) {
+        throw std::runtime_error("constraint without any dof");
+      }
+
+      constraints.push_back(c);
+
+    } else if (tag == "algorithm") {
+
+      algorithm1 = algorithmAttribute(e, "first", algorithm1);
+      algorithm2 = algorithmAttribute(e, "second", algorithm2);
+
+      if (e->haveAttribute("objective")) {
+        std::string sval = ::lower(e->attribute("objective"));
+        if (sval == "vel") { 
+          otype = MINIMIZE_VELOCITY;
+        } else if (sval == "accel") {
+          otype = MINIMIZE_ACCELERATION;
+        } else {
+          throw std::runtime_error("unknown objective: " + sval);
+        }
+      }
+
+      alpha = e->attributeValue("alpha", alpha);
+      gamma = e->attributeValue("gamma", gamma);
+      covariant = boolAttribute(e, "covariant", covariant);
+      collision_constraint = boolAttribute(e, "collision_constraint",
+                                           collision_constraint);
+
+    } else if (tag == "termination") {
+
+      max_iter = e->attributeValue("max_iter", max_iter);
+      error_tol = e->attributeValue("error_tol", error_tol);
+      timeout = e->attributeValue("timeout", timeout);
+
+    } else {
+
+      throw std::runtime_error("unexpected element: " + tag);
+
+    }
+
+  }
+
+}
+
+void MapProblem::setup(MotionOptimizer& chomper,
+                       const Map2D& m,
+                       std::vector<Constraint*>& owned) const {
+
+  vec2f q0v = p0, q1v = p1;
+  if (!have_endpoints) {
+    q0v = m.grid.bbox().p0.trunc();
+    q1v = m.grid.bbox().p1.trunc();
+  }
+
+  MatX q0(1, 2), q1(1, 2);
+  q0 << q0v.x(), q0v.y();
+  q1 << q1v.x(), q1v.y();
+
+  chomper.getTrajectory().setObjectiveType(otype);
+  chomper.getTrajectory().initialize(q0, q1, N);
+
+  chomper.setNMax(N_max);
+  chomper.setSubsample(subsample);
+  chomper.setAlgorithm(algorithm1, algorithm2);
+  chomper.setAlpha(alpha);
+  chomper.setCovariantOptimization(covariant);
+  chomper.setCollisionConstraint(collision_constraint);
+
+  chomper.setMaxIterations(max_iter);
+  chomper.setFunctionTolerance(error_tol);
+  chomper.setTimeoutSeconds(timeout);
+
+  if (bounds) {
+    MatX l(1, 2), u(1, 2);
+    l << lower.x(), lower.y();
+    u << upper.x(), upper.y();
+    chomper.setBounds(l, u);
+  }
+
+  for (size_t i=0; i<constraints.size(); ++i) {
+    const MapProblemConstraint& c = constraints[i];
+    owned.push_back(new ConstantConstraint(c.index, c.value));
+    chomper.addConstraint(owned.back(), c.start, c.stop);
+  }
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void loadMapProblems(const std::string& filename,
+                     std::vector<MapProblem>& problems) {
+
+  std::ifstream istr(filename.c_str());
+  if (!istr.is_open()) {
+    throw std::runtime_error("error opening " + filename);
+  }
+
+  TinyDomElement* root = TinyDom::parse(istr);
+  const std::string dir = directoryOf(filename);
+
+  try {
+
+    if (!root || root->name() != "problems") {
+      throw std::runtime_error("expected <problems> in " + filename);
+    }
+
+    MapProblem defaults;
+
+    const TinyDomElement::ChildList& children = root->children();
+
+    for (TinyDomElement::ChildList::const_iterator i=children.begin();
+         i!=children.end(); ++i) {
+
+      if ((*i)->type() != TinyDomNode::TypeElement) { continue; }
+
+      const TinyDomElement* e = (const TinyDomElement*)(*i);
+
+      if (e->name() == "defaults") {
+        defaults.parse(e, dir);
+      } else if (e->name() == "problem") {
+        problems.push_back(defaults);
+        problems.back().parse(e, dir);
+        if (problems.back().name.empty()) {
+          std::ostringstream ostr;
+          ostr << "problem" << problems.size();
+          problems.back().name = ostr.str();
+        }
+        if (problems.back().map.empty()) {
+          throw std::runtime_error("problem without a map: " + 
+                                   problems.back().name);
+        }
+      } else {
+        throw std::runtime_error("unexpected element: " + e->name());
+      }
+
+    }
+
+  } catch (...) {
+    delete root;
+    throw;
+  }
+
+  delete root;
+
+}
@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MAP_PROBLEM_H_
+#define _MAP_PROBLEM_H_
+
+#include "Map2D.h"
+#include "MotionOptimizer.h"
+#include <mzcommon/TinyDom.h>
+
+// A pinned set of dofs over a fraction [start, stop] of the
+//  trajectory, turned into a ConstantConstraint.
+struct MapProblemConstraint {
+  double start, stop;
+  std::vector<size_t> index;
+  std::vector<double> value;
+};
+
+// A planning problem on a Map2D, as read from an XML problem file:
+//
+//   <problems>
+//     <defaults> ...settings shared by every problem... </defaults>
+//     <problem name="map3_a" map="../maps/map3.txt">
+//       <start x="2.7" y="-2.7"/>
+//       <goal x="-2.7" y="2.7"/>
+//       <resolution N="127" N_max="0" subsample="false"/>
+//       <bounds lower="-3 -3" upper="3 3"/>
+//       <constraint start="0.25" stop="0.75">
+//         <dof index="0" value="0"/>
+//       </constraint>
+//       <algorithm first="CHOMP" second="NONE" objective="vel"
+//                  alpha="0.02" gamma="0.5" covariant="false"
+//                  collision_constraint="false"/>
+//       <termination max_iter="200" error_tol="1e-6" timeout="0"/>
+//     </problem>
+//   </problems>
+//
+// Every element and attribute is optional; a problem starts out as
+// a copy of the defaults. Map paths are relative to the problem file.
+// Without start and goal, the corners of the map are used.
+
+class MapProblem {
+public:
+
+  MapProblem();
+
+  std::string name;
+  std::string map;
+
+  bool have_endpoints;
+  vec2f p0, p1;
+
+  int N, N_max;
+  bool subsample;
+
+  bool bounds;
+  vec2f lower, upper;
+
+  std::vector<MapProblemConstraint> constraints;
+
+  mopt::OptimizationAlgorithm algorithm1, algorithm2;
+  mopt::ObjectiveType otype;
+  double alpha, gamma;
+  bool covariant;
+  bool collision_constraint;
+
+  size_t max_iter;
+  double error_tol;
+  double timeout;
+
+  // overrides the settings given in element, relative paths are
+  //  taken relative to dir. Throws std::runtime_error on bad input.
+  void parse(const TinyDomElement* element, const std::string& dir);
+
+  // sets up the trajectory and settings of chomper. The collision
+  //  function and observer are left to the caller. Constraints that
+  //  get created are appended to owned, for the caller to delete.
+  void setup(mopt::MotionOptimizer& chomper,
+             const Map2D& map,
+             std::vector<mopt::Constraint*>& owned) const;
+
+};
+
+// reads every problem in filename. Throws std::runtime_error on
+//  bad input.
+void loadMapProblems(const std::string& filename,
+                     std::vector<MapProblem>& problems);
+
+#endif
@@ -74,7 +74,6 @@ class CircleConstraint : public Constraint {
 
 };
 
-
 #ifdef MZ_HAVE_CAIRO
 
 class PdfEmitter: public DebugObserver {
@@ -89,8 +88,6 @@ class PdfEmitter: public DebugObserver {
 
     const char* filename;
 
-    std::ostringstream ostream;
-
     bool dump_data_to_file;
   
 
@@ -106,7 +103,6 @@ class PdfEmitter: public DebugObserver {
         surface = cairo_pdf_surface_create(filename, sz+2*m, sz+2*m);
 
         cr = cairo_create(surface);
-        ostream << f << "{";
     }
   
 
@@ -118,18 +114,6 @@ class PdfEmitter: public DebugObserver {
         std::cout << "wrote " << filename << "\n\n";
     }
 
-    void appendInfoToFile( const std::string & filename )
-    {
-        if (filename.size() > 0){
-            std::ofstream myfile;
-            myfile.open (filename.c_str(), std::ios::app );
-            
-            myfile << ostream.str() << "}\n";
-
-            myfile.close();
-        }
-    }
-
     virtual int notify( const OptimizerBase & chomper, 
                         EventType event,
                         size_t iter,
@@ -137,13 +121,8 @@ class PdfEmitter: public DebugObserver {
                         double lastObjective,
                         double hmag) 
     {
-        if ( dump_data_to_file ){
-            ostream << "[" << chomper.problem.getTimesString()
-                    << ", iter:" << iter 
-                    << ", constraint:" << hmag
-                    << ", objective:" << curObjective
-                    <<  "], ";
-        }else {
+        //the data to dump is recorded by the telemetry sink.
+        if ( !dump_data_to_file ){
             DebugObserver::notify(chomper, event, iter, 
                                    curObjective, lastObjective, hmag);
 
@@ -346,19 +325,22 @@ int main(int argc, char** argv) {
     
     chomper.setAlgorithm( alg ); 
     
+    char pdf_name[1024];
+
+    snprintf(pdf_name, 1024, "circle_%s_%04d_%04d_%f_%s_%s.pdf",
+             algorithmToString( alg ).c_str(),
+             N, Nmax, alpha,
+             objective == MINIMIZE_VELOCITY ? "vel" : "accel",
+             do_covariant ? "covariant" : "non-covariant" );
+
+    TelemetrySink telemetry( 1 << 16 );
+    if ( dump_data ){ chomper.setTelemetry( &telemetry ); }
+
 #ifdef MZ_HAVE_CAIRO
     PdfEmitter* pobs = NULL;
 
     if (doPDF >= -1 ) {
 
-        char pdf_name[1024];
-
-        snprintf(pdf_name, 1024, "circle_%s_%04d_%04d_%f_%s_%s.pdf",
-                 algorithmToString( alg ).c_str(),
-                 N, Nmax, alpha,
-                 objective == MINIMIZE_VELOCITY ? "vel" : "accel",
-                 do_covariant ? "covariant" : "non-covariant" );
-
         pobs = new PdfEmitter(pdf_name, dump_data);
 
         pobs->frequency = doPDF;
@@ -368,12 +350,10 @@ int main(int argc, char** argv) {
 
     chomper.solve();
   
+    if ( dump_data ){ appendTelemetryToFile( filename, pdf_name, telemetry ); }
     
 #ifdef MZ_HAVE_CAIRO
-    if ( pobs ){
-        pobs->appendInfoToFile( filename );
-        delete pobs;
-    }
+    if ( pobs ){ delete pobs; }
 #endif
 
   return 0;
@@ -0,0 +1,562 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+// Runs a grid of optimizer settings over one or more maps, in
+// parallel, inside a single process. Each map and its distance
+// transform is loaded once and shared read-only by every run, which
+// replaces launching map2d_demo once per setting from map2d_eval.sh.
+//
+// Problems come from map arguments and from problem files (see
+// MapProblem.h). The list options expand each problem into every
+// combination of the given settings. Results go to stdout (or
+// --output) as JSON, one object per run.
+
+#include "Map2D.h"
+#include "MapCollisionFunction.h"
+#include "MapProblem.h"
+#include "MotionOptimizer.h"
+#include <mzcommon/strutils.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace mopt;
+
+//////////////////////////////////////////////////////////////////////
+// one point in the parameter grid, and what became of it.
+
+struct BenchRun {
+
+    // the settings
+    MapProblem problem;
+    size_t map_index;
+
+    // the results
+    double seconds;
+    size_t iterations;
+    double final_objective;
+    double clearance;
+    bool collision_free;
+    StopReason stop_reason;
+
+    BenchRun() :
+        map_index( 0 ),
+        seconds( 0 ),
+        iterations( 0 ),
+        final_objective( 0 ),
+        clearance( 0 ),
+        collision_free( false ),
+        stop_reason( STOP_NONE )
+    {}
+};
+
+struct BenchJobs {
+    const std::vector< Map2D * > * maps;
+    std::vector< BenchRun > * runs;
+    bool pyramid;
+    bool swept;
+    bool coherence;
+    size_t next;
+    size_t done;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// the smallest signed distance along the piecewise linear path
+//  through the waypoints, including the fixed endpoints.
+double pathClearance( const Map2D & map, const Trajectory & trajectory )
+{
+    double clearance = DtGridf::DT_INF;
+    vec3f vmin, gmin;
+
+    vec3f prev( trajectory.getTick( -1 )(0), trajectory.getTick( -1 )(1), 0 );
+    for ( int t = 0; t <= trajectory.N(); ++t ){
+        const MatX q = trajectory.getTick( t );
+
+        // a diverged trajectory is never collision free.
+        if ( !std::isfinite( q(0) ) || !std::isfinite( q(1) ) ){
+            return -DtGridf::DT_INF;
+        }
+
+        const vec3f cur( q(0), q(1), 0 );
+        clearance = std::min( clearance,
+                              double( map.grid.lineMin( prev, cur,
+                                                        vmin, gmin ) ) );
+        prev = cur;
+    }
+
+    return clearance;
+}
+
+void runOne( const Map2D & map, BenchRun & run,
+             bool pyramid, bool swept, bool coherence )
+{
+    MotionOptimizer chomper;
+    std::vector< Constraint * > constraints;
+    run.problem.setup( chomper, map, constraints );
+
+    MapCollisionFunction collision( 2, 3, 1, run.problem.gamma, &map );
+    collision.setUsePyramid( pyramid );
+    collision.setSwept( swept );
+    collision.setTemporalCoherence( coherence ? 1.0 : 0.0 );
+    chomper.setCollisionFunction( &collision );
+
+    const SolveStats & stats = chomper.solve();
+
+    run.seconds = stats.seconds;
+    run.iterations = stats.totalIterations();
+    run.final_objective = ( stats.stages.empty() ? 0.0 :
+                            stats.stages.back().final_objective );
+    run.stop_reason = stats.stopReason();
+    run.clearance = pathClearance( map, chomper.getTrajectory() );
+    run.collision_free = run.clearance > 0;
+
+    for ( size_t i = 0; i < constraints.size(); ++i ){
+        delete constraints[i];
+    }
+}
+
+void * worker( void * data )
+{
+    BenchJobs * jobs = static_cast< BenchJobs * >( data );
+
+    while ( true ){
+        size_t i = __atomic_fetch_add( &jobs->next, 1, __ATOMIC_RELAXED );
+        if ( i >= jobs->runs->size() ){ break; }
+
+        BenchRun & run = (*jobs->runs)[i];
+        runOne( *(*jobs->maps)[ run.map_index ], run,
+                jobs->pyramid, jobs->swept, jobs->coherence );
+
+        size_t done = __atomic_add_fetch( &jobs->done, 1, __ATOMIC_RELAXED );
+        fprintf( stderr, "\r%zu / %zu runs", done, jobs->runs->size() );
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// JSON has no inf or nan, so those are written as null.
+std::string jsonNumber( double value, const char * format )
+{
+    if ( !std::isfinite( value ) ){ return "null"; }
+    char buf[64];
+    snprintf( buf, sizeof(buf), format, value );
+    return buf;
+}
+
+void writeJSON( std::ostream & ostr, const std::vector< BenchRun > & runs )
+{
+    ostr << "{\n  \"runs\": [";
+    for ( size_t i = 0; i < runs.size(); ++i ){
+        const BenchRun & r = runs[i];
+        const MapProblem & p = r.problem;
+        ostr << ( i ? ",\n" : "\n" )
+             << "    {\"problem\": \"" << p.name << "\""
+             << ", \"map\": \"" << p.map << "\""
+             << ", \"N\": " << p.N
+             << ", \"algorithm\": \"" << algorithmToString( p.algorithm1 )
+             << "\""
+             << ", \"algorithm2\": \"" << algorithmToString( p.algorithm2 )
+             << "\""
+             << ", \"gamma\": " << p.gamma
+             << ", \"alpha\": " << p.alpha
+             << ", \"objective\": \""
+             << ( p.otype == MINIMIZE_VELOCITY ? "vel" : "accel" ) << "\""
+             << ", \"covariant\": " << ( p.covariant ? "true" : "false" )
+             << ", \"seconds\": " << jsonNumber( r.seconds, "%.6f" )
+             << ", \"iterations\": " << r.iterations
+             << ", \"final_objective\": "
+             << jsonNumber( r.final_objective, "%.10g" )
+             << ", \"clearance\": " << jsonNumber( r.clearance, "%.6g" )
+             << ", \"collision_free\": "
+             << ( r.collision_free ? "true" : "false" )
+             << ", \"stop_reason\": \"" << stopReasonToString( r.stop_reason )
+             << "\"}";
+    }
+    ostr << "\n  ]\n}\n";
+}
+
+// splits a comma separated list.
+std::vector< std::string > splitList( const char * str )
+{
+    std::vector< std::string > items;
+    std::istringstream istr( str );
+    std::string item;
+    while ( std::getline( istr, item, ',' ) ){
+        if ( !item.empty() ){ items.push_back( item ); }
+    }
+    return items;
+}
+
+std::vector< double > splitDoubles( const char * str )
+{
+    std::vector< std::string > items = splitList( str );
+    std::vector< double > values;
+    for ( size_t i = 0; i < items.size(); ++i ){
+        values.push_back( atof( items[i].c_str() ) );
+    }
+    return values;
+}
+
+
+// every combination of the given settings, applied to base. An empty
+//  list keeps the setting of base.
+void expandProblem( const MapProblem & base, size_t map_index,
+                    const std::vector< OptimizationAlgorithm > & algorithms,
+                    const std::vector< double > & gammas,
+                    const std::vector< double > & alphas,
+                    const std::vector< ObjectiveType > & otypes,
+                    const std::vector< bool > & covariants,
+                    std::vector< BenchRun > & runs )
+{
+    std::vector< OptimizationAlgorithm > l( algorithms );
+    std::vector< double > g( gammas ), a( alphas );
+    std::vector< ObjectiveType > o( otypes );
+    std::vector< bool > k( covariants );
+
+    if ( l.empty() ){ l.push_back( base.algorithm1 ); }
+    if ( g.empty() ){ g.push_back( base.gamma ); }
+    if ( a.empty() ){ a.push_back( base.alpha ); }
+    if ( o.empty() ){ o.push_back( base.otype ); }
+    if ( k.empty() ){ k.push_back( base.covariant ); }
+
+    for ( size_t il = 0; il < l.size(); ++il ){
+      for ( size_t ig = 0; ig < g.size(); ++ig ){
+        for ( size_t ia = 0; ia < a.size(); ++ia ){
+          for ( size_t io = 0; io < o.size(); ++io ){
+            for ( size_t ik = 0; ik < k.size(); ++ik ){
+              BenchRun run;
+              run.problem = base;
+              run.problem.algorithm1 = l[il];
+              run.problem.gamma = g[ig];
+              run.problem.alpha = a[ia];
+              run.problem.otype = o[io];
+              run.problem.covariant = k[ik];
+              run.map_index = map_index;
+              runs.push_back( run );
+            }
+          }
+        }
+      }
+    }
+}
+
+void usage(int status) {
+  std::ostream& ostr = status ? std::cerr : std::cout;
+  ostr <<
+    "usage: map2d_bench OPTIONS [map.txt ...]\n"
+    "\n"
+    "Runs every problem given by -P and every map on the command\n"
+    "line. List options are comma separated, and every combination\n"
+    "of the given lists is run for each problem. The other options\n"
+    "override the settings of every problem.\n"
+    "\n"
+    "OPTIONS:\n"
+    "\n"
+    "  -P, --problems           Problem file to run (may be repeated)\n"
+    "  -l, --algorithms         List of algorithms\n"
+    "  -g, --gammas             List of collision step sizes\n"
+    "  -a, --alphas             List of overall step sizes\n"
+    "  -o, --objectives         List of quantities to minimize (vel,accel)\n"
+    "  -k, --covariance         List of covariant settings (0,1)\n"
+    "  -c, --coords             Set start, goal (x0,y0,x1,y1)\n"
+    "  -n, --num                Number of steps for trajectory\n"
+    "  -m, --max-iter           Set maximum iterations\n"
+    "  -e, --error-tol          Relative error tolerance\n"
+    "  -T, --timeout            Per run timeout in seconds\n"
+    "  -b, --bounds             Bound the trajectory to the map\n"
+    "  -s, --subsample          Do multigrid subsampling\n"
+    "  -p, --pyramid            Use coarser maps for coarser trajectories\n"
+    "  -w, --swept              Check the segments between waypoints\n"
+    "  -C, --coherence          Skip waypoints that stay far from obstacles\n"
+    "  -j, --threads            Number of worker threads\n"
+    "  -O, --output             Write JSON here instead of stdout\n"
+    "      --help               See this message.\n";
+  exit(status);
+}
+
+int main(int argc, char** argv) {
+
+  const struct option long_options[] = {
+    { "problems",          required_argument, 0, 'P' },
+    { "algorithms",        required_argument, 0, 'l' },
+    { "gammas",            required_argument, 0, 'g' },
+    { "alphas",            required_argument, 0, 'a' },
+    { "objectives",        required_argument, 0, 'o' },
+    { "covariance",        required_argument, 0, 'k' },
+    { "coords",            required_argument, 0, 'c' },
+    { "num",               required_argument, 0, 'n' },
+    { "max-iter",          required_argument, 0, 'm' },
+    { "error-tol",         required_argument, 0, 'e' },
+    { "timeout",           required_argument, 0, 'T' },
+    { "threads",           required_argument, 0, 'j' },
+    { "output",            required_argument, 0, 'O' },
+    { "bounds",            no_argument,       0, 'b' },
+    { "subsample",         no_argument,       0, 's' },
+    { "pyramid",           no_argument,       0, 'p' },
+    { "swept",             no_argument,       0, 'w' },
+    { "coherence",         no_argument,       0, 'C' },
+    { "help",              no_argument,       0, 'h' },
+    { 0,                   0,                 0,  0  }
+  };
+
+  const char* short_options = "P:l:g:a:o:k:c:n:m:e:T:j:O:bspwCh";
+  int opt, option_index;
+
+  std::vector< MapProblem > problems;
+
+  std::vector< OptimizationAlgorithm > algorithms;
+  std::vector< double > gammas, alphas;
+  std::vector< ObjectiveType > otypes;
+  std::vector< bool > covariants;
+
+  // overrides, applied when they are >= 0
+  int N = -1, bounds = -1, subsample = -1;
+  long max_iter = -1;
+  double error_tol = -1, timeout = -1;
+  std::vector< float > coords;
+
+  bool pyramid = false, swept = false, coherence = false;
+
+  long num_threads = sysconf( _SC_NPROCESSORS_ONLN );
+  std::string output;
+
+  while ( (opt = getopt_long(argc, argv, short_options, 
+                             long_options, &option_index) ) != -1 ) {
+
+    std::vector< std::string > items;
+
+    switch (opt) {
+    case 'P':
+      try {
+        loadMapProblems( optarg, problems );
+      } catch ( std::exception & e ) {
+        std::cerr << "error loading " << optarg << ": " << e.what() << "\n";
+        exit(1);
+      }
+      break;
+    case 'l':
+      items = splitList( optarg );
+      for ( size_t i = 0; i < items.size(); ++i ){
+        OptimizationAlgorithm alg = algorithmFromString( items[i] );
+        if ( alg == NONE ){
+          std::cerr << "unknown algorithm: " << items[i] << "\n\n";
+          usage(1);
+        }
+        algorithms.push_back( alg );
+      }
+      break;
+    case 'g':
+      gammas = splitDoubles( optarg );
+      break;
+    case 'a':
+      alphas = splitDoubles( optarg );
+      break;
+    case 'o':
+      items = splitList( optarg );
+      for ( size_t i = 0; i < items.size(); ++i ){
+        if (!strcasecmp(items[i].c_str(), "vel")) {
+          otypes.push_back( MINIMIZE_VELOCITY );
+        } else if (!strcasecmp(items[i].c_str(), "accel")) {
+          otypes.push_back( MINIMIZE_ACCELERATION );
+        } else {
+          std::cerr << "error parsing opt. type: " << items[i] << "\n\n";
+          usage(1);
+        }
+      }
+      break;
+    case 'k':
+      items = splitList( optarg );
+      for ( size_t i = 0; i < items.size(); ++i ){
+        covariants.push_back( atoi( items[i].c_str() ) != 0 );
+      }
+      break;
+    case 'c':
+      coords.resize( 4 );
+      if (sscanf(optarg, "%f,%f,%f,%f",
+                 &coords[0], &coords[1], &coords[2], &coords[3]) != 4) {
+        std::cerr << "error parsing coords!\n\n";
+        usage(1);
+      } 
+      break;
+    case 'n':
+      N = atoi(optarg);
+      break;
+    case 'm':
+      max_iter = atol(optarg);
+      break;
+    case 'e':
+      error_tol = atof(optarg);
+      break;
+    case 'T':
+      timeout = atof(optarg);
+      break;
+    case 'j':
+      num_threads = atoi(optarg);
+      break;
+    case 'O':
+      output = optarg;
+      break;
+    case 'b':
+      bounds = 1;
+      break;
+    case 's':
+      subsample = 1;
+      break;
+    case 'p':
+      pyramid = true;
+      break;
+    case 'w':
+      swept = true;
+      break;
+    case 'C':
+      coherence = true;
+      break;
+    case 'h':
+      usage(0);
+      break;
+    default:
+      usage(1);
+      break;
+    }
+
+  }
+
+  for ( int i = optind; i < argc; ++i ){
+    problems.push_back( MapProblem() );
+    problems.back().map = argv[i];
+    problems.back().name = filenameOf( argv[i] );
+  }
+
+  if ( problems.empty() ) {
+    usage(1);
+  }
+
+  // load every map and its distance transform once.
+  std::vector< Map2D * > maps;
+  std::map< std::string, size_t > map_lookup;
+
+  std::vector< BenchRun > runs;
+
+  for ( size_t i = 0; i < problems.size(); ++i ){
+
+    MapProblem & p = problems[i];
+
+    if ( !map_lookup.count( p.map ) ){
+      map_lookup[ p.map ] = maps.size();
+      maps.push_back( new Map2D() );
+      maps.back()->load( p.map.c_str() );
+    }
+    const size_t map_index = map_lookup[ p.map ];
+    const Map2D & map = *maps[ map_index ];
+
+    if ( N >= 0 ){ p.N = N; }
+    if ( max_iter >= 0 ){ p.max_iter = max_iter; }
+    if ( error_tol >= 0 ){ p.error_tol = error_tol; }
+    if ( timeout >= 0 ){ p.timeout = timeout; }
+    if ( subsample >= 0 ){ p.subsample = subsample; }
+    if ( bounds >= 0 ){
+      p.bounds = true;
+      p.lower = map.grid.bbox().p0.trunc();
+      p.upper = map.grid.bbox().p1.trunc();
+    }
+    if ( !coords.empty() ){
+      p.p0 = vec2f( coords[0], coords[1] );
+      p.p1 = vec2f( coords[2], coords[3] );
+      p.have_endpoints = true;
+    }
+
+    expandProblem( p, map_index, algorithms, gammas, alphas, otypes,
+                   covariants, runs );
+  }
+
+  BenchJobs jobs;
+  jobs.maps = &maps;
+  jobs.runs = &runs;
+  jobs.pyramid = pyramid;
+  jobs.swept = swept;
+  jobs.coherence = coherence;
+  jobs.next = 0;
+  jobs.done = 0;
+
+  num_threads = std::max( 1L, std::min( num_threads, long( runs.size() ) ) );
+
+  const uint64_t start = Profiler::now();
+
+  // workers take runs until none are left, so fewer threads than
+  // asked for still finish every run; with none, run them here.
+  std::vector< pthread_t > threads;
+  for ( long i = 0; i < num_threads; ++i ){
+    pthread_t thread;
+    if ( pthread_create( &thread, NULL, worker, &jobs ) != 0 ){
+      fprintf( stderr, "couldn't start thread %ld, using %zu\n",
+               i, threads.size() );
+      break;
+    }
+    threads.push_back( thread );
+  }
+  if ( threads.empty() ){ worker( &jobs ); }
+  for ( size_t i = 0; i < threads.size(); ++i ){
+    pthread_join( threads[i], NULL );
+  }
+  num_threads = std::max( size_t( 1 ), threads.size() );
+
+  fprintf( stderr, "\n%zu runs on %ld threads in %.3f seconds\n",
+           runs.size(), num_threads, ( Profiler::now() - start ) * 1e-9 );
+
+  if ( output.empty() ){
+    writeJSON( std::cout, runs );
+  } else {
+    std::ofstream ostr( output.c_str() );
+    if ( !ostr ){
+      std::cerr << "couldn't open " << output << " for writing\n";
+      return 1;
+    }
+    writeJSON( ostr, runs );
+  }
+
+  for ( size_t i = 0; i < maps.size(); ++i ){ delete maps[i]; }
+
+  return 0;
+
+}
@@ -32,6 +32,8 @@
 */
 
 #include "Map2D.h"
+#include "MapCollisionFunction.h"
+#include "MapProblem.h"
 #include <png.h>
 #include <getopt.h>
 #include "MotionOptimizer.h"
@@ -131,78 +133,19 @@ bool savePNG_RGB24(const std::string& filename,
 
 }
 
-//////////////////////////////////////////////////////////////////////
-// function to help evaluate collisons for gradients
-
-class MapCollisionFunction : public CollisionFunction {
-
-  private:
-    Map2D * map;
-
-  public:
-    MapCollisionFunction( size_t cspace_dofs,
-                          size_t workspace_dofs, 
-                          size_t n_bodies,
-                          double gamma,
-                          Map2D * map ) :
-        CollisionFunction(cspace_dofs, workspace_dofs, n_bodies, gamma ),
-        map( map )
-    {}
-
-    virtual double getCost(const MatX& q, size_t body_index,
-                           MatX& dx_dq, MatX& cgrad ) 
-    {
-        assert( (q.rows() == 2 && q.cols() == 1) ||
-                (q.rows() == 1 && q.cols() == 2) );
-
-        dx_dq.resize(3, 2);
-        dx_dq.setZero();
-
-        dx_dq << 1, 0, 0, 1, 0, 0;
-
-        cgrad.resize(3, 1);
-
-        vec3f g;
-        
-        float c = map->sampleCost(vec3f(q(0), q(1), 0.0), g);
-
-        cgrad << g[0], g[1], 0.0;
-
-        return c;
-    }
-};
-
-//////////////////////////////////////////////////////////////////////
-// help generate an an initial trajectory
-
-void generateInitialTraj(MotionOptimizer & chomper,
-                         int N, 
-                         const vec2f& p0, 
-                         const vec2f& p1,
-                         MatX& q0,
-                         MatX& q1) {
-  
-    q0.resize(1, 2);
-    q1.resize(1, 2);
-
-    q0 << p0.x(), p0.y();
-    q1 << p1.x(), p1.y();
-
-    chomper.getTrajectory().initialize( q0, q1, N );
-  
-}
-
-
 //////////////////////////////////////////////////////////////////////
 // helper class to visualize stuff
 
 #ifdef MZ_HAVE_CAIRO
 
-class PdfEmitter: public DebugObserver {
+// Runs on the background thread of an AsyncObserver, so drawing and
+// writing the PDF do not stall the optimizer.
+class PdfEmitter: public SnapshotObserver {
 public:
 
   const Map2D& map;
   const MatX xi_init;
+  const MatX q0, q1;
   
   int dump_every;
   int count;
@@ -217,17 +160,15 @@ public:
 
   std::vector<unsigned char> mapbuf;
 
-  std::ostringstream ostream;
   bool dump_data_to_file;
   
-  PdfEmitter(const Map2D& m, const MatX& x, int de,
+  PdfEmitter(const Map2D& m, const Trajectory& t, int de,
              const char* f, bool dump):
-    map(m), xi_init(x), dump_every(de), count(0), filename(f),
+    map(m), xi_init(t.getXi()), q0(t.getQ0()), q1(t.getQ1()),
+    dump_every(de), count(0), filename(f),
     dump_data_to_file( dump ) 
   {
       
-    ostream << filename << " {";
-    
     Box3f bbox = map.grid.bbox();
     vec3f dims = bbox.p1 - bbox.p0;
 
@@ -258,33 +199,17 @@ public:
 
   }
 
-  void appendInfoToFile( const std::string & filename )
-  {
-      if (dump_data_to_file && filename.size() > 0 ){
-          std::ofstream myfile;
-          myfile.open (filename.c_str(), std::ios::app );
-          myfile  << ostream.str() << "}\n";
-
-          myfile.close();
-      }
-  }
-
-  virtual int notify(const OptimizerBase& chomper, 
-                     EventType event,
-                     size_t iter,
-                     double curObjective,
-                     double lastObjective,
-                     double hmag)
+  virtual int notify(const ObserverSnapshot& snapshot)
   {
     
-    if ( dump_data_to_file ){
-        ostream << "[" << chomper.problem.getTimesString()
-                << ", iter:" << iter 
-                << ", objective:" << curObjective
-                <<  "], ";
-    }else {
-        DebugObserver::notify(chomper, event, iter, 
-                                   curObjective, lastObjective, hmag);
+    const EventType event = snapshot.event;
+    const size_t iter = snapshot.iteration;
+
+    //the data to dump is recorded by the telemetry sink.
+    if ( !dump_data_to_file ){
+        DebugObserver::print(event, iter, snapshot.current_objective,
+                             snapshot.last_objective,
+                             snapshot.constraint_magnitude);
     }
     
     if ( dump_every < 0 ) { return 0; }
@@ -317,8 +242,8 @@ public:
     cairo_set_line_width(cr, 1.0*cs);
     cairo_set_source_rgb(cr, 0.0, 0.1, 0.5);
 
-    const Trajectory & trajectory = chomper.problem.getTrajectory();
-    int N = trajectory.N();
+    ConstMatMap trajectory = snapshot.getTrajectory();
+    int N = snapshot.N;
 
     for (int i=0; i<N; ++i) {
       vec3f pi(xi_init(i,0), xi_init(i,1), 0.0);
@@ -326,9 +251,6 @@ public:
       cairo_fill(cr);
     }
 
-    const MatX& q0 = trajectory.getQ0();
-    const MatX& q1 = trajectory.getQ1();
-
     cairo_set_source_rgb(cr, 0.5, 0.0, 1.0);
     cairo_arc(cr, q0(0), q0(1), 4*cs, 0.0, 2*M_PI);
     cairo_fill(cr);
@@ -359,7 +281,7 @@ public:
 void usage(int status) {
   std::ostream& ostr = status ? std::cerr : std::cout;
   ostr <<
-    "usage: map2d_demo OPTIONS map.txt\n"
+    "usage: map2d_demo OPTIONS [map.txt]\n"
     "Also, checkout the map2d_tests.sh script!\n"
     "\n"
     "OPTIONS:\n"
@@ -375,9 +297,14 @@ void usage(int status) {
     "  -p, --pdf                Output PDF's\n"
     "  -k, --covariance         Do covariant optimization\n"
     "  -d, --dump               Dump recorded data to a given filename\n"
+    "  -T, --profile            Print the time spent in each phase\n"
+    "  -s, --stats              Print the statistics of each stage\n"
     "  -o, --objective          Quantity to minimize (vel|accel)\n"
     "  -b, --bounds             Bound the trajectory to the given area\n"
     "  -C, --coll_constraint    Treat collisions as a constraint\n"
+    "  -P, --problem            Load settings from a problem file\n"
+    "                           (file.xml or file.xml:name). Options\n"
+    "                           after it override the file.\n"
     "      --help               See this message.\n";
   exit(status);
 }
@@ -395,68 +322,70 @@ int main(int argc, char** argv) {
     { "objective",         required_argument, 0, 'o' },
     { "pdf",               required_argument, 0, 'p' },
     { "dump",              required_argument, 0, 'd' },
+    { "profile",           no_argument,       0, 'T' },
+    { "stats",             no_argument,       0, 's' },
     { "covariance",        no_argument,       0, 'k' },
     { "coll_constriant",   no_argument,       0, 'C' },
     { "help",              no_argument,       0, 'h' },
     { "bounds",            no_argument,       0, 'b' },
+    { "problem",           required_argument, 0, 'P' },
     { 0,                   0,                 0,  0  }
   };
 
-  const char* short_options = "l:c:n:a:g:e:m:o:p:d:kChb";
+  const char* short_options = "l:c:n:a:g:e:m:o:p:d:TskChbP:";
   int opt, option_index;
 
-  bool do_covariant = false;
-  int N = 127;
-  double gamma = 0.5;
-  double alpha = 0.02;
-  double errorTol = 1e-6;
-  size_t max_iter = 500;
-  ObjectiveType otype = MINIMIZE_VELOCITY;
-  OptimizationAlgorithm alg = NONE;
-  float x0=0, y0=0, x1=0, y1=0;
+  // the command line options edit this problem.
+  MapProblem problem;
+  problem.algorithm1 = NONE;
   int doPDF = -2;
-  bool doBounds = false;
-  bool collision_constraint = false;
 
   std::string filename;
-  bool dump_data;
+  bool dump_data = false;
+  bool print_profile = false;
+  bool print_stats = false;
 
   while ( (opt = getopt_long(argc, argv, short_options, 
                              long_options, &option_index) ) != -1 ) {
 
     switch (opt) {
     case 'l':
-      alg = algorithmFromString( optarg );
+      problem.algorithm1 = algorithmFromString( optarg );
       break;
     case 'k':
-      do_covariant = true;
+      problem.covariant = true;
       break;
-    case 'c': 
+    case 'c': {
+      float x0=0, y0=0, x1=0, y1=0;
       if (sscanf(optarg, "%f,%f,%f,%f", &x0, &y0, &x1, &y1) != 4) {
         std::cerr << "error parsing coords!\n\n";
         usage(1);
       } 
+      problem.p0 = vec2f(x0, y0);
+      problem.p1 = vec2f(x1, y1);
+      problem.have_endpoints = !(x0 == y0 && problem.p0 == problem.p1);
       break;
+    }
     case 'n':
-      N = atoi(optarg);
+      problem.N = atoi(optarg);
       break;
     case 'a': 
-      alpha = atof(optarg);
+      problem.alpha = atof(optarg);
       break;
     case 'g':
-      gamma = atof(optarg);
+      problem.gamma = atof(optarg);
       break;
     case 'e':
-      errorTol = atof(optarg);
+      problem.error_tol = atof(optarg);
       break;
     case 'm':
-      max_iter = atoi(optarg);
+      problem.max_iter = atoi(optarg);
       break;
     case 'o':
       if (!strcasecmp(optarg, "vel")) {
-        otype = MINIMIZE_VELOCITY;
+        problem.otype = MINIMIZE_VELOCITY;
       } else if (!strcasecmp(optarg, "accel")) {
-        otype = MINIMIZE_ACCELERATION;
+        problem.otype = MINIMIZE_ACCELERATION;
       } else {
         std::cerr << "error parsing opt. type: " << optarg << "\n\n";
         usage(1);
@@ -469,15 +398,47 @@ int main(int argc, char** argv) {
       usage(0);
       break;
     case 'b':
-      doBounds = true;
+      problem.bounds = true;
+      problem.lower = vec2f(-3, -3);
+      problem.upper = vec2f(3, 3);
       break;
     case 'C':
-      collision_constraint = true;
+      problem.collision_constraint = true;
+      break;
+    case 'P': {
+      std::string pfile = optarg, pname;
+      size_t colon = pfile.rfind(':');
+      if (colon != std::string::npos) {
+        pname = pfile.substr(colon+1);
+        pfile = pfile.substr(0, colon);
+      }
+      std::vector<MapProblem> problems;
+      try {
+        loadMapProblems(pfile, problems);
+      } catch (std::exception& e) {
+        std::cerr << "error loading " << pfile << ": " << e.what() << "\n";
+        exit(1);
+      }
+      size_t i = 0;
+      while (i < problems.size() && !pname.empty() && 
+             problems[i].name != pname) { ++i; }
+      if (i == problems.size()) {
+        std::cerr << "no problem named " << pname << " in " << pfile << "\n";
+        exit(1);
+      }
+      problem = problems[i];
       break;
+    }
     case 'd': 
         filename = std::string( optarg );
         dump_data = true;
         break;
+    case 'T':
+      print_profile = true;
+      break;
+    case 's':
+      print_stats = true;
+      break;
     default:
       std::cout << "opt: " << opt << "\n";
       usage(1);
@@ -486,13 +447,17 @@ int main(int argc, char** argv) {
 
   }
 
-  if (argc < 2) {
+  if (optind < argc) {
+    problem.map = argv[optind];
+  }
+
+  if (problem.map.empty()) {
     usage(1);
   }
 
   Map2D map;
 
-  map.load(argv[argc-1]);
+  map.load(problem.map.c_str());
 
   std::vector<unsigned char> buf;
 
@@ -508,84 +473,65 @@ int main(int argc, char** argv) {
   savePNG_RGB24("occupancy.png", map.grid.nx(), map.grid.ny(), 
                 map.grid.nx()*4, &buf[0], true);
 
-  MatX q0, q1;
-
-  vec2f p0(x0, y0), p1(x1, y1);
-  if (p0.x() == p0.y() && p0 == p1) {
-    p0 = map.grid.bbox().p0.trunc();
-    p1 = map.grid.bbox().p1.trunc();
-  }
-  
-  MotionOptimizer chomper( NULL, errorTol, 0, max_iter );
-  generateInitialTraj(chomper, N, p0, p1, q0, q1);
-  
-  chomper.getTrajectory().setObjectiveType( otype );
+  MotionOptimizer chomper;
+  std::vector<Constraint*> constraints;
+  problem.setup( chomper, map, constraints );
   
   MapCollisionFunction map_collision_function(
                              2,
                              3,
                              1,
-                             gamma,
+                             problem.gamma,
                              &map );
 
   chomper.setCollisionFunction( &map_collision_function);
 
   DebugObserver dobs;
   chomper.setObserver( &dobs );
- 
-  chomper.setAlpha( alpha );
-  
-  chomper.setAlgorithm( alg ); 
 
-  if ( collision_constraint ){
-      chomper.doCollisionConstraint(); 
-  }
-  
-  if ( doBounds ){
-      MatX upper(1,2), lower(1,2);
-      upper << 3,3;
-      lower << -3,-3;
-      chomper.setBounds( lower, upper );
-  }
-  
-  if (do_covariant ){ chomper.doCovariantOptimization(); }
+  char run_name[1024];
+  sprintf(run_name, "%s_g%f_a%f_o%s_%s_%s_.pdf",
+          algorithmToString( problem.algorithm1 ).c_str(),
+          problem.gamma, problem.alpha,
+          problem.otype == MINIMIZE_VELOCITY ? "vel" : "accel",
+          problem.covariant ? "covariant" : "non-covariant",
+          problem.collision_constraint ? "constr_coll" : "obj_coll" );
 
+  TelemetrySink telemetry( 1 << 16 );
+  if ( dump_data ){ chomper.setTelemetry( &telemetry ); }
 
 #ifdef MZ_HAVE_CAIRO
   PdfEmitter* pe = NULL;
+  AsyncObserver* async = NULL;
 
   if ( doPDF >= -1 )
   {
-    char buf[1024];
-    sprintf(buf, "%s_g%f_a%f_o%s_%s_%s_.pdf",
-            algorithmToString( alg ).c_str(),
-            gamma, alpha,
-            otype == MINIMIZE_VELOCITY ? "vel" : "accel",
-            do_covariant ? "covariant" : "non-covariant",
-            collision_constraint ? "constr_coll" : "obj_coll" );
-
     pe = new PdfEmitter(map,
-                        chomper.getTrajectory().getXi(),
+                        chomper.getTrajectory(),
                         doPDF,
-                        buf,
+                        run_name,
                         dump_data);
-    chomper.setObserver( pe );
+    async = new AsyncObserver( pe );
+    chomper.setObserver( async );
   }
 
 #endif
-  
-  chomper.dontSubsample();
 
-  chomper.solve();
+  const SolveStats & stats = chomper.solve();
 
+  if ( print_stats ){ stats.print(); }
+  if ( print_profile ){ chomper.printProfile(); }
+
+  if ( dump_data ){ appendTelemetryToFile( filename, run_name, telemetry ); }
 
 #ifdef MZ_HAVE_CAIRO
-  if ( pe ) {
-      pe->appendInfoToFile( filename );
-      delete pe;
-  }
+  //delivers the pages that are still queued before the emitter goes
+  if ( async ) { delete async; }
+  if ( pe ) { delete pe; }
 #endif
 
+  for ( size_t i = 0; i < constraints.size(); ++i ){ delete constraints[i]; }
+
   return 0;
 
 }
@@ -33,6 +33,8 @@
 
 #include "MotionOptimizer.h"
 
+#include <sstream>
+
 namespace mopt {
 
 
@@ -49,6 +51,7 @@ MotionOptimizer::MotionOptimizer(Observer * observer,
                                  OptimizationAlgorithm alg2,
                                  int N_max) :
     observer( observer ),
+    telemetry( NULL ),
     N_max( N_max ),
     full_global_at_final( false ),
     do_subsample( true ),
@@ -61,16 +64,26 @@ MotionOptimizer::MotionOptimizer(Observer * observer,
 {
 }
 
-void MotionOptimizer::solve()
+const SolveStats & MotionOptimizer::solve()
 {
     
     debug_status( TAG, "solve", "start");
     
     N_min = problem.N();
 
+    //start the profile over, each level of upsampling is accounted
+    //  for separately.
+    int level = 0;
+    problem.profiler.reset();
+    problem.profiler.setLevel( level );
+
+    stats.clear();
+
+    //a cancel of the previous solve should not stop this one.
+    if ( observer ){ observer->resetCancel(); }
 
     //optimize at the current resolution
-    optimize( getOptimizer(algorithm1) );
+    optimize( algorithm1 );
 
     //if the current resolution is not the final resolution,
     //  upsample and then optimize. Repeat until the final resolution
@@ -80,54 +93,101 @@ void MotionOptimizer::solve()
         //upsample the trajectory and prepare for the next
         //  stage of optimization.
         problem.upsample();
+        problem.profiler.setLevel( ++level );
         
         //if we are subsampling, optimize at the current
         //  resolution with subsamling,
         //  then optimize without subsampling.
         if (do_subsample ){
-            optimize( getOptimizer( algorithm1 ), true );
+            optimize( algorithm1, true );
 
             OptimizationAlgorithm alg = (algorithm2 == NONE ?
                                          algorithm1 :
                                          algorithm2);
-            optimize( getOptimizer( alg ) );
+            optimize( alg );
             
         //if we are not subsampling, optimize without subsampling
         }else  {
-            optimize( getOptimizer( algorithm1 ));
+            optimize( algorithm1 );
         }
             
     }
 
     //If full_global_at_final
     if ( full_global_at_final && do_subsample && N_min < problem.N()){
-        optimize( getOptimizer( algorithm1 ));
+        optimize( algorithm1 );
     }
     
+    stats.seconds = problem.profiler.getWallSeconds();
+
     debug_status( TAG, "solve", "end");
+
+    return stats;
+}
+
+const SolveStats & MotionOptimizer::getSolveStats() const
+{
+    return stats;
 }
 
 
 
-void MotionOptimizer::optimize( OptimizerBase * optimizer, 
+void MotionOptimizer::optimize( OptimizationAlgorithm algorithm, 
                                 bool subsample )
 {
     
+    //getOptimizer may substitute another algorithm.
+    OptimizerBase * optimizer = getOptimizer( algorithm );
+
     //if the optimizer is NULL, do not evaluate it.
     if ( !optimizer ) { return; }
 
+    optimizer->telemetry = telemetry;
+
     debug_status( TAG, "optimize", "start");
     
     //prepare the problem to be run at the current resolution
     problem.prepareRun( subsample );
     
+    //the evaluation counts of the stage are the difference of the
+    //  profiler counts before and after it.
+    const Profiler & profiler = problem.profiler;
+    StageStats stage;
+    stage.level = profiler.getLevel();
+    stage.N = problem.N();
+    stage.subsampled = subsample;
+    stage.algorithm = algorithmToString( algorithm );
+    stage.objective_evaluations = profiler.getCount( PROFILE_OBJECTIVE );
+    stage.collision_evaluations = profiler.getCount( PROFILE_COLLISION );
+    stage.constraint_evaluations = profiler.getCount( PROFILE_CONSTRAINT );
+    stage.metric_solves = profiler.getCount( PROFILE_METRIC_SOLVE );
+    const uint64_t start_time = Profiler::now();
+
     //do not optimize if the observer throws an error.
     //TODO either throw error or say what exactly happened
     if ( !optimizer->notify( INIT ) ){
         optimizer->solve();
     } else {
         debug << "Observer threw error on INIT, stopping optimization\n";
+        optimizer->stop_reason = STOP_OBSERVER;
     }
+
+    stage.seconds = ( Profiler::now() - start_time ) * 1e-9;
+    stage.iterations = optimizer->current_iteration;
+    stage.objective_evaluations = profiler.getCount( PROFILE_OBJECTIVE )
+                                - stage.objective_evaluations;
+    stage.collision_evaluations = profiler.getCount( PROFILE_COLLISION )
+                                - stage.collision_evaluations;
+    stage.constraint_evaluations = profiler.getCount( PROFILE_CONSTRAINT )
+                                 - stage.constraint_evaluations;
+    stage.metric_solves = profiler.getCount( PROFILE_METRIC_SOLVE )
+                        - stage.metric_solves;
+    stage.final_objective = optimizer->current_objective;
+    stage.constraint_magnitude = ( problem.isConstrained() ?
+                                   optimizer->constraint_magnitude : 0.0 );
+    stage.stop_reason = optimizer->stop_reason;
+    stage.stop_message = optimizer->stop_message;
+    stats.stages.push_back( stage );
     
     //the run is over, so tell the problem to clean up stuff
     //  pertaning to the previous run.
@@ -144,7 +204,7 @@ void MotionOptimizer::optimize( OptimizerBase * optimizer,
 
 }
 
-OptimizerBase * MotionOptimizer::getOptimizer(OptimizationAlgorithm alg )
+OptimizerBase * MotionOptimizer::getOptimizer(OptimizationAlgorithm & alg )
 {
     //create the optimizer
 
@@ -215,6 +275,42 @@ OptimizerBase * MotionOptimizer::getOptimizer(OptimizationAlgorithm alg )
     return NULL;
 }
 
+const Profiler & MotionOptimizer::getProfiler() const
+{
+    return problem.getProfiler();
+}
+
+void MotionOptimizer::printProfile( std::ostream & ostr ) const
+{
+    const Profiler & profiler = problem.getProfiler();
+
+    ostr << std::setw( 8 ) << "level";
+    for ( int j = 0; j < PROFILE_NUM_PHASES; ++j ){
+        ostr << std::setw( 22 ) 
+             << Profiler::phaseToString( ProfilePhase( j ) );
+    }
+    ostr << "\n";
+
+    //one row per level, and a last row with the totals.
+    for ( int i = 0; i <= profiler.numLevels(); ++i ){
+        const int level = ( i == profiler.numLevels() ? -1 : i );
+
+        if ( level < 0 ){ ostr << std::setw( 8 ) << "all"; }
+        else { ostr << std::setw( 8 ) << level; }
+
+        for ( int j = 0; j < PROFILE_NUM_PHASES; ++j ){
+            const ProfilePhase phase = ProfilePhase( j );
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision( 4 )
+                 << profiler.getSeconds( phase, level ) << "s/"
+                 << profiler.getCount( phase, level );
+            ostr << std::setw( 22 ) << cell.str();
+        }
+        ostr << "\n";
+    }
+    ostr << "wall: " << profiler.getWallSeconds() << "s\n";
+}
+
 void MotionOptimizer::setLowerBounds( const MatX & lower )
 {
     problem.setLowerBounds( lower );
@@ -490,6 +586,16 @@ const
     return problem.collision_function;
 }
 
+void MotionOptimizer::setTelemetry( TelemetrySink * sink )
+{
+    telemetry = sink;
+}
+
+TelemetrySink * MotionOptimizer::getTelemetry()
+{
+    return telemetry;
+}
+
 void MotionOptimizer::setObserver( Observer * obs )
 { 
     observer = obs;
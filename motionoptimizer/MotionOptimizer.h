@@ -35,6 +35,7 @@
 
 #include "utils/utils.h"
 #include "utils/Observer.h"
+#include "utils/SolveStats.h"
 
 #include "containers/ProblemDescription.h"
 
@@ -44,6 +45,7 @@
 #include "optimizer/ChompLocalOptimizer.h"
 #include "optimizer/ChompOptimizer.h"
 #include "optimizer/TestOptimizer.h"
+#include "optimizer/AsyncObserver.h"
 
 #ifdef NLOPT_FOUND
     #include "optimizer/NLOptimizer.h"
@@ -130,6 +132,12 @@ class MotionOptimizer {
      */
     Observer * observer;
 
+    /**
+     * If this is not NULL, the optimizers record every event into
+     * it.
+     */
+    TelemetrySink * telemetry;
+
     /** The max and min values of the length of the trajectory.
      * If N_max is greater than N_min, then the MotionOptimizer
      * will use upsampling to eventually get a trajectory >= N_max
@@ -156,6 +164,9 @@ class MotionOptimizer {
 
     OptimizationAlgorithm algorithm1, algorithm2;
 
+    /** What happened during the last call to solve(). */
+    SolveStats stats;
+
     const static char* TAG;
 
   public:
@@ -170,13 +181,31 @@ class MotionOptimizer {
                      OptimizationAlgorithm algorithm2 = LBFGS_NLOPT,
                      int N_max = 0);
 
-    void solve();
+    /**
+     * Optimizes the trajectory, upsampling until N_max is reached.
+     * Returns the statistics of the solve, which stay available
+     * through getSolveStats() until the next call.
+     */
+    const SolveStats & solve();
+
+    const SolveStats & getSolveStats() const;
+
+    /**
+     * The time spent and the number of calls in each ProfilePhase
+     * of the last call to solve(), per level of upsampling.
+     */
+    const Profiler & getProfiler() const;
+
+    /** Prints the profile as a table with one row per level. */
+    void printProfile( std::ostream & ostr = std::cout ) const;
     
   private:
     //sets up the factory, gradient, and optimizer for the current
     //  resolution.
-    void optimize( OptimizerBase * optimizer, bool subsample = false);
-    OptimizerBase * getOptimizer( OptimizationAlgorithm algorithm );
+    void optimize( OptimizationAlgorithm algorithm, bool subsample = false);
+    //creates the optimizer for algorithm, replacing algorithm with
+    //  the one actually used.
+    OptimizerBase * getOptimizer( OptimizationAlgorithm & algorithm );
     
   public:
 
@@ -250,6 +279,9 @@ class MotionOptimizer {
     void setCollisionFunction( CollisionFunction * coll_func);
     const CollisionFunction * getCollisionFunction() const;
 
+    void setTelemetry( TelemetrySink * sink );
+    TelemetrySink * getTelemetry();
+
     void setObserver( Observer * obs );
     Observer * getObserver();
     const Observer * getObserver() const;
@@ -0,0 +1,100 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "ChainCollisionFunction.h"
+#include "DistanceFieldCollisionFunction.h"
+
+namespace mopt {
+
+ChainCollisionFunction::ChainCollisionFunction(
+                                     const KinematicChain * chain,
+                                     const DtGridf * grid,
+                                     double gamma,
+                                     double eps ) :
+    CollisionFunction( chain->numLinks(), 3, chain->numSpheres(), gamma ),
+    chain( chain ),
+    grid( grid ),
+    eps( eps ),
+    next_state( 0 ),
+    computed( 0 )
+{
+}
+
+const KinematicChain::State & ChainCollisionFunction::getState(
+                                                        const MatX & q )
+{
+    for ( size_t i = 0; i < NUM_STATES; ++i ){
+        const MatX & cached = states[i].q;
+        if ( cached.rows() == q.rows() && cached.cols() == q.cols() &&
+             cached == q ){
+            return states[i];
+        }
+    }
+
+    KinematicChain::State & state = states[ next_state ];
+    next_state = ( next_state + 1 ) % NUM_STATES;
+
+    chain->compute( q, state );
+    ++computed;
+    return state;
+}
+
+double ChainCollisionFunction::getCost( const MatX& q,
+                                        size_t body_index,
+                                        MatX& dx_dq, 
+                                        MatX& collision_gradient )
+{
+    const KinematicChain::State & state = getState( q );
+    const KinematicChain::Sphere & sphere = chain->getSphere( body_index );
+
+    dx_dq = state.jacobians.block( 3*body_index, 0, 
+                                   3, chain->numLinks() );
+
+    const vec3d & c = state.centers[ body_index ];
+    vec3f g;
+    const double d = grid->sample( vec3f( c ), g ) - sphere.radius;
+
+    double dc;
+    const double cost = DistanceFieldCollisionFunction::distanceCost( d, eps,
+                                                                     &dc );
+
+    collision_gradient.resize( 3, 1 );
+    collision_gradient << g[0]*dc, g[1]*dc, g[2]*dc;
+
+    setClearance( DistanceFieldCollisionFunction::interpolatedClearance(
+                      d, eps, 3 ) );
+
+    return cost;
+}
+
+}//namespace
@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _CHAIN_COLLISION_FUNCTION_H_
+#define _CHAIN_COLLISION_FUNCTION_H_
+
+#include "CollisionFunction.h"
+#include "KinematicChain.h"
+#include "mzcommon/DtGrid.h"
+
+namespace mopt {
+
+//Collision costs for the spheres of a KinematicChain in a distance
+//  field, with one body per sphere. Forward kinematics and all the
+//  sphere jacobians are computed in a single sweep the first time a
+//  configuration is seen, and the bodies of that configuration are
+//  then read back from it. The last three configurations are kept, so
+//  swept mode (which alternates between segment ends, and at the
+//  first waypoint between the start and the next waypoint too) also
+//  only computes each configuration once.
+class ChainCollisionFunction : public CollisionFunction {
+
+  private:
+    const KinematicChain * chain;
+    const DtGridf * grid;
+    double eps;
+
+    enum { NUM_STATES = 3 };
+    KinematicChain::State states[NUM_STATES];
+    size_t next_state;
+    size_t computed;
+
+  public:
+    //the cost of a sphere is zero at distances above eps and grows
+    //  quadratically, then linearly, inside of it. The chain must
+    //  have all of its spheres already.
+    ChainCollisionFunction( const KinematicChain * chain,
+                            const DtGridf * grid,
+                            double gamma,
+                            double eps = 0.1 );
+
+    virtual ~ChainCollisionFunction(){}
+
+    //the forward kinematics of q, computed if needed.
+    const KinematicChain::State & getState( const MatX & q );
+
+    //the number of times getState has run the forward kinematics.
+    size_t getComputedCount() const { return computed; }
+
+  protected:
+    virtual double getCost( const MatX& q,
+                            size_t body_index,
+                            MatX& dx_dq, 
+                            MatX& collision_gradient );
+
+};
+
+}//namespace
+
+#endif
@@ -46,8 +46,65 @@ CollisionFunction::CollisionFunction( size_t cspace_dofs,
     configuration_space_DOF( cspace_dofs ),
     workspace_DOF( workspace_dofs ),
     number_of_bodies( n_bodies ),
-    gamma( gamma )
+    body_set( 0 ),
+    gamma( gamma ),
+    swept( false ),
+    lipschitz( 0 ),
+    clearance( 0 ),
+    skipped( 0 ),
+    project( &CollisionFunction::projectDynamic )
 {
+    BodySet full = { n_bodies, 0 };
+    body_sets.push_back( full );
+
+    if ( workspace_DOF == 3 ){
+        switch ( configuration_space_DOF ){
+          case 2: project = &CollisionFunction::projectFixed<2>; break;
+          case 3: project = &CollisionFunction::projectFixed<3>; break;
+          case 6: project = &CollisionFunction::projectFixed<6>; break;
+          case 7: project = &CollisionFunction::projectFixed<7>; break;
+          default: break;
+        }
+    }
+}
+
+void CollisionFunction::setNumberOfBodies( size_t size )
+{
+    body_sets[0].n_bodies = size;
+    if ( body_set == 0 ){ number_of_bodies = size; }
+}
+
+size_t CollisionFunction::addBodySet( size_t n_bodies, int max_N )
+{
+    BodySet set = { n_bodies, max_N };
+    body_sets.push_back( set );
+    return body_sets.size() - 1;
+}
+
+void CollisionFunction::setTemporalCoherence( double lipschitz_constant )
+{
+    lipschitz = lipschitz_constant;
+    clearCoherence();
+}
+
+void CollisionFunction::clearCoherence()
+{
+    coherent_clearance.clear();
+    coherent_q.resize( 0, 0 );
+    skipped = 0;
+}
+
+void CollisionFunction::selectBodySet( int N )
+{
+    body_set = 0;
+    for ( size_t i = 1; i < body_sets.size(); ++i ){
+        if ( N <= body_sets[i].max_N &&
+             ( body_set == 0 || 
+               body_sets[i].max_N < body_sets[body_set].max_N ) ){
+            body_set = i;
+        }
+    }
+    number_of_bodies = body_sets[body_set].n_bodies;
 }
 
 void CollisionFunction::prepareEvaluation( const Trajectory & trajectory )
@@ -59,6 +116,16 @@ void CollisionFunction::prepareEvaluation( const Trajectory & trajectory )
 
     gradient_t.resize( 1, configuration_space_DOF );
 
+    if ( swept ){ gradient_next.setZero( 1, configuration_space_DOF ); }
+
+    //start over if the shape of the trajectory or the body set changed
+    const size_t cache_size = trajectory.rows() * number_of_bodies;
+    if ( lipschitz > 0 && !swept && 
+         coherent_clearance.size() != cache_size ){
+        coherent_clearance.assign( cache_size, 0.0 );
+        coherent_q.resize( configuration_space_DOF, cache_size );
+    }
+
 }
 
 double CollisionFunction::evaluate( const Trajectory & trajectory )
@@ -93,17 +160,61 @@ double CollisionFunction::evaluateTimestep( int t,
     
     double total = 0;
 
+    if ( swept ){
+
+        //the part of the previous segment that belongs here
+        if ( set_gradient ){
+            gradient_t += gradient_next;
+            gradient_next.setZero();
+        }
+
+        //the segments (t, t+1) and, for the first waypoint, also the
+        //  one leading up to it from the fixed start.
+        for (size_t u=0; u < number_of_bodies; ++u) {
+            if ( t == 0 ){
+                total += segmentTimestep( q0, q1, u, false, false,
+                                          set_gradient );
+            }
+            total += segmentTimestep( q1, q2, u, true, true,
+                                      set_gradient );
+        }
+
+        debug_status( TAG, "evaluateTimestep", "end");
+
+        return total;
+    }
+
+    const bool coherent = lipschitz > 0;
+
     for (size_t u=0; u < number_of_bodies; ++u) {
 
+        const size_t k = t * number_of_bodies + u;
+
+        //compare squares to save the square root
+        if ( coherent && coherent_clearance[k] > 0 &&
+             lipschitz * lipschitz *
+             ( coherent_q.col(k) - q1 ).squaredNorm() <
+             coherent_clearance[k] * coherent_clearance[k] ){
+            ++skipped;
+            continue;
+        }
+
+        clearance = 0;
+
         float cost = getCost(q1, u, dx_dq, collision_gradient);
 
+        if ( coherent ){
+            coherent_clearance[k] = clearance;
+            if ( clearance > 0 ){ coherent_q.col(k) = q1; }
+        }
+
         debug_assert( size_t(dx_dq.rows()) == workspace_DOF );
         debug_assert( size_t(dx_dq.cols()) == configuration_space_DOF );
 
         if (cost > 0.0) {
-            total += projectCost( cost, dx_dq,
-                                  collision_gradient,
-                                  set_gradient );
+            total += (this->*project)( cost, dx_dq,
+                                       collision_gradient,
+                                       set_gradient );
         }
     }
 
@@ -113,6 +224,63 @@ double CollisionFunction::evaluateTimestep( int t,
 }
 
 
+double CollisionFunction::segmentTimestep( const MatX& qa, const MatX& qb,
+                                           size_t u,
+                                           bool to_current, bool to_next,
+                                           bool set_gradient )
+{
+    double s = 0;
+    float cost = getSegmentCost( qa, qb, u, s, dx_dq, collision_gradient );
+
+    debug_assert( s >= 0 && s <= 1 );
+    debug_assert( size_t(dx_dq.rows()) == workspace_DOF );
+    debug_assert( size_t(dx_dq.cols()) == configuration_space_DOF );
+
+    if ( cost <= 0.0 ){ return 0; }
+
+    if ( !set_gradient ){
+        return (this->*project)( cost, dx_dq, collision_gradient, false );
+    }
+
+    //project into an empty gradient_t, then hand out the result.
+    gradient_segment.swap( gradient_t );
+    gradient_t.setZero( 1, configuration_space_DOF );
+
+    double total = (this->*project)( cost, dx_dq, 
+                                     collision_gradient, true );
+
+    if ( to_current ){ gradient_segment += (1 - s) * gradient_t; }
+    if ( to_next ){ 
+        gradient_next += s * gradient_t;
+    } else {
+        gradient_segment += s * gradient_t;
+    }
+
+    gradient_t.swap( gradient_segment );
+
+    return total;
+}
+
+double CollisionFunction::getSegmentCost( const MatX& qa,
+                                          const MatX& qb,
+                                          size_t current_index,
+                                          double& s,
+                                          MatX& dx_dq,
+                                          MatX& collision_gradient )
+{
+    double ca = getCost( qa, current_index, dx_dq, collision_gradient );
+    double cb = getCost( qb, current_index, 
+                         dx_dq_s, collision_gradient_s );
+    if ( cb > ca ){
+        s = 1;
+        dx_dq.swap( dx_dq_s );
+        collision_gradient.swap( collision_gradient_s );
+        return cb;
+    }
+    s = 0;
+    return ca;
+}
+
 template< class Derived1, class Derived2 >
 double CollisionFunction::projectCost(
                            double cost,
@@ -150,5 +318,58 @@ double CollisionFunction::projectCost(
     return cost * scl;
 }
 
-}// namespace
+double CollisionFunction::projectDynamic( double cost,
+                                          const MatX & jacobian,
+                                          const MatX & coll_grad,
+                                          bool set_gradient )
+{
+    return projectCost( cost, jacobian, coll_grad, set_gradient );
+}
+
+//the same as projectCost, for a 3 x M jacobian. Everything lives on
+//  the stack and the loops are unrolled by Eigen.
+template <int M>
+double CollisionFunction::projectFixed( double cost,
+                                        const MatX & jacobian,
+                                        const MatX & coll_grad,
+                                        bool set_gradient )
+{
+    typedef Eigen::Matrix< double, 3, M > Jacobian;
+    typedef Eigen::Matrix< double, M, 1 > CVector;
+    typedef Eigen::Matrix< double, 3, 1 > WVector;
 
+    debug_assert( jacobian.rows() == 3 && jacobian.cols() == M );
+    debug_assert( coll_grad.size() == 3 );
+
+    const Jacobian J = jacobian;
+    
+    WVector wv = J * Eigen::Map< const CVector >( cspace_vel.data() );
+
+    //this prevents nans from propagating, as in projectCost.
+    if (wv.isZero()){ return 0; }
+    
+    float wv_norm = wv.norm();
+    
+    double scl = wv_norm * gamma * dt;
+
+    if ( set_gradient ){
+        wv /= wv_norm;
+        
+        const WVector wa = 
+            J * Eigen::Map< const CVector >( cspace_accel.data() );
+
+        const Eigen::Matrix3d P_fixed = Eigen::Matrix3d::Identity()
+                                        - (wv * wv.transpose());
+
+        const WVector K_fixed = (P_fixed * wa) / (wv_norm * wv_norm);
+
+        const WVector cg = Eigen::Map< const WVector >( coll_grad.data() );
+
+        gradient_t += (scl * (J.transpose() *
+                       (P_fixed * cg - cost * K_fixed))).transpose();
+    }
+
+    return cost * scl;
+}
+
+}// namespace
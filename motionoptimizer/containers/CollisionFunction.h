@@ -48,9 +48,34 @@ class CollisionFunction {
 
     size_t configuration_space_DOF;
     size_t workspace_DOF;
+
+    //the number of bodies in the current body set
     size_t number_of_bodies;
 
+    //levels of detail of the collision model. Set 0 is the full
+    //  model, the others are used for trajectories with at most
+    //  max_N waypoints.
+    struct BodySet {
+        size_t n_bodies;
+        int max_N;
+    };
+    std::vector< BodySet > body_sets;
+    size_t body_set;
+
     double gamma, dt;
+
+    //check the segments between waypoints instead of the waypoints
+    bool swept;
+
+    //temporal coherence: for each (timestep, body), the clearance
+    //  reported by getCost and the configuration it was computed at
+    //  (one per column).
+    //  Disabled while lipschitz is zero.
+    double lipschitz;
+    double clearance;
+    std::vector< double > coherent_clearance;
+    MatX coherent_q;
+    size_t skipped;
     
   protected:
     //the jacobian that maps between work and configuration space
@@ -59,6 +84,11 @@ class CollisionFunction {
     //The vector that is the collision gradient in workspace.
     MatX collision_gradient;
     MatX gradient_t;
+
+    //in swept mode, the part of the gradient of a segment that
+    //  belongs to the next waypoint, and scratch space for splitting it.
+    MatX gradient_next, gradient_segment;
+    MatX dx_dq_s, collision_gradient_s;
     
     //Working variables for the collision gradient computation
     MatX q0, q1, q2;
@@ -86,7 +116,53 @@ class CollisionFunction {
     size_t getWorkspaceDOF() const { return workspace_DOF; }
     size_t getConfigurationSpaceDOF() const { return configuration_space_DOF; }
 
-    void setNumberOfBodies( size_t size ){ number_of_bodies = size; }
+    //sets the number of bodies of the full model (body set 0)
+    void setNumberOfBodies( size_t size );
+
+    //registers a coarser collision model with n_bodies bodies, used
+    //  for trajectories with at most max_N waypoints (subsampled
+    //  trajectories count only the waypoints being optimized). If
+    //  several sets apply, the one with the smallest max_N is used.
+    //  Returns the index of the new set. getCost() should check
+    //  getBodySet() to tell which bodies body_index refers to.
+    size_t addBodySet( size_t n_bodies, int max_N );
+
+    size_t getNumberOfBodySets() const { return body_sets.size(); }
+    size_t getBodySet() const { return body_set; }
+
+    //selects the body set for a trajectory with N waypoints.
+    void selectBodySet( int N );
+
+    //in swept mode, each body is penalized at the point nearest to
+    //  collision along the segment between consecutive waypoints
+    //  (see getSegmentCost), so thin obstacles between waypoints are
+    //  not missed at coarse resolutions. Off by default.
+    void setSwept( bool swept_mode ){ swept = swept_mode; }
+    bool isSwept() const { return swept; }
+
+    //temporal coherence skipping. getCost is not called for a body
+    //  at a timestep while lipschitz * |q - q_c| (in configuration
+    //  space) is less than the clearance that getCost reported (see
+    //  setClearance) at q_c, the configuration of the timestep the
+    //  last time the body was evaluated there. lipschitz must bound
+    //  how far the body moves in workspace per unit of configuration
+    //  change, then the skipped costs would all have been zero.
+    //  Zero (the default) disables it. Not used in swept mode.
+    void setTemporalCoherence( double lipschitz_constant );
+    double getTemporalCoherence() const { return lipschitz; }
+
+    //forgets the cached clearances. Called at the start of every
+    //  run, subclasses should call it if their world model changes.
+    void clearCoherence();
+
+    //the number of getCost calls skipped since clearCoherence.
+    size_t getSkippedCount() const { return skipped; }
+
+    //called whenever the trajectory changes resolution, before
+    //  the first evaluation at the new resolution. Subclasses
+    //  may use it to pick a coarser world model for coarser
+    //  trajectories.
+    virtual void prepareRun( const Trajectory & trajectory ){}
 
   protected:
     virtual double evaluateTimestep( int t,
@@ -107,6 +183,27 @@ class CollisionFunction {
                             MatX& dx_dq, 
                             MatX& collision_gradient ){ return 0;};
 
+    // return the cost for a given body swept along the segment from
+    //      configuration qa to qb, taken at the point of the segment
+    //      that is nearest to collision.
+    // s is set to the position of that point along the segment, 
+    //      in [0, 1].
+    // dx_dq and collision_gradient are as for getCost, at that point.
+    // The default samples getCost at both ends of the segment, 
+    //      subclasses that can do better should override it.
+    virtual double getSegmentCost( const MatX& qa,
+                                   const MatX& qb,
+                                   size_t current_index,
+                                   double& s,
+                                   MatX& dx_dq,
+                                   MatX& collision_gradient );
+
+    //for getCost to report how far the body is from where its
+    //  cost becomes nonzero (in workspace, for a 1-Lipschitz
+    //  distance field). Not calling it means the body will be
+    //  re-evaluated next time.
+    void setClearance( double c ){ clearance = c; }
+
     template< class Derived1, class Derived2 >
     double projectCost( double cost,
                         const Eigen::MatrixBase<Derived1> & jacobian,
@@ -114,6 +211,37 @@ class CollisionFunction {
                         bool set_gradient );
 
   private:
+    //projectCost for the MatX jacobians and gradients used by
+    //  evaluate. Picked at construction: fixed size Eigen types on
+    //  the stack for 3D workspaces with 2, 3, 6 or 7 DOF, and the
+    //  dynamically sized projectCost otherwise.
+    typedef double (CollisionFunction::*ProjectFunction)( 
+                                              double cost,
+                                              const MatX & jacobian,
+                                              const MatX & coll_grad,
+                                              bool set_gradient );
+    ProjectFunction project;
+
+    double projectDynamic( double cost,
+                           const MatX & jacobian,
+                           const MatX & coll_grad,
+                           bool set_gradient );
+
+    template <int M>
+    double projectFixed( double cost,
+                         const MatX & jacobian,
+                         const MatX & coll_grad,
+                         bool set_gradient );
+
+    //adds the cost of the segment from qa to qb for body u, and
+    //  splits its gradient between the waypoints at either end.
+    //  Gradients for the waypoint at qa go to gradient_t if 
+    //  to_current, those for qb to gradient_next if to_next, and 
+    //  to gradient_t otherwise.
+    double segmentTimestep( const MatX& qa, const MatX& qb, size_t u,
+                            bool to_current, bool to_next,
+                            bool set_gradient );
+
     void prepareEvaluation( const Trajectory & trajectory );
 
 };
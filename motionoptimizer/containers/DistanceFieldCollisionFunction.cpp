@@ -0,0 +1,223 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "DistanceFieldCollisionFunction.h"
+#include <algorithm>
+
+namespace mopt {
+
+DistanceFieldCollisionFunction::DistanceFieldCollisionFunction(
+                                                const DtGridf * grid,
+                                                size_t cspace_dofs,
+                                                double gamma,
+                                                double eps ) :
+    CollisionFunction( cspace_dofs, 3, 1, gamma ),
+    grid( grid ),
+    eps( eps ),
+    spheres( 1 )
+{
+    initialize();
+}
+
+DistanceFieldCollisionFunction::DistanceFieldCollisionFunction(
+                                   const DtGridf * grid,
+                                   size_t cspace_dofs,
+                                   double gamma,
+                                   double eps,
+                                   const std::vector< Sphere > & spheres ) :
+    CollisionFunction( cspace_dofs, 3, spheres.size(), gamma ),
+    grid( grid ),
+    eps( eps ),
+    spheres( spheres )
+{
+    initialize();
+}
+
+void DistanceFieldCollisionFunction::initialize()
+{
+    assert( getConfigurationSpaceDOF() == 2 || 
+            getConfigurationSpaceDOF() == 3 );
+
+    jacobian.setZero( 3, getConfigurationSpaceDOF() );
+    for ( size_t i = 0; i < getConfigurationSpaceDOF(); ++i ){
+        jacobian( i, i ) = 1;
+    }
+
+    radii.clear();
+    field_index.resize( spheres.size() );
+    for ( size_t s = 0; s < spheres.size(); ++s ){
+        size_t r = 0;
+        while ( r < radii.size() && radii[r] != spheres[s].radius ){ ++r; }
+        if ( r == radii.size() ){ radii.push_back( spheres[s].radius ); }
+        field_index[s] = r;
+    }
+
+    update();
+}
+
+void DistanceFieldCollisionFunction::update()
+{
+    plane_z = grid->cellCenter( vec3u( 0, 0, 0 ) )[2];
+
+    cost_fields.resize( radii.size() );
+
+    for ( size_t r = 0; r < radii.size(); ++r ){
+
+        DtGridf & field = cost_fields[r];
+        field.resize( grid->nx(), grid->ny(), grid->nz(),
+                      grid->referenceAxis(), grid->cellSize(),
+                      grid->origin() );
+
+        for ( size_t i = 0; i < grid->size(); ++i ){
+            field[i] = distanceCost( (*grid)[i] - radii[r], eps );
+        }
+
+        field.recomputeExtents();
+        field.computeGradients();
+    }
+}
+
+double DistanceFieldCollisionFunction::distanceCost( double d,
+                                                     double eps,
+                                                     double * dcost )
+{
+    double cost, dc;
+    if ( d < 0 ){
+        dc = -1;
+        cost = -d + 0.5*eps;
+    } else if ( d <= eps ){
+        const double f = d - eps;
+        dc = f / eps;
+        cost = f*f*0.5/eps;
+    } else {
+        dc = 0;
+        cost = 0;
+    }
+    if ( dcost ){ *dcost = dc; }
+    return cost;
+}
+
+double DistanceFieldCollisionFunction::interpolatedClearance( double d,
+                                                              double eps,
+                                                              size_t dims )
+{
+    return ( d - eps ) / sqrt( double( dims ) );
+}
+
+float DistanceFieldCollisionFunction::sampleCost( const vec3f & p,
+                                                  float radius,
+                                                  vec3f & grad ) const
+{
+    for ( size_t r = 0; r < radii.size(); ++r ){
+        if ( radii[r] == radius ){ return cost_fields[r].sample( p, grad ); }
+    }
+    assert( 0 && "no sphere has this radius" );
+    grad = vec3f( 0, 0, 0 );
+    return 0;
+}
+
+double DistanceFieldCollisionFunction::getCost( const MatX& q,
+                                                size_t body_index,
+                                                MatX& dx_dq, 
+                                                MatX& collision_gradient )
+{
+    const Sphere & sphere = spheres[ body_index ];
+
+    //both are the same size every time, so these do not allocate
+    dx_dq = jacobian;
+    collision_gradient.resize( 3, 1 );
+
+    const vec3f p = sphere.offset + 
+        vec3f( q(0), q(1), getConfigurationSpaceDOF() > 2 ? q(2) : plane_z );
+
+    vec3f g;
+    const float c = cost_fields[ field_index[body_index] ].sample( p, g );
+
+    collision_gradient( 0 ) = g[0];
+    collision_gradient( 1 ) = g[1];
+    collision_gradient( 2 ) = g[2];
+
+    //only needed for temporal coherence. The cost field is zero
+    //  wherever all 8 corners of the cell being interpolated are more
+    //  than radius + eps from obstacles. Moving by delta changes the
+    //  corners to ones within delta + sqrt(3) cell sizes of the current
+    //  ones, and the distances are 1-Lipschitz between cells.
+    if ( getTemporalCoherence() > 0 ){
+        const vec3u lo = grid->floorCell( p );
+        float dmin = DtGridf::DT_INF;
+        for ( int i = 0; i < 8; ++i ){
+            const vec3u s( std::min( lo[0] + (i & 1), grid->nx() - 1 ),
+                           std::min( lo[1] + ((i >> 1) & 1), grid->ny() - 1 ),
+                           std::min( lo[2] + ((i >> 2) & 1), grid->nz() - 1 ) );
+            dmin = std::min( dmin, (*grid)( s ) );
+        }
+        setClearance( dmin - sphere.radius - eps - 
+                      sqrt( 3.0 ) * grid->cellSize() );
+    }
+
+    return c;
+}
+
+double DistanceFieldCollisionFunction::getSegmentCost( const MatX& qa,
+                                                       const MatX& qb,
+                                                       size_t body_index,
+                                                       double& s,
+                                                       MatX& dx_dq,
+                                                       MatX& collision_gradient )
+{
+    const Sphere & sphere = spheres[ body_index ];
+    const bool planar = getConfigurationSpaceDOF() < 3;
+
+    const vec3f pa = sphere.offset + 
+        vec3f( qa(0), qa(1), planar ? plane_z : qa(2) );
+    const vec3f pb = sphere.offset + 
+        vec3f( qb(0), qb(1), planar ? plane_z : qb(2) );
+
+    //the cost of a sphere grows as its center nears obstacles, so the
+    //  costliest point is where the distance along the segment is
+    //  smallest. Sample there so the cost changes smoothly with the
+    //  endpoints.
+    vec3f pmin, g;
+    grid->lineMin( pa, pb, pmin, g );
+
+    const vec3f d = pb - pa;
+    const float l2 = vec3f::dot( d, d );
+    s = l2 > 0 ? vec3f::dot( pmin - pa, d ) / l2 : 0;
+    s = std::max( 0.0, std::min( 1.0, s ) );
+
+    q_segment = qa + s * ( qb - qa );
+
+    return getCost( q_segment, body_index, dx_dq, collision_gradient );
+}
+
+}//namespace
@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _DISTANCE_FIELD_COLLISION_FUNCTION_H_
+#define _DISTANCE_FIELD_COLLISION_FUNCTION_H_
+
+#include "CollisionFunction.h"
+#include "mzcommon/DtGrid.h"
+#include <vector>
+
+namespace mopt {
+
+//Collision costs for a robot made of spheres that translates through
+//  a DtGrid, with one body per sphere. The configuration is the
+//  position of the robot: (x, y, z) for 3 DOF, or (x, y) for 2 DOF,
+//  in which case the robot moves in the plane through the centers of
+//  the first layer of cells.
+//
+//The cost of a sphere is distanceCost() of its distance from
+//  obstacles. It is computed for every cell once, when the function
+//  is constructed (or in update), so a query is a single
+//  interpolated lookup, and nothing is allocated per query.
+class DistanceFieldCollisionFunction : public CollisionFunction {
+
+  public:
+    struct Sphere {
+        vec3f offset;
+        float radius;
+
+        Sphere() : offset( 0, 0, 0 ), radius( 0 ) {}
+        Sphere( const vec3f & o, float r ) : offset( o ), radius( r ) {}
+    };
+
+    //a point robot
+    DistanceFieldCollisionFunction( const DtGridf * grid,
+                                    size_t cspace_dofs,
+                                    double gamma,
+                                    double eps );
+
+    DistanceFieldCollisionFunction( const DtGridf * grid,
+                                    size_t cspace_dofs,
+                                    double gamma,
+                                    double eps,
+                                    const std::vector< Sphere > & spheres );
+
+    virtual ~DistanceFieldCollisionFunction(){}
+
+    //recomputes the cost fields, if the grid has changed.
+    void update();
+
+    const std::vector< Sphere > & getSpheres() const { return spheres; }
+    double getEps() const { return eps; }
+
+    //the cost of a sphere of the given radius at p, and its gradient.
+    float sampleCost( const vec3f & p, float radius, vec3f & grad ) const;
+
+    //the cost of a sphere whose surface is at signed distance d from
+    //  obstacles: zero above eps, (d-eps)^2/(2 eps) between 0 and eps,
+    //  and eps/2 - d below 0. Sets dcost to its derivative if given.
+    static double distanceCost( double d, double eps, double * dcost = 0 );
+
+    //the clearance (see CollisionFunction::setClearance) of a sphere
+    //  whose distance d is interpolated from a grid with dims axes:
+    //  multilinear interpolation is up to sqrt(dims) Lipschitz.
+    static double interpolatedClearance( double d, double eps,
+                                         size_t dims );
+
+  protected:
+    virtual double getCost( const MatX& q,
+                            size_t body_index,
+                            MatX& dx_dq, 
+                            MatX& collision_gradient );
+
+    //in swept mode, getCost at the point of the segment where the
+    //  grid is nearest to collision, as found by DtGrid::lineMin.
+    virtual double getSegmentCost( const MatX& qa,
+                                   const MatX& qb,
+                                   size_t body_index,
+                                   double& s,
+                                   MatX& dx_dq,
+                                   MatX& collision_gradient );
+
+  private:
+    const DtGridf * grid;
+    double eps;
+    float plane_z;
+
+    std::vector< Sphere > spheres;
+
+    //one cost field per distinct sphere radius
+    std::vector< float > radii;
+    std::vector< DtGridf > cost_fields;
+    std::vector< size_t > field_index;
+
+    //the constant jacobian of every sphere
+    MatX jacobian;
+
+    //the configuration getSegmentCost samples at
+    MatX q_segment;
+
+    void initialize();
+
+};
+
+}//namespace
+
+#endif
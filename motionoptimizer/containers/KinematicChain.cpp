@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "KinematicChain.h"
+
+namespace mopt {
+
+KinematicChain::KinematicChain()
+{
+}
+
+void KinematicChain::setBase( const Transform & base_frame )
+{
+    base = base_frame;
+}
+
+size_t KinematicChain::addLink( const Transform & offset,
+                                const vec3d & axis,
+                                JointType type )
+{
+    Link link;
+    link.offset = offset;
+    link.axis = axis / axis.norm();
+    link.type = type;
+    links.push_back( link );
+    return links.size() - 1;
+}
+
+size_t KinematicChain::addSphere( size_t link,
+                                  const vec3d & center,
+                                  double radius )
+{
+    assert( link < links.size() );
+
+    Sphere sphere;
+    sphere.link = link;
+    sphere.center = center;
+    sphere.radius = radius;
+    spheres.push_back( sphere );
+    return spheres.size() - 1;
+}
+
+void KinematicChain::compute( const MatX & q, State & state ) const
+{
+    const size_t L = links.size();
+    assert( size_t( q.size() ) == L );
+
+    state.q = q;
+    state.frames.resize( L );
+    state.axes.resize( L );
+    state.centers.resize( spheres.size() );
+    state.jacobians.setZero( 3 * spheres.size(), L );
+
+    //the one sweep down the chain
+    Transform frame = base;
+    for ( size_t i = 0; i < L; ++i ){
+        const Link & link = links[i];
+        frame = frame * link.offset;
+        if ( link.type == REVOLUTE ){
+            frame = frame * Transform( quat_t<double>::fromAxisAngle(
+                                           link.axis, q(i) ) );
+        } else {
+            frame = frame * Transform( link.axis * q(i) );
+        }
+        state.frames[i] = frame;
+        state.axes[i] = frame.rotFwd() * link.axis;
+    }
+
+    //each sphere only depends on the joints up to its link
+    for ( size_t s = 0; s < spheres.size(); ++s ){
+        const Sphere & sphere = spheres[s];
+        const vec3d c = state.frames[sphere.link] * sphere.center;
+        state.centers[s] = c;
+
+        for ( size_t j = 0; j <= sphere.link; ++j ){
+            vec3d column = state.axes[j];
+            if ( links[j].type == REVOLUTE ){
+                column = vec3d::cross( state.axes[j], 
+                                       c - state.frames[j].translation() );
+            }
+            state.jacobians( 3*s,   j ) = column[0];
+            state.jacobians( 3*s+1, j ) = column[1];
+            state.jacobians( 3*s+2, j ) = column[2];
+        }
+    }
+}
+
+}//namespace
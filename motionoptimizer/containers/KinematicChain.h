@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _KINEMATIC_CHAIN_H_
+#define _KINEMATIC_CHAIN_H_
+
+#include "../utils/utils.h"
+#include "mzcommon/Transform3.h"
+#include <vector>
+
+namespace mopt {
+
+typedef Transform3_t< double > Transform;
+
+//A serial chain of single degree of freedom joints, with spheres
+//  attached to the links for collision checking. Joint i moves link
+//  i: the frame of link i is the frame of link i-1 (or the base),
+//  times the link's offset, times the joint's rotation about (or
+//  translation along) its axis, which is given in the link frame.
+class KinematicChain {
+
+  public:
+    enum JointType { REVOLUTE, PRISMATIC };
+
+    struct Sphere {
+        size_t link;
+        vec3d center;
+        double radius;
+    };
+
+    //forward kinematics for one configuration.
+    struct State {
+        MatX q;
+
+        //per link, in the world frame
+        std::vector< Transform > frames;
+        std::vector< vec3d > axes;
+
+        //per sphere, in the world frame
+        std::vector< vec3d > centers;
+
+        //the jacobian of the center of sphere i is in rows
+        //  3*i to 3*i+2, one column per joint.
+        MatX jacobians;
+    };
+
+    KinematicChain();
+
+    void setBase( const Transform & base_frame );
+    const Transform & getBase() const { return base; }
+
+    //returns the index of the new link, which is also the index
+    //  of its joint in the configuration.
+    size_t addLink( const Transform & offset, const vec3d & axis, 
+                    JointType type = REVOLUTE );
+
+    //center is in the frame of link. Returns the index of the sphere.
+    size_t addSphere( size_t link, const vec3d & center, double radius );
+
+    size_t numLinks() const { return links.size(); }
+    size_t numSpheres() const { return spheres.size(); }
+    const Sphere & getSphere( size_t i ) const { return spheres[i]; }
+
+    //computes the frames of all links in one sweep from the base,
+    //  then the centers of all spheres and their jacobians. q holds
+    //  one value per link.
+    void compute( const MatX & q, State & state ) const;
+
+  private:
+    struct Link {
+        Transform offset;
+        vec3d axis;
+        JointType type;
+    };
+
+    Transform base;
+    std::vector< Link > links;
+    std::vector< Sphere > spheres;
+
+};
+
+}//namespace
+
+#endif
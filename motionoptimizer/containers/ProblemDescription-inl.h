@@ -37,6 +37,7 @@ double ProblemDescription::evaluateCollisionFunction(
 {
     prepareData();
     
+    ProfileScope scope( profiler, PROFILE_COLLISION );
     const double value = collision_function->evaluate( trajectory, g );
     if ( doing_covariant ){ metric.multiplyLowerInverse( g ); } 
 
@@ -49,14 +50,12 @@ double ProblemDescription::evaluateObjective(
                            const Eigen::MatrixBase<Derived> & g )
 {
     debug_status( TAG, "evaluateObjective", "start");
-    TIMER_START( "gradient" );
+    ProfileScope scope( profiler, PROFILE_OBJECTIVE );
     
     prepareData();
     
     double value = computeObjective( g );
     
-    TIMER_STOP( "gradient" );
-    
     debug_status( TAG, "evaluateObjective", "start");
     return value;
 
@@ -72,12 +71,14 @@ inline double ProblemDescription::computeObjective(
             value = smoothness_function.evaluate(trajectory, metric);
     
         if ( collision_function && !collision_constraint ){ 
+            ProfileScope scope( profiler, PROFILE_COLLISION );
             value += collision_function->evaluate( trajectory );
         }
     }else {
         value = smoothness_function.evaluate( trajectory, metric, g );
         
         if ( collision_function && !collision_constraint ){
+            ProfileScope scope( profiler, PROFILE_COLLISION );
             value += collision_function->evaluate( trajectory, g );
         }
             
@@ -164,6 +165,15 @@ inline bool ProblemDescription::isSubsampled() const
     return trajectory.isSubsampled();
 }
 
+inline Profiler & ProblemDescription::getProfiler()
+{
+    return profiler;
+}
+inline const Profiler & ProblemDescription::getProfiler() const
+{
+    return profiler;
+}
+
 inline const Metric & ProblemDescription::getMetric()
 {
     if ( trajectory.isSubsampled() ){
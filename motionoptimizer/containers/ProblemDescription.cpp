@@ -33,6 +33,8 @@
 
 #include "ProblemDescription.h"
 
+#include <sstream>
+
 
 namespace mopt {
 
@@ -41,12 +43,12 @@ const char* ProblemDescription::TAG = "ProblemDescription";
 
 
 ProblemDescription::ProblemDescription() :
+    collision_function( NULL ),
     goalset( NULL ),
     use_goalset( false ),
     is_covariant( false ),
     doing_covariant( false )
 {
-    TIMER_START( "total" );
 }
 ProblemDescription::~ProblemDescription(){}
 
@@ -75,6 +77,15 @@ void ProblemDescription::prepareRun( bool subsample)
     //  get all of the constraints for the current resolution
     if ( !factory.empty() ){ factory.getAll( trajectory.N() ); }
 
+    //pick the level of detail of the collision model for this
+    //  resolution and forget what it cached before letting it
+    //  prepare.
+    if ( collision_function ){
+        collision_function->selectBodySet( trajectory.N() );
+        collision_function->clearCoherence();
+        collision_function->prepareRun( trajectory );
+    }
+
     //are we going to use the goalset on this iteration?
     //  If we are subsampling, then even if there is a goalset
     //  to use, do not use it.
@@ -157,9 +168,16 @@ double ProblemDescription::evaluateCollisionFunction( const double * xi,
     double value;
     if ( g ){
         MatMap g_map( g, N(), M() );
-        value = collision_function->evaluate( trajectory, g_map );
-        if ( doing_covariant ){ metric.multiplyLowerInverse( g_map ); } 
+        {
+            ProfileScope scope( profiler, PROFILE_COLLISION );
+            value = collision_function->evaluate( trajectory, g_map );
+        }
+        if ( doing_covariant ){
+            ProfileScope scope( profiler, PROFILE_METRIC_SOLVE );
+            metric.multiplyLowerInverse( g_map );
+        } 
     }else {
+        ProfileScope scope( profiler, PROFILE_COLLISION );
         value = collision_function->evaluate( trajectory );
     }
     
@@ -170,7 +188,7 @@ double ProblemDescription::evaluateCollisionFunction( const double * xi,
 double ProblemDescription::evaluateObjective ( const double * xi,
                                                double * g )
 {
-    TIMER_START( "gradient" );
+    ProfileScope scope( profiler, PROFILE_OBJECTIVE );
     
     if ( xi ){ prepareData( xi ); }
     else     { prepareData();     }
@@ -185,8 +203,6 @@ double ProblemDescription::evaluateObjective ( const double * xi,
         value = computeObjective( MatX(0,0) );
     }
     
-    TIMER_STOP( "gradient" );
-
     return value;
 }
 
@@ -195,7 +211,7 @@ double ProblemDescription::evaluateConstraint( MatX & h )
 {
     if ( factory.empty() ) {return 0; }
 
-    TIMER_START( "constraint" );
+    ProfileScope scope( profiler, PROFILE_CONSTRAINT );
     
     prepareData();
     
@@ -203,8 +219,6 @@ double ProblemDescription::evaluateConstraint( MatX & h )
 
     const double value = factory.evaluate( trajectory, h);
 
-    TIMER_STOP( "constraint" );
-
     return value;
 }
 
@@ -212,7 +226,7 @@ double ProblemDescription::evaluateConstraint( MatX & h, MatX & H )
 {
     if ( factory.empty() ) {return 0; }
 
-    TIMER_START( "constraint" );
+    ProfileScope scope( profiler, PROFILE_CONSTRAINT );
 
     prepareData();
     
@@ -226,8 +240,6 @@ double ProblemDescription::evaluateConstraint( MatX & h, MatX & H )
                     MatMap ( H.data(), trajectory.N(),
                              trajectory.M()*factory.numOutput() ) );
     }
-    
-    TIMER_STOP( "constraint" );
 
     return magnitude;
     
@@ -239,7 +251,7 @@ double ProblemDescription::evaluateConstraint( const double * xi,
 {
     if ( factory.empty() ) {return 0; }
 
-    TIMER_START( "constraint" );
+    ProfileScope scope( profiler, PROFILE_CONSTRAINT );
     
     assert( h ); // make sure that h is not NULL
     
@@ -248,9 +260,7 @@ double ProblemDescription::evaluateConstraint( const double * xi,
     MatMap h_map( h, factory.numOutput(), 1 );
 
     if ( !H ){ 
-        const double val = factory.evaluate( trajectory, h_map );
-        TIMER_STOP( "constraint" );
-        return val;
+        return factory.evaluate( trajectory, h_map );
     }
         
     MatMap H_map( H, trajectory.size(), factory.numOutput() );
@@ -263,8 +273,7 @@ double ProblemDescription::evaluateConstraint( const double * xi,
                        trajectory.M()*factory.numOutput() );
         metric.multiplyLowerInverse( H_map2 );
     }
-    
-    TIMER_STOP( "constraint" );
+
     return magnitude;
 }
 
@@ -272,7 +281,7 @@ bool ProblemDescription::evaluateConstraint( MatX & h_t,
                                              MatX & H_t,
                                              int t )
 {
-    TIMER_START( "constraint" );
+    ProfileScope scope( profiler, PROFILE_CONSTRAINT );
     
     //TODO make this throw an error
     //  A covariant constraint jacobian H should not be local to
@@ -281,15 +290,10 @@ bool ProblemDescription::evaluateConstraint( MatX & h_t,
     assert( !is_covariant );
     
     Constraint * c = factory.getConstraint( t );
-    if ( c == NULL || c->numOutputs() == 0 ) {
-        TIMER_STOP( "constraint" );
-        return false;
-    }
+    if ( c == NULL || c->numOutputs() == 0 ) { return false; }
 
     c->evaluateConstraints( trajectory.row( t ), h_t, H_t );
 
-    TIMER_STOP( "constraint" );
-    
     return true;
 }
 
@@ -364,79 +368,38 @@ void ProblemDescription::getFullBounds( std::vector< double > & lower,
 void ProblemDescription::getTimes( 
         std::vector< std::pair<std::string, double> > & times ) const
 {
-#ifdef DO_TIMING
-    timer.getAllTotal( times );
-#else 
-    std::cout << "Timing information is not available"
-              << " because it was disabled at compile time.\n";
-#endif
+    times.clear();
+    times.push_back( std::make_pair( std::string("total"),
+                                     profiler.getWallSeconds() ) );
+
+    for ( int i = 0; i < PROFILE_NUM_PHASES; ++i ){
+        const ProfilePhase phase = ProfilePhase( i );
+        times.push_back( std::make_pair( 
+                            std::string( Profiler::phaseToString( phase ) ),
+                            profiler.getSeconds( phase ) ) );
+    }
 }
 
 void ProblemDescription::printTimes( bool verbose ) const
 {
-#ifdef DO_TIMING
-    std::vector< std::pair<std::string, double> > times;
-    timer.getAllTotal( times );
-
-    if (times.size() > 0 ){
-        for ( size_t i = 0; i < times.size() ; i ++ )
-        {
-            if (verbose){ std::cout << times[i].first << ": "; }
-            std::cout << times[i].second;
-            if ( i != times.size() - 1 ){ std::cout << ", "; }
-        }
-    }else {
-        std::cout << "No timing information available.";
-    }
-
-#else 
-    std::cout << "Timing information is not available"
-              << " because it was disabled at compile time.\n";
-#endif
-
+    std::cout << getTimesString( verbose );
 }
-std::string ProblemDescription::getTimesString( bool verbose )
+
+std::string ProblemDescription::getTimesString( bool verbose ) const
 {
-#ifdef DO_TIMING
     std::ostringstream stream;
     std::vector< std::pair<std::string, double> > times;
-    timer.stop("total");
-    timer.start("total");
-    timer.getAllTotal( times );
+    getTimes( times );
 
-    if (times.size() > 0 ){
-        for ( size_t i = 0; i < times.size() ; i ++ )
-        {
-            if (verbose){ stream << times[i].first << ":"; }
-            stream << times[i].second;
-            if ( i != times.size() - 1 ){ stream << ", "; }
-        }
-    }else {
-        stream << "No timing information available.";
+    for ( size_t i = 0; i < times.size() ; i ++ )
+    {
+        if (verbose){ stream << times[i].first << ":"; }
+        stream << times[i].second;
+        if ( i != times.size() - 1 ){ stream << ", "; }
     }
 
     return stream.str();
-
-#else 
-    std::cout << "Timing information is not available"
-              << " because it was disabled at compile time.\n";
-    return std::string();
-#endif
-
 }
 
-//undefine the timer macros
-#ifdef TIMER_START
-    #undef TIMER_START
-#endif
-
-#ifdef TIMER_STOP        
-    #undef TIMER_STOP
-#endif
-
-#ifdef TIMER_GET_TOTAL
-    #undef TIMER_GET_TOTAL
-#endif
-
 
 }//namespace
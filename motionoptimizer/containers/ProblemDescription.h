@@ -41,17 +41,7 @@
 #include "ConstraintFactory.h"
 #include "Metric.h"
 
-#ifdef DO_TIMING
-    #include "../utils/timer.h"
-    #include <sstream>
-    #define TIMER_START( x )        timer.start( x )   
-    #define TIMER_STOP( x )         timer.stop( x )    
-    #define TIMER_GET_TOTAL( x )    timer.getTotal( x )
-#else 
-    #define TIMER_START( x )     (void)0 
-    #define TIMER_STOP( x )      (void)0
-    #define TIMER_GET_TOTAL( x ) (void)0
-#endif 
+#include "../utils/Profiler.h"
 
 namespace mopt {
     
@@ -86,14 +76,9 @@ private:
 
     static const char * TAG;
 
-    
-    //Defines for timing things
-#ifdef DO_TIMING
-    Timer timer;
-    static const std::string gradient_timer;
-    static const std::string copy_timer;
-    static const std::string constraint_timer;
-#endif
+    //keeps track of where the time goes during optimization,
+    //  the MotionOptimizer sets the current level.
+    Profiler profiler;
     
 public:
     
@@ -173,7 +158,10 @@ public:
     
     void printTimes( bool verbose=true ) const ;
 
-    std::string getTimesString( bool verbose=true ) ;
+    std::string getTimesString( bool verbose=true ) const;
+
+    Profiler & getProfiler();
+    const Profiler & getProfiler() const;
 
     void getFullBounds( std::vector< double > & lower,
                         std::vector< double > & upper );
@@ -0,0 +1,593 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "ChainCollisionFunction.h"
+#include "DistanceFieldCollisionFunction.h"
+#include "Trajectory.h"
+#include "../MotionOptimizer.h"
+#include <mzcommon/mersenne.h>
+#include <stdio.h>
+
+using namespace mopt;
+
+static int failures = 0;
+
+static void check( bool ok, const char * what ){
+    if ( !ok ){
+        printf( "FAIL: %s\n", what );
+        ++failures;
+    }
+}
+
+//a grid of cell size 0.01 over the unit square (or cube) with
+//  occupied cells at random
+static void randomGrid( size_t nz, double density, DtGridf & grid ){
+    grid.resize( 100, 100, nz, DtGridf::AXIS_Z, 0.01, vec3f( 0, 0, 0 ) );
+    for ( size_t i = 0; i < grid.size(); ++i ){
+        grid[i] = ( mt_genrand_real1() < density ) ? -1 : 1;
+    }
+    grid.computeDistsFromBinary();
+}
+
+//temporal coherence must not change the result: a trajectory taking
+//  a random walk is evaluated with skipping on and off.
+static void testCoherence( size_t dims ){
+
+    mt_init_genrand( 48 + dims );
+
+    DtGridf grid;
+    randomGrid( dims > 2 ? 100 : 1, dims > 2 ? 0.0002 : 0.005, grid );
+
+    std::vector< DistanceFieldCollisionFunction::Sphere > spheres;
+    spheres.push_back( DistanceFieldCollisionFunction::Sphere(
+                           vec3f( 0, 0, 0 ), 0.0 ) );
+    spheres.push_back( DistanceFieldCollisionFunction::Sphere(
+                           vec3f( 0.02, 0.01, 0 ), 0.015 ) );
+
+    DistanceFieldCollisionFunction coherent( &grid, dims, 0.5, 0.05,
+                                             spheres );
+    DistanceFieldCollisionFunction full( &grid, dims, 0.5, 0.05,
+                                         spheres );
+    coherent.setTemporalCoherence( 1.0 );
+
+    const int N = 64;
+    MatX q0( 1, dims ), q1( 1, dims );
+    for ( size_t i = 0; i < dims; ++i ){
+        q0( i ) = 0.1 + 0.05*i;
+        q1( i ) = 0.9 - 0.05*i;
+    }
+
+    Trajectory trajectory;
+    trajectory.setObjectiveType( MINIMIZE_ACCELERATION );
+    trajectory.initialize( q0, q1, N );
+
+    MatX g1( N, dims ), g2( N, dims );
+    bool same = true;
+
+    for ( int step = 0; step < 400; ++step ){
+
+        g1.setZero();
+        g2.setZero();
+        const double c1 = coherent.evaluate( trajectory, g1 );
+        const double c2 = full.evaluate( trajectory, g2 );
+
+        if ( fabs( c1 - c2 ) > 1e-9 * ( 1 + fabs( c2 ) ) ||
+             ( g1 - g2 ).lpNorm<Eigen::Infinity>() > 
+             1e-9 * ( 1 + g2.lpNorm<Eigen::Infinity>() ) ){
+            same = false;
+        }
+
+        //steps of up to half a cell, so waypoints cross cells often
+        for ( int t = 0; t < N; ++t ){
+            for ( size_t i = 0; i < dims; ++i ){
+                trajectory( t, i ) += 0.005 * ( 2*mt_genrand_real1() - 1 );
+            }
+        }
+    }
+
+    check( same, dims > 2 ? "coherence changed the 3D costs" :
+                            "coherence changed the 2D costs" );
+    check( coherent.getSkippedCount() > 0,
+           "coherence never skipped a body" );
+}
+
+//records the body set picked for each run, and whether getCost was
+//  ever asked for a body outside of it.
+class BodySetRecorder : public CollisionFunction {
+  public:
+    std::vector< int > run_N;
+    std::vector< size_t > run_set, run_bodies;
+    bool index_ok;
+
+    BodySetRecorder() : CollisionFunction( 2, 2, 5, 0.1 ), index_ok( true )
+    {
+        addBodySet( 1, 10 );
+        addBodySet( 3, 40 );
+        addBodySet( 2, 20 );
+    }
+
+    void prepareRun( const Trajectory & trajectory ){
+        run_N.push_back( trajectory.N() );
+        run_set.push_back( getBodySet() );
+        run_bodies.push_back( getNumberOfBodies() );
+    }
+
+  protected:
+    double getCost( const MatX & state, size_t current_index,
+                    MatX & dx_dq, MatX & collision_gradient ){
+        if ( current_index >= getNumberOfBodies() ){ index_ok = false; }
+        dx_dq.setZero( 2, 2 );
+        collision_gradient.setZero( 2, 1 );
+        return 0;
+    }
+};
+
+//a cost of 0.5 on one segment of a trajectory (segment k runs from
+//  tick k to tick k+1, so -1 starts at the fixed start and N-1 ends
+//  at the fixed goal), at position s along it, with constant
+//  jacobian and workspace gradient.
+class SegmentProbe : public CollisionFunction {
+  public:
+    const Trajectory * trajectory;
+    int segment;
+    double segment_s;
+    MatX jacobian, gradient;
+
+    SegmentProbe( const Trajectory * trajectory ) :
+        CollisionFunction( 2, 3, 1, 0.5 ),
+        trajectory( trajectory ),
+        segment( 0 ),
+        segment_s( 0 ),
+        jacobian( 3, 2 ),
+        gradient( 3, 1 )
+    {
+        jacobian << 1.0, 0.2, -0.3, 0.8, 0.5, -0.4;
+        gradient << 0.3, -0.7, 0.2;
+        setSwept( true );
+    }
+
+  protected:
+    double getSegmentCost( const MatX & qa, const MatX & qb,
+                           size_t current_index, double & s,
+                           MatX & dx_dq, MatX & collision_gradient ){
+        if ( qa == trajectory->getTick( segment ).transpose() &&
+             qb == trajectory->getTick( segment+1 ).transpose() ){
+            s = segment_s;
+            dx_dq = jacobian;
+            collision_gradient = gradient;
+            return 0.5;
+        }
+        s = 0;
+        dx_dq.setZero( 3, 2 );
+        collision_gradient.setZero( 3, 1 );
+        return 0;
+    }
+};
+
+//in swept mode, the gradient of a segment is split between the
+//  waypoints at either end as (1-s) and s, and the parts belonging to
+//  the fixed start and goal are dropped.
+static void testSweptSplit(){
+
+    const int N = 6;
+    MatX q0( 1, 2 ), q1( 1, 2 );
+    q0 << 0.1, 0.2;
+    q1 << 0.9, 0.6;
+
+    Trajectory trajectory;
+    trajectory.setObjectiveType( MINIMIZE_ACCELERATION );
+    trajectory.initialize( q0, q1, N );
+    for ( int t = 0; t < N; ++t ){
+        trajectory( t, 1 ) += 0.05 * ( t % 3 );
+    }
+
+    SegmentProbe probe( &trajectory );
+    bool split_ok = true, nonzero = true;
+
+    for ( int k = -1; k < N; ++k ){
+
+        probe.segment = k;
+
+        //the whole gradient of the segment: it all goes to waypoint k
+        //  at s = 0, except for the first segment, which has nothing
+        //  but waypoint 0 to give it to.
+        const int row = std::max( k, 0 );
+        probe.segment_s = ( k < 0 ? 1 : 0 );
+
+        MatX whole = MatX::Zero( N, 2 );
+        const double c0 = probe.evaluate( trajectory, whole );
+        const MatX g = whole.row( row );
+
+        whole.row( row ).setZero();
+        if ( !whole.isZero( 0 ) ){ split_ok = false; }
+        if ( g.isZero( 0 ) ){ nonzero = false; }
+
+        const double s = 0.3;
+        probe.segment_s = s;
+
+        MatX expected = MatX::Zero( N, 2 );
+        if ( k >= 0 ){ expected.row( k ) = ( 1 - s ) * g; }
+        if ( k+1 < N ){ expected.row( k+1 ) = s * g; }
+
+        //twice, so a part left for the fixed goal can't leak into
+        //  the next evaluation
+        for ( int pass = 0; pass < 2; ++pass ){
+            MatX split = MatX::Zero( N, 2 );
+            const double c = probe.evaluate( trajectory, split );
+            if ( c != c0 || probe.evaluate( trajectory ) != c0 ||
+                 ( split - expected ).lpNorm<Eigen::Infinity>() >
+                 1e-12 * ( 1 + g.lpNorm<Eigen::Infinity>() ) ){
+                split_ok = false;
+            }
+        }
+    }
+
+    check( nonzero, "a probed segment had no gradient" );
+    check( split_ok, "swept gradients were split wrong" );
+}
+
+//a wall one cell thick between two waypoints is only seen in swept
+//  mode.
+static void testThinObstacle(){
+
+    DtGridf grid;
+    grid.resize( 100, 100, 1, DtGridf::AXIS_Z, 0.01, vec3f( 0, 0, 0 ) );
+    for ( size_t y = 0; y < grid.ny(); ++y ){
+        for ( size_t x = 0; x < grid.nx(); ++x ){
+            grid( x, y, 0 ) = ( x == 50 ) ? -1 : 1;
+        }
+    }
+    grid.computeDistsFromBinary();
+
+    DistanceFieldCollisionFunction collision( &grid, 2, 0.5, 0.05 );
+
+    //waypoints at x = 0.26, 0.42, 0.58 and 0.74, all well over eps
+    //  from the wall at x = 0.5
+    const int N = 4;
+    MatX q0( 1, 2 ), q1( 1, 2 );
+    q0 << 0.1, 0.5;
+    q1 << 0.9, 0.52;
+
+    Trajectory trajectory;
+    trajectory.setObjectiveType( MINIMIZE_ACCELERATION );
+    trajectory.initialize( q0, q1, N );
+
+    MatX g = MatX::Zero( N, 2 );
+    const double c = collision.evaluate( trajectory, g );
+    check( c == 0 && g.isZero( 0 ),
+           "waypoints clear of a thin wall have a cost" );
+
+    collision.setSwept( true );
+    g.setZero();
+    const double swept = collision.evaluate( trajectory, g );
+    check( swept > 0 && swept == collision.evaluate( trajectory ),
+           "swept mode missed a thin wall between waypoints" );
+
+    //the segment crossing the wall is between waypoints 1 and 2, and
+    //  pushes them back along x
+    check( g( 1, 0 ) != 0 && g( 2, 0 ) != 0 && 
+           g.row( 0 ).isZero( 0 ) && g.row( 3 ).isZero( 0 ),
+           "the wall's gradient went to the wrong waypoints" );
+}
+
+//a chain of revolute and prismatic joints with skewed axes and
+//  rotated offsets, and spheres on every link.
+static void testChain( KinematicChain & chain ){
+
+    typedef quat_t< double > quat;
+
+    chain.setBase( Transform( quat::fromAxisAngle( vec3d( 0, 0, 1 ), 0.3 ),
+                              vec3d( 0.5, 0.5, 0.1 ) ) );
+
+    chain.addLink( Transform( vec3d( 0, 0, 0.1 ) ), vec3d( 0, 0, 1 ) );
+    chain.addLink( Transform( quat::fromAxisAngle( vec3d( 1, 0, 0 ), 0.4 ),
+                              vec3d( 0.1, 0, 0.05 ) ),
+                   vec3d( 0, 1, 0.2 ) );
+    chain.addLink( Transform( vec3d( 0.15, 0, 0 ) ), vec3d( 1, 0.3, 0 ),
+                   KinematicChain::PRISMATIC );
+    chain.addLink( Transform( quat::fromAxisAngle( vec3d( 0, 1, 0 ), -0.2 ),
+                              vec3d( 0.05, 0.02, 0 ) ),
+                   vec3d( 0.2, 0, 1 ) );
+    chain.addLink( Transform( vec3d( 0, 0.1, 0 ) ), vec3d( 0, 0, 1 ),
+                   KinematicChain::PRISMATIC );
+
+    for ( size_t i = 0; i < chain.numLinks(); ++i ){
+        chain.addSphere( i, vec3d( 0.05, 0.01*i, -0.02 ), 0.02 );
+    }
+    chain.addSphere( 3, vec3d( -0.03, 0.04, 0.06 ), 0.01 );
+}
+
+static MatX randomConfiguration( size_t n ){
+    MatX q( n, 1 );
+    for ( size_t i = 0; i < n; ++i ){ q( i ) = 2*mt_genrand_real1() - 1; }
+    return q;
+}
+
+//the jacobians of the sphere centers match central differences.
+static void testChainJacobians(){
+
+    mt_init_genrand( 46 );
+
+    KinematicChain chain;
+    testChain( chain );
+
+    const size_t L = chain.numLinks();
+    const double h = 1e-6;
+    double worst = 0;
+
+    KinematicChain::State state, plus, minus;
+
+    for ( int trial = 0; trial < 20; ++trial ){
+
+        const MatX q = randomConfiguration( L );
+        chain.compute( q, state );
+
+        for ( size_t j = 0; j < L; ++j ){
+            MatX qp = q, qm = q;
+            qp( j ) += h;
+            qm( j ) -= h;
+            chain.compute( qp, plus );
+            chain.compute( qm, minus );
+
+            for ( size_t s = 0; s < chain.numSpheres(); ++s ){
+                const vec3d d = ( plus.centers[s] - minus.centers[s] ) / 
+                                ( 2*h );
+                for ( int a = 0; a < 3; ++a ){
+                    worst = std::max( worst, 
+                        fabs( d[a] - state.jacobians( 3*s + a, j ) ) );
+                }
+            }
+        }
+    }
+
+    check( worst < 1e-6, "chain jacobians differ from finite differences" );
+}
+
+//getState hands back the last three configurations without running
+//  the kinematics again, and evaluate computes each configuration
+//  once.
+static void testChainCache(){
+
+    mt_init_genrand( 47 );
+
+    KinematicChain chain;
+    testChain( chain );
+    const size_t L = chain.numLinks();
+
+    DtGridf grid;
+    randomGrid( 60, 0.0002, grid );
+
+    ChainCollisionFunction collision( &chain, &grid, 0.5, 0.05 );
+
+    const MatX qa = randomConfiguration( L );
+    const MatX qb = randomConfiguration( L );
+    const MatX qc = randomConfiguration( L );
+    const MatX qd = randomConfiguration( L );
+
+    const KinematicChain::State * a = &collision.getState( qa );
+    const KinematicChain::State * b = &collision.getState( qb );
+    const KinematicChain::State * c = &collision.getState( qc );
+    const bool cached = ( &collision.getState( qb ) == b &&
+                          &collision.getState( qa ) == a &&
+                          &collision.getState( qc ) == c &&
+                          collision.getComputedCount() == 3 );
+
+    KinematicChain::State fresh;
+    chain.compute( qa, fresh );
+    const bool same = ( a != b && b != c && a != c && a->q == qa &&
+                        a->jacobians == fresh.jacobians &&
+                        a->centers == fresh.centers );
+
+    //a new configuration replaces the first one computed
+    collision.getState( qd );
+    collision.getState( qb );
+    collision.getState( qc );
+    bool replaced = ( collision.getComputedCount() == 4 );
+    collision.getState( qa );
+    replaced = replaced && collision.getComputedCount() == 5;
+
+    check( cached, "getState recomputed a cached configuration" );
+    check( same, "getState returned the wrong state" );
+    check( replaced, "getState replaced the wrong configuration" );
+
+    const int N = 12;
+    MatX q0( 1, L ), q1( 1, L );
+    q0 = randomConfiguration( L ).transpose();
+    q1 = randomConfiguration( L ).transpose();
+
+    Trajectory trajectory;
+    trajectory.setObjectiveType( MINIMIZE_ACCELERATION );
+    trajectory.initialize( q0, q1, N );
+
+    MatX g = MatX::Zero( N, L );
+    size_t before = collision.getComputedCount();
+    collision.evaluate( trajectory, g );
+    check( collision.getComputedCount() - before == size_t( N ),
+           "evaluate computed a waypoint more than once" );
+
+    //swept mode also visits the fixed start and goal
+    collision.setSwept( true );
+    before = collision.getComputedCount();
+    collision.evaluate( trajectory, g );
+    check( collision.getComputedCount() - before == size_t( N + 2 ),
+           "swept evaluate computed a configuration more than once" );
+}
+
+//random costs, jacobians and workspace gradients for one body. Each
+//  getCost also runs the dynamically sized projectCost on its result
+//  and keeps the cost and gradient it gives, to compare with the
+//  fixed size projection evaluate picks for 3D workspaces.
+class ProjectProbe : public CollisionFunction {
+  public:
+    MatX dynamic_gradient;
+    double dynamic_total;
+    int timestep;
+
+    ProjectProbe( size_t M ) : 
+        CollisionFunction( M, 3, 1, 0.5 ), dynamic_total( 0 ), timestep( 0 )
+    {}
+
+  protected:
+    double getCost( const MatX & q, size_t current_index,
+                    MatX & dx_dq, MatX & collision_gradient ){
+
+        const size_t M = getConfigurationSpaceDOF();
+        dx_dq.resize( 3, M );
+        collision_gradient.resize( 3, 1 );
+        for ( size_t i = 0; i < 3; ++i ){
+            for ( size_t j = 0; j < M; ++j ){
+                dx_dq( i, j ) = 2*mt_genrand_real1() - 1;
+            }
+            collision_gradient( i ) = 2*mt_genrand_real1() - 1;
+        }
+
+        //evaluateTimestep passes the cost on as a float
+        const float cost = mt_genrand_real1();
+
+        MatX saved = gradient_t;
+        gradient_t.setZero();
+        dynamic_total += projectCost( cost, dx_dq, collision_gradient, true );
+        dynamic_gradient.row( timestep++ ) = gradient_t;
+        gradient_t = saved;
+
+        return cost;
+    }
+};
+
+//projectFixed<M> matches the dynamically sized projectCost.
+static void testProjectFixed(){
+
+    static const size_t dofs[4] = { 2, 3, 6, 7 };
+
+    for ( int d = 0; d < 4; ++d ){
+
+        const size_t M = dofs[d];
+        mt_init_genrand( 47 + M );
+
+        const int N = 40;
+        MatX q0( 1, M ), q1( 1, M );
+        for ( size_t i = 0; i < M; ++i ){
+            q0( i ) = mt_genrand_real1();
+            q1( i ) = mt_genrand_real1();
+        }
+
+        Trajectory trajectory;
+        trajectory.setObjectiveType( MINIMIZE_ACCELERATION );
+        trajectory.initialize( q0, q1, N );
+        for ( int t = 0; t < N; ++t ){
+            for ( size_t i = 0; i < M; ++i ){
+                trajectory( t, i ) += 0.1 * ( 2*mt_genrand_real1() - 1 );
+            }
+        }
+
+        ProjectProbe probe( M );
+        probe.dynamic_gradient.setZero( N, M );
+
+        MatX g = MatX::Zero( N, M );
+        const double total = probe.evaluate( trajectory, g );
+
+        char what[64];
+        sprintf( what, "projectFixed<%d> cost differs", int( M ) );
+        check( total == probe.dynamic_total && total > 0, what );
+
+        sprintf( what, "projectFixed<%d> gradient differs", int( M ) );
+        check( ( g - probe.dynamic_gradient ).lpNorm<Eigen::Infinity>() <=
+               1e-12 * g.lpNorm<Eigen::Infinity>(), what );
+    }
+}
+
+//prepareRun picks the body set with the smallest max_N that covers
+//  the waypoints being optimized, and set 0 when none does.
+static void testBodySets(){
+
+    BodySetRecorder collision;
+
+    MotionOptimizer optimizer;
+    optimizer.setCollisionFunction( &collision );
+    optimizer.setAlgorithm( CHOMP );
+    optimizer.setMaxIterations( 2 );
+    optimizer.setNMax( 60 );
+
+    MatX q0( 1, 2 ), q1( 1, 2 );
+    q0 << 0.1, 0.2;
+    q1 << 0.9, 0.7;
+    optimizer.getTrajectory().initialize( q0, q1, 8 );
+
+    //runs at N = 8, then 9 and 17, 18 and 35, 36 and 71 (subsampled
+    //  and full at each level of upsampling)
+    optimizer.solve();
+
+    //the expected set for each N, and how many bodies it has
+    static const size_t bodies[4] = { 5, 1, 3, 2 };
+    bool ok = collision.run_N.size() > 4, covered[4] = { 0 };
+
+    for ( size_t i = 0; i < collision.run_N.size(); ++i ){
+        const int N = collision.run_N[i];
+        const size_t set = ( N <= 10 ? 1 : N <= 20 ? 3 : N <= 40 ? 2 : 0 );
+        covered[set] = true;
+        if ( collision.run_set[i] != set ||
+             collision.run_bodies[i] != bodies[set] ){
+            ok = false;
+        }
+    }
+
+    check( ok, "prepareRun picked the wrong body set" );
+    check( covered[0] && covered[1] && covered[2] && covered[3],
+           "upsampling did not reach every body set" );
+    check( collision.index_ok, "getCost was asked for a body outside the set" );
+
+    //with no sets covering N, the full model is used
+    collision.selectBodySet( 41 );
+    check( collision.getBodySet() == 0 && collision.getNumberOfBodies() == 5,
+           "set 0 was not the fallback" );
+}
+
+int main( int argc, char ** argv ){
+
+    testCoherence( 2 );
+    testCoherence( 3 );
+    testBodySets();
+    testSweptSplit();
+    testThinObstacle();
+    testChainJacobians();
+    testChainCache();
+    testProjectFixed();
+
+    if ( failures ){
+        printf( "%d checks failed\n", failures );
+        return 1;
+    }
+
+    printf( "all checks passed\n" );
+    return 0;
+}
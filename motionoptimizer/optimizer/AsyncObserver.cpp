@@ -0,0 +1,208 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "AsyncObserver.h"
+
+namespace mopt {
+
+const char * AsyncObserver::TAG = "AsyncObserver";
+
+AsyncObserver::AsyncObserver( SnapshotObserver * target, 
+                              size_t pool_size ) :
+    target( target ),
+    pool( pool_size > 0 ? pool_size : 1 ),
+    free_list( pool.size() ),
+    queue( pool.size() ),
+    free_begin( 0 ),
+    free_count( pool.size() ),
+    queue_begin( 0 ),
+    queue_count( 0 ),
+    busy( false ),
+    stopping( false ),
+    threaded( false ),
+    dropped( 0 )
+{
+    for ( size_t i = 0; i < pool.size(); ++i ){ free_list[i] = i; }
+
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &work_cond, NULL );
+    pthread_cond_init( &done_cond, NULL );
+    
+    threaded = ( pthread_create( &thread, NULL, run, this ) == 0 );
+    if ( !threaded ){
+        debug_status( TAG, "AsyncObserver", "no thread, delivering "
+                      "synchronously" );
+    }
+}
+
+AsyncObserver::~AsyncObserver()
+{
+    if ( threaded ){
+        pthread_mutex_lock( &mutex );
+        stopping = true;
+        pthread_cond_signal( &work_cond );
+        pthread_mutex_unlock( &mutex );
+    
+        pthread_join( thread, NULL );
+    }
+
+    pthread_cond_destroy( &done_cond );
+    pthread_cond_destroy( &work_cond );
+    pthread_mutex_destroy( &mutex );
+}
+
+int AsyncObserver::notify( const OptimizerBase & opt,
+                           EventType event,
+                           size_t iter,
+                           double current_objective,
+                           double last_objective,
+                           double constraint_magnitude )
+{
+    if ( !threaded ){
+        fill( pool[0], opt, event, iter, 
+              current_objective, last_objective, constraint_magnitude );
+        if ( target && target->notify( pool[0] ) ){ cancel(); }
+        return isCancelled();
+    }
+
+    const bool must_deliver = !( ITERATION_EVENTS & eventBit( event ) );
+    
+    pthread_mutex_lock( &mutex );
+    
+    while ( free_count == 0 && must_deliver ){
+        pthread_cond_wait( &done_cond, &mutex );
+    }
+
+    if ( free_count == 0 ){
+        dropped ++;
+        pthread_mutex_unlock( &mutex );
+        return isCancelled();
+    }
+    
+    const size_t index = free_list[ free_begin ];
+    free_begin = ( free_begin + 1 ) % free_list.size();
+    free_count --;
+
+    pthread_mutex_unlock( &mutex );
+    
+    //the snapshot is owned by this thread until it is queued.
+    fill( pool[ index ], opt, event, iter,
+          current_objective, last_objective, constraint_magnitude );
+
+    pthread_mutex_lock( &mutex );
+    queue[ (queue_begin + queue_count) % queue.size() ] = index;
+    queue_count ++;
+    pthread_cond_signal( &work_cond );
+    pthread_mutex_unlock( &mutex );
+
+    return isCancelled();
+}
+
+void AsyncObserver::fill( ObserverSnapshot & snapshot,
+                          const OptimizerBase & opt,
+                          EventType event,
+                          size_t iter,
+                          double current_objective,
+                          double last_objective,
+                          double constraint_magnitude ) const
+{
+    //the vector keeps its capacity, so this only allocates the
+    //  first time a snapshot sees a larger trajectory.
+    snapshot.event = event;
+    snapshot.iteration = iter;
+    snapshot.level = opt.problem.getProfiler().getLevel();
+    snapshot.current_objective = current_objective;
+    snapshot.last_objective = last_objective;
+    snapshot.constraint_magnitude = constraint_magnitude;
+    snapshot.N = opt.problem.N();
+    snapshot.M = opt.problem.M();
+    opt.problem.getTrajectory().copyDataTo( snapshot.trajectory );
+}
+
+void AsyncObserver::wait()
+{
+    pthread_mutex_lock( &mutex );
+    while ( queue_count > 0 || busy ){
+        pthread_cond_wait( &done_cond, &mutex );
+    }
+    pthread_mutex_unlock( &mutex );
+}
+
+size_t AsyncObserver::getDropped()
+{
+    pthread_mutex_lock( &mutex );
+    const size_t d = dropped;
+    pthread_mutex_unlock( &mutex );
+    return d;
+}
+
+void * AsyncObserver::run( void * data )
+{
+    static_cast< AsyncObserver * >( data )->process();
+    return NULL;
+}
+
+void AsyncObserver::process()
+{
+    pthread_mutex_lock( &mutex );
+
+    while ( true ){
+        
+        while ( queue_count == 0 && !stopping ){
+            pthread_cond_wait( &work_cond, &mutex );
+        }
+        
+        //deliver everything that is queued before stopping.
+        if ( queue_count == 0 ){ break; }
+
+        const size_t index = queue[ queue_begin ];
+        queue_begin = ( queue_begin + 1 ) % queue.size();
+        queue_count --;
+        busy = true;
+
+        pthread_mutex_unlock( &mutex );
+        
+        if ( target && target->notify( pool[index] ) ){ cancel(); }
+
+        pthread_mutex_lock( &mutex );
+        
+        free_list[ (free_begin + free_count) % free_list.size() ] = index;
+        free_count ++;
+        busy = false;
+        pthread_cond_broadcast( &done_cond );
+    }
+
+    pthread_mutex_unlock( &mutex );
+}
+
+}//namespace
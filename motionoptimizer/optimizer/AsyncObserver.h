@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _ASYNC_OBSERVER_H_
+#define _ASYNC_OBSERVER_H_
+
+#include <pthread.h>
+#include "OptimizerBase.h"
+
+namespace mopt {
+
+/**
+ * \struct ObserverSnapshot
+ * A copy of the state of an optimizer at one event, which can be
+ * looked at while the optimizer keeps running.
+ */
+struct ObserverSnapshot {
+    EventType event;
+    size_t iteration;
+    int level;
+    double current_objective, last_objective, constraint_magnitude;
+    
+    int N, M;
+    std::vector< double > trajectory; ///< N x M, column major
+
+    ConstMatMap getTrajectory() const {
+        return ConstMatMap( trajectory.data(), N, M );
+    }
+};
+
+/**
+ * \class SnapshotObserver
+ * The interface for observers that run on the background thread of
+ * an AsyncObserver.
+ */
+class SnapshotObserver {
+  public:
+    virtual ~SnapshotObserver(){}
+    
+    /** Returning nonzero cancels the optimization. */
+    virtual int notify( const ObserverSnapshot & snapshot ) = 0;
+};
+
+/**
+ * \class AsyncObserver
+ * Copies the trajectory at every event into one of a fixed pool of
+ * snapshots and hands it to a background thread that calls the
+ * SnapshotObserver, so slow observers (drawing, file I/O) do not
+ * stall the optimizer. 
+ *
+ * When every snapshot is in use, iteration events are dropped and
+ * counted, but INIT, FINISH and TIMEOUT wait for a free snapshot, so
+ * they are always delivered. The optimizer stops at its next event
+ * after the SnapshotObserver returns nonzero or cancel() is called.
+ * If the background thread cannot be started, every event is
+ * delivered synchronously instead.
+ */
+class AsyncObserver : public Observer {
+
+    SnapshotObserver * target;
+
+    std::vector< ObserverSnapshot > pool;
+
+    //indices into the pool, both used as rings.
+    std::vector< size_t > free_list, queue;
+    size_t free_begin, free_count;
+    size_t queue_begin, queue_count;
+    
+    //set when the background thread is running the target.
+    bool busy;
+    bool stopping;
+    bool threaded;
+    size_t dropped;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond, done_cond;
+    
+    static const char * TAG;
+
+  public:
+    
+    AsyncObserver( SnapshotObserver * target, size_t pool_size = 4 );
+
+    /** Delivers the snapshots that are still queued, and stops the
+     *  background thread.
+     */
+    virtual ~AsyncObserver();
+
+    virtual int notify( const OptimizerBase & opt,
+                        EventType event,
+                        size_t iter,
+                        double current_objective,
+                        double last_objective,
+                        double constraint_magnitude );
+
+    /** Waits until every queued snapshot has been delivered. */
+    void wait();
+
+    /** The number of iteration events that were dropped because
+     *  the pool was exhausted.
+     */
+    size_t getDropped();
+
+  private:
+    
+    void fill( ObserverSnapshot & snapshot,
+               const OptimizerBase & opt,
+               EventType event,
+               size_t iter,
+               double current_objective,
+               double last_objective,
+               double constraint_magnitude ) const;
+
+    static void * run( void * data );
+    void process();
+
+};
+
+}//namespace
+
+#endif
@@ -66,6 +66,7 @@ void ChompOptimizer::optimize() {
     if (H.rows() == 0) {
         debug_status( TAG, "optimize" , "start unconstrained" );
         if ( !problem.isCovariant() ){
+            ProfileScope scope( problem.getProfiler(), PROFILE_METRIC_SOLVE );
             problem.getMetric().solve( g );
         }
       
@@ -104,7 +105,11 @@ void ChompOptimizer::optimize() {
 
             P = H;
             
-            problem.getMetric().solve( MatMap(P.data(), N, M * P.cols()) );
+            {
+                ProfileScope scope( problem.getProfiler(),
+                                    PROFILE_METRIC_SOLVE );
+                problem.getMetric().solve( MatMap(P.data(), N, M*P.cols()) );
+            }
             
             debug_status( TAG, "optimize", "after first skyline" );
 
@@ -128,8 +133,12 @@ void ChompOptimizer::optimize() {
             W = (MatX::Identity(newsize,newsize) - H * Y)
                 * MatMap(g.data(), newsize, 1) * alpha;
 
-            problem.getMetric().solve(
-                    MatMap(W.data(), N, M * W.cols()) );
+            {
+                ProfileScope scope( problem.getProfiler(),
+                                    PROFILE_METRIC_SOLVE );
+                problem.getMetric().solve(
+                        MatMap(W.data(), N, M * W.cols()) );
+            }
 
             Y = cholSolver.solve(h);
 
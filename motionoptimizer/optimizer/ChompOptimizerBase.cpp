@@ -137,6 +137,7 @@ bool ChompOptimizerBase::checkFinished(EventType event)
 
 
     if ( canTimeout && stop_time < TimeStamp::now() ) {
+        stop_reason = STOP_TIMEOUT;
         notify(TIMEOUT);
         return false;
     }
@@ -151,6 +152,9 @@ bool ChompOptimizerBase::checkFinished(EventType event)
     if (greater_than_max || ( greater_than_min && converged ) ||
         observer_flag )
     {
+        if ( observer_flag ){ stop_reason = STOP_OBSERVER; }
+        else if ( greater_than_max ){ stop_reason = STOP_MAX_ITERATIONS; }
+        else { stop_reason = STOP_CONVERGED; }
         return false;
     } 
 
@@ -179,6 +183,8 @@ void ChompOptimizerBase::checkBounds()
     //if there are bounds to check, check for the violations.
     if ( !check_upper || !check_lower ){ return; }
 
+    ProfileScope scope( problem.getProfiler(), PROFILE_BOUNDS );
+
     bool violation = true;
 
     //Terminate if it does more than 10 iterations of bounds 
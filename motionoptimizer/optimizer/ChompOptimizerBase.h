@@ -85,6 +85,8 @@ class ChompOptimizerBase : public OptimizerBase{
     inline void setAlpha( double a ){ alpha = a; }
     inline double getAlpha( ){ return alpha ; }
 
+    double getStepSize() const { return alpha; }
+
   protected:
 
     virtual void optimize()=0;
@@ -45,9 +45,27 @@ const std::string getNLoptReturnString( nlopt::result & result ){
     if ( result == nlopt::XTOL_REACHED  ){ return "XTOL_REACHED "; }
     if ( result == nlopt::MAXEVAL_REACHED ){ return "MAXEVAL_REACHED"; }
     if ( result == nlopt::MAXTIME_REACHED ){ return "MAXTIME_REACHED"; }
+    if ( result == nlopt::FAILURE ){ return "FAILURE"; }
+    if ( result == nlopt::INVALID_ARGS ){ return "INVALID_ARGS"; }
+    if ( result == nlopt::OUT_OF_MEMORY ){ return "OUT_OF_MEMORY"; }
+    if ( result == nlopt::ROUNDOFF_LIMITED ){ return "ROUNDOFF_LIMITED"; }
+    if ( result == nlopt::FORCED_STOP ){ return "FORCED_STOP"; }
     return "UNKNOWN_RESULT";
 }
 
+static StopReason getNLoptStopReason( nlopt::result result ){
+    switch ( result ){
+        case nlopt::SUCCESS:
+        case nlopt::STOPVAL_REACHED:
+        case nlopt::FTOL_REACHED:
+        case nlopt::XTOL_REACHED:     return STOP_CONVERGED;
+        case nlopt::MAXEVAL_REACHED:  return STOP_MAX_ITERATIONS;
+        case nlopt::MAXTIME_REACHED:  return STOP_TIMEOUT;
+        case nlopt::FORCED_STOP:      return STOP_OBSERVER;
+        default:                      return STOP_FAILURE;
+    }
+}
+
 
 NLOptimizer::NLOptimizer( ProblemDescription & problem,
                           Observer * observer,
@@ -110,9 +128,17 @@ void NLOptimizer::solve()
         double objective_value;
         result = optimizer.optimize(optimization_vector, objective_value);
         current_objective = objective_value;
+    }catch( nlopt::roundoff_limited & e ){
+        result = nlopt::ROUNDOFF_LIMITED;
+    }catch( nlopt::forced_stop & e ){
+        result = nlopt::FORCED_STOP;
     }catch( std::exception & e ){
         std::cout << "Caught exception: " << e.what() << std::endl;
+        result = nlopt::FAILURE;
     }
+
+    stop_reason = getNLoptStopReason( result );
+    stop_message = getNLoptReturnString( result );
     
     debug_status( TAG, "solve", "post-optimize" );
     
@@ -226,7 +252,8 @@ double NLOptimizer::objectiveFunction(unsigned n,
     opt->current_objective = opt->problem.evaluateObjective( x, grad );
     
     //TODO - report the constraint violations
-    opt->notify( event );
+    //a forced stop makes nlopt return FORCED_STOP.
+    if ( opt->notify( event ) ){ throw nlopt::forced_stop(); }
     
     opt->current_iteration ++;
 
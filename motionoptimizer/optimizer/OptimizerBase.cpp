@@ -43,19 +43,42 @@ OptimizerBase::OptimizerBase(ProblemDescription & problem,
                              size_t max_iter):
     problem( problem ),
     observer( observer ),
+    telemetry( NULL ),
     obstol( obstol ),
     timeout_seconds( timeout ),
     max_iter( max_iter ),
     last_objective( HUGE_VAL ),
     current_objective( HUGE_VAL ),
     constraint_magnitude( HUGE_VAL ),
-    current_iteration( 0 )
+    current_iteration( 0 ),
+    stop_reason( STOP_NONE )
 {
 }
 
 int OptimizerBase::notify(EventType event) const
 {
+    if ( telemetry ){
+        const Profiler & profiler = problem.getProfiler();
+        
+        TelemetryRecord r;
+        r.time = Profiler::now() - telemetry->getStartTime();
+        r.level = profiler.getLevel();
+        r.iteration = current_iteration;
+        r.event = event;
+        r.N = problem.N();
+        r.objective = current_objective;
+        r.constraint = constraint_magnitude;
+        r.step = getStepSize();
+        r.objective_nsec = profiler.getNanoseconds( PROFILE_OBJECTIVE );
+        r.collision_nsec = profiler.getNanoseconds( PROFILE_COLLISION );
+        r.metric_nsec = profiler.getNanoseconds( PROFILE_METRIC_SOLVE );
+        telemetry->record( r );
+    }
+
     if (observer) {
+        if ( observer->isCancelled() ){ return 1; }
+        if ( !observer->wants( event, current_iteration ) ){ return 0; }
+
         return observer->notify(*this, event, current_iteration, 
                                 current_objective, last_objective,
                                 constraint_magnitude);
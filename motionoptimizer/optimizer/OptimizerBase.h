@@ -36,6 +36,8 @@
 
 #include "../utils/utils.h"
 #include "../utils/Observer.h"
+#include "../utils/SolveStats.h"
+#include "../utils/Telemetry.h"
 #include "../containers/ProblemDescription.h"
 
 namespace mopt {
@@ -50,6 +52,9 @@ class OptimizerBase{
     
     ProblemDescription & problem;
     Observer * observer;
+    
+    //if this is not NULL, every event is recorded into it.
+    TelemetrySink * telemetry;
 
     double obstol, timeout_seconds;
     size_t max_iter;
@@ -57,6 +62,10 @@ class OptimizerBase{
     double last_objective, current_objective, constraint_magnitude;
     size_t current_iteration;
 
+    //why the optimizer stopped, filled in by the 
+    //  inheriting class.
+    StopReason stop_reason;
+    std::string stop_message;
     
     OptimizerBase( ProblemDescription & problem,
                    Observer * observer = NULL,
@@ -68,6 +77,9 @@ class OptimizerBase{
 
     virtual void solve()=0;
 
+    //the current step size, if the optimizer has one.
+    virtual double getStepSize() const { return 0.0; }
+
     //notify the observer
     int notify(EventType event) const;
     
@@ -129,6 +129,7 @@ void TestOptimizer::optimize()
         debug_status( TAG, "optimize" , "start unconstrained" );
         
         if (!problem.isCovariant() ){
+            ProfileScope scope( problem.getProfiler(), PROFILE_METRIC_SOLVE );
             metric.solve( g );
         }
         
@@ -159,7 +160,11 @@ void TestOptimizer::optimize()
         }else {
             P = H;
             
-            metric.solve( MatMap( P.data(), N, M * P.cols() ) );
+            {
+                ProfileScope scope( problem.getProfiler(),
+                                    PROFILE_METRIC_SOLVE );
+                metric.solve( MatMap( P.data(), N, M * P.cols() ) );
+            }
 
             //debug << "H = \n" << H << "\n";
             //debug << "P = \n" << P << "\n";
@@ -182,7 +187,11 @@ void TestOptimizer::optimize()
             W = (MatX::Identity(newsize,newsize) - H * Y)
                 * g_flat * alpha;
 
-            metric.solve( MatMap( W.data(), N, M * W.cols() ) );
+            {
+                ProfileScope scope( problem.getProfiler(),
+                                    PROFILE_METRIC_SOLVE );
+                metric.solve( MatMap( W.data(), N, M * W.cols() ) );
+            }
 
             Y = cholSolver.solve(h);
 
@@ -237,6 +246,7 @@ bool TestOptimizer::checkFinished(EventType event)
 
 
     if ( canTimeout && stop_time < TimeStamp::now() ) {
+        stop_reason = STOP_TIMEOUT;
         notify(TIMEOUT);
         return false;
     }
@@ -251,6 +261,9 @@ bool TestOptimizer::checkFinished(EventType event)
     if (greater_than_max || ( greater_than_min && converged ) ||
         observer_flag )
     {
+        if ( observer_flag ){ stop_reason = STOP_OBSERVER; }
+        else if ( greater_than_max ){ stop_reason = STOP_MAX_ITERATIONS; }
+        else { stop_reason = STOP_CONVERGED; }
         return false;
     } 
 
@@ -279,6 +292,8 @@ void TestOptimizer::checkBounds()
     //if there are bounds to check, check for the violations.
     if ( !check_upper || !check_lower ){ return; }
 
+    ProfileScope scope( problem.getProfiler(), PROFILE_BOUNDS );
+
     bool violation = true;
 
     //Terminate if it does more than 10 iterations of bounds 
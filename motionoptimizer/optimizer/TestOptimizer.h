@@ -90,6 +90,8 @@ class TestOptimizer : public OptimizerBase{
     inline void setAlpha( double a ){ alpha = a; }
     inline double getAlpha( ){ return alpha ; }
 
+    double getStepSize() const { return alpha; }
+
 
     
   private:
@@ -0,0 +1,233 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "AsyncObserver.h"
+#include <stdio.h>
+
+using namespace mopt;
+
+static int failures = 0;
+
+static void check( bool ok, const char * what ){
+    if ( !ok ){
+        printf( "FAIL: %s\n", what );
+        ++failures;
+    }
+}
+
+//an optimizer that only sends the events it is told to
+class EventSource : public OptimizerBase {
+  public:
+    EventSource( ProblemDescription & problem, Observer * observer ) :
+        OptimizerBase( problem, observer )
+    {}
+
+    virtual void solve(){}
+
+    int send( EventType event, size_t iter ){
+        current_iteration = iter;
+        current_objective = iter;
+        return notify( event );
+    }
+};
+
+//records what it is given, and can be made to block until released
+class Recorder : public SnapshotObserver {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool blocking, entered;
+
+  public:
+    std::vector< EventType > events;
+    std::vector< size_t > iterations;
+    bool same_trajectory;
+    const Trajectory * trajectory;
+
+    Recorder( const Trajectory * trajectory ) :
+        blocking( false ), entered( false ),
+        same_trajectory( true ), trajectory( trajectory )
+    {
+        pthread_mutex_init( &mutex, NULL );
+        pthread_cond_init( &cond, NULL );
+    }
+
+    ~Recorder(){
+        pthread_cond_destroy( &cond );
+        pthread_mutex_destroy( &mutex );
+    }
+
+    void block(){
+        pthread_mutex_lock( &mutex );
+        blocking = true;
+        entered = false;
+        pthread_mutex_unlock( &mutex );
+    }
+
+    //waits until notify is blocked
+    void waitEntered(){
+        pthread_mutex_lock( &mutex );
+        while ( !entered ){ pthread_cond_wait( &cond, &mutex ); }
+        pthread_mutex_unlock( &mutex );
+    }
+
+    void release(){
+        pthread_mutex_lock( &mutex );
+        blocking = false;
+        pthread_cond_broadcast( &cond );
+        pthread_mutex_unlock( &mutex );
+    }
+
+    virtual int notify( const ObserverSnapshot & snapshot ){
+        pthread_mutex_lock( &mutex );
+        entered = true;
+        pthread_cond_broadcast( &cond );
+        while ( blocking ){ pthread_cond_wait( &cond, &mutex ); }
+        pthread_mutex_unlock( &mutex );
+
+        events.push_back( snapshot.event );
+        iterations.push_back( snapshot.iteration );
+        if ( snapshot.N != trajectory->N() ||
+             snapshot.M != trajectory->M() ||
+             snapshot.getTrajectory() != trajectory->getXi() ){
+            same_trajectory = false;
+        }
+        return 0;
+    }
+};
+
+static void initialize( ProblemDescription & problem ){
+    MatX q0( 1, 2 ), q1( 1, 2 );
+    q0 << 0, 0;
+    q1 << 1, 2;
+    problem.getTrajectory().initialize( q0, q1, 15 );
+}
+
+//iteration events are dropped while every snapshot is in use, INIT
+//  and FINISH never are.
+static void testDropped(){
+    ProblemDescription problem;
+    initialize( problem );
+
+    Recorder recorder( &problem.getTrajectory() );
+    AsyncObserver async( &recorder, 2 );
+    EventSource source( problem, &async );
+
+    recorder.block();
+    source.send( INIT, 0 );
+    recorder.waitEntered();
+
+    //one snapshot is left for the first of these
+    for ( size_t i = 1; i <= 10; ++i ){ source.send( CHOMP_ITER, i ); }
+    check( async.getDropped() == 9, "wrong number of dropped events" );
+
+    recorder.release();
+    source.send( FINISH, 11 );
+    async.wait();
+
+    check( recorder.events.size() == 3 &&
+           recorder.events[0] == INIT &&
+           recorder.events[1] == CHOMP_ITER && 
+           recorder.iterations[1] == 1 &&
+           recorder.events[2] == FINISH,
+           "wrong events delivered while the pool was full" );
+    check( recorder.same_trajectory, "the snapshot trajectory differs" );
+}
+
+//with setSampleEvery, only every k-th iteration event is delivered
+static void testSampling(){
+    ProblemDescription problem;
+    initialize( problem );
+
+    Recorder recorder( &problem.getTrajectory() );
+    AsyncObserver async( &recorder, 16 );
+    async.setSampleEvery( 3 );
+    EventSource source( problem, &async );
+
+    source.send( INIT, 0 );
+    for ( size_t i = 1; i <= 10; ++i ){ source.send( CHOMP_ITER, i ); }
+    source.send( FINISH, 10 );
+    async.wait();
+
+    const size_t expected[] = { 0, 3, 6, 9, 10 };
+    bool same = recorder.iterations.size() == 5;
+    for ( size_t i = 0; same && i < 5; ++i ){
+        same = recorder.iterations[i] == expected[i];
+    }
+    check( same, "sampling delivered the wrong iterations" );
+    check( async.getDropped() == 0, "sampling dropped events" );
+}
+
+//cancel() stops the optimizer at its next event even while the
+//  background thread is stuck in the observer.
+static void testCancel(){
+    ProblemDescription problem;
+    initialize( problem );
+
+    Recorder recorder( &problem.getTrajectory() );
+    AsyncObserver async( &recorder, 4 );
+    EventSource source( problem, &async );
+
+    recorder.block();
+    check( source.send( INIT, 0 ) == 0, "stopped before cancel" );
+    recorder.waitEntered();
+
+    async.cancel();
+    check( source.send( CHOMP_ITER, 1 ) != 0,
+           "cancel did not stop the optimizer while the observer was busy" );
+
+    recorder.release();
+    async.wait();
+
+    check( recorder.events.size() == 1,
+           "an event was delivered after cancel" );
+
+    //the next solve starts over
+    async.resetCancel();
+    check( source.send( INIT, 0 ) == 0, "resetCancel did not clear it" );
+    async.wait();
+}
+
+int main( int argc, char ** argv ){
+
+    testDropped();
+    testSampling();
+    testCancel();
+
+    if ( failures ){
+        printf( "%d checks failed\n", failures );
+        return 1;
+    }
+
+    printf( "all checks passed\n" );
+    return 0;
+}
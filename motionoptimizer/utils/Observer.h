@@ -3,14 +3,69 @@
 
 #include "utils.h"
 
+#include <stdio.h>
+
 namespace mopt {
 
 //Forward declaration of optimizer base
 class OptimizerBase;
 
+/** The bit of an event in an Observer event mask. */
+inline unsigned int eventBit( EventType event ){ return 1u << event; }
+
+/** An event mask that subscribes to every event. */
+const unsigned int ALL_EVENTS = ~0u;
+
+/** The events that happen once per iteration. */
+const unsigned int ITERATION_EVENTS = ( (1u << CHOMP_ITER) |
+                                        (1u << CHOMP_LOCAL_ITER) |
+                                        (1u << NLOPT_ITER) );
+
+/**
+ * \class Observer
+ * Gets notified of the events of an optimizer. The event mask and
+ * the sampling interval decide which events reach notify(), the
+ * others are skipped without a virtual call. Returning nonzero from
+ * notify(), or calling cancel() from any thread, stops the
+ * optimization.
+ */
 class Observer {
+  private:
+    unsigned int event_mask;
+    size_t every;
+    int cancelled;
+
   public:
+    Observer() : event_mask( ALL_EVENTS ), every( 1 ), cancelled( 0 ) {}
     virtual ~Observer(){}
+
+    /** Only events whose eventBit() is in mask are delivered. */
+    void setEventMask( unsigned int mask ){ event_mask = mask; }
+    unsigned int getEventMask() const { return event_mask; }
+    
+    /** Only deliver every k-th iteration event. */
+    void setSampleEvery( size_t k ){ every = ( k > 0 ? k : 1 ); }
+    size_t getSampleEvery() const { return every; }
+
+    /** Does the observer want to be notified of this event? */
+    inline bool wants( EventType event, size_t iter ) const {
+        if ( !(event_mask & eventBit( event )) ){ return false; }
+        if ( every > 1 && (ITERATION_EVENTS & eventBit( event )) ){
+            return iter % every == 0;
+        }
+        return true;
+    }
+
+    /** Asks the optimizer to stop at its next event, thread safe.
+     *  MotionOptimizer::solve() clears it when it starts, so a
+     *  cancel only affects the solve that is running.
+     */
+    void cancel(){ __atomic_store_n( &cancelled, 1, __ATOMIC_RELEASE ); }
+    void resetCancel(){ __atomic_store_n( &cancelled, 0, __ATOMIC_RELEASE );}
+    bool isCancelled() const {
+        return __atomic_load_n( &cancelled, __ATOMIC_ACQUIRE );
+    }
+
     virtual int notify(const OptimizerBase& opt, 
                        EventType event,
                        size_t iter,
@@ -32,8 +87,22 @@ class DebugObserver: public Observer {
                        double lastObjective,
                        double constraintViolation)
     {
+        return print( e, iter, curObjective, lastObjective,
+                      constraintViolation );
+    }
+
+    /** Prints one event, returning nonzero if the objective is not
+     *  finite. Also used by observers that do not get an optimizer,
+     *  such as a SnapshotObserver.
+     */
+    static int print(EventType e,
+                     size_t iter,
+                     double curObjective,
+                     double lastObjective,
+                     double constraintViolation)
+    {
             
-         std::string event_string;
+         const char * event_string;
 
          switch (e) {
             case INIT:
@@ -52,15 +121,15 @@ class DebugObserver: public Observer {
                  event_string = "[INVALID]"; break;
          }
 
-         std::cout << "debug: "
-              << "event=" << event_string << ", "
-              << "iter=" << iter << ", "
-              << "cur=" << std::setprecision(10) << curObjective << ", "
-              << "last=" << std::setprecision(10) << lastObjective << ", "
-              << "rel=" << std::setprecision(10)
-              << ((lastObjective-curObjective)/curObjective) << ", "
-              << "constraint=" << std::setprecision(10)
-              << constraintViolation << "\n";
+         //a single formatted write, rather than a chain of stream
+         //  insertions and precision changes for every event.
+         printf( "debug: event=%s, iter=%lu, cur=%.10g, last=%.10g, "
+                 "rel=%.10g, constraint=%.10g\n",
+                 event_string, (unsigned long) iter,
+                 curObjective, lastObjective,
+                 (lastObjective-curObjective)/curObjective,
+                 constraintViolation );
+
         if ( e != INIT && e != FINISH && 
             (std::isnan(curObjective) || std::isinf(curObjective) ||
              std::isnan(lastObjective) || std::isinf(lastObjective)) )
@@ -0,0 +1,210 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#ifdef __APPLE__
+    #include <mach/mach_time.h>
+#endif
+
+namespace mopt {
+
+/**
+ * \enum ProfilePhase
+ * The parts of an optimization that the Profiler keeps track of.
+ * Objective evaluation includes the time spent in the collision
+ * function, the other phases do not overlap.
+ */
+enum ProfilePhase {
+    PROFILE_OBJECTIVE,    ///< smoothness + collision objective and gradient
+    PROFILE_COLLISION,    ///< the collision function alone
+    PROFILE_METRIC_SOLVE, ///< solves against the smoothness metric
+    PROFILE_CONSTRAINT,   ///< constraint evaluation
+    PROFILE_BOUNDS,       ///< bounds checking and correction
+    PROFILE_NUM_PHASES
+};
+
+/**
+ * \class Profiler
+ * Always-on accounting of where the time in a solve goes, broken down
+ * by multigrid level and by ProfilePhase. Counters are indexed by
+ * enum, so recording a sample is two reads of a monotonic clock and
+ * two additions. Every ProblemDescription owns its own Profiler and
+ * is only ever driven by the thread that is solving it, so several
+ * optimizers running on several threads each accumulate into their
+ * own counters without any locking.
+ */
+class Profiler {
+
+  public:
+
+    /** Number of multigrid levels that are tracked separately. Deeper
+     *  levels are accumulated into the last one.
+     */
+    enum { MAX_LEVELS = 16 };
+
+    struct Counter {
+        uint64_t nsec;
+        uint64_t count;
+    };
+
+  private:
+
+    Counter counters[MAX_LEVELS][PROFILE_NUM_PHASES];
+    int level, max_level;
+    uint64_t start_time;
+
+  public:
+
+    Profiler(){ reset(); }
+
+    /** Clears all counters and restarts the wall clock. */
+    void reset(){
+        for ( int i = 0; i < MAX_LEVELS; ++i ){
+            for ( int j = 0; j < PROFILE_NUM_PHASES; ++j ){
+                counters[i][j].nsec = 0;
+                counters[i][j].count = 0;
+            }
+        }
+        level = 0;
+        max_level = 0;
+        start_time = now();
+    }
+
+    /** Nanoseconds from an arbitrary, monotonic origin. */
+    static inline uint64_t now(){
+#ifdef __APPLE__
+        static mach_timebase_info_data_t info = { 0, 0 };
+        if ( info.denom == 0 ){ mach_timebase_info( &info ); }
+        return mach_absolute_time() * info.numer / info.denom;
+#else
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    /** Sets the multigrid level that subsequent samples go to. */
+    void setLevel( int l ){
+        level = ( l < 0 ? 0 : (l >= MAX_LEVELS ? MAX_LEVELS-1 : l) );
+        if ( level > max_level ){ max_level = level; }
+    }
+    int getLevel() const { return level; }
+    
+    /** The number of levels that have been profiled so far. */
+    int numLevels() const { return max_level + 1; }
+
+    inline void add( ProfilePhase phase, uint64_t nsec ){
+        Counter & c = counters[level][phase];
+        c.nsec += nsec;
+        c.count ++;
+    }
+
+    const Counter & getCounter( ProfilePhase phase, int l ) const {
+        return counters[l][phase];
+    }
+    
+    /** Seconds spent in the given phase, on the given level or on all
+     *  levels if level is negative.
+     */
+    double getSeconds( ProfilePhase phase, int l = -1 ) const {
+        return getNanoseconds( phase, l ) * 1e-9;
+    }
+
+    uint64_t getNanoseconds( ProfilePhase phase, int l = -1 ) const {
+        if ( l >= 0 ){ return counters[l][phase].nsec; }
+        uint64_t total = 0;
+        for ( int i = 0; i <= max_level; ++i ){
+            total += counters[i][phase].nsec;
+        }
+        return total;
+    }
+
+    /** Number of times the given phase ran on the given level, or on
+     *  all levels if level is negative.
+     */
+    uint64_t getCount( ProfilePhase phase, int l = -1 ) const {
+        if ( l >= 0 ){ return counters[l][phase].count; }
+        uint64_t total = 0;
+        for ( int i = 0; i <= max_level; ++i ){
+            total += counters[i][phase].count;
+        }
+        return total;
+    }
+
+    /** Wall clock seconds since construction or the last reset. */
+    double getWallSeconds() const {
+        return (now() - start_time) * 1e-9;
+    }
+
+    static const char * phaseToString( ProfilePhase phase ){
+        switch ( phase ){
+            case PROFILE_OBJECTIVE:    return "gradient";
+            case PROFILE_COLLISION:    return "collision";
+            case PROFILE_METRIC_SOLVE: return "metric";
+            case PROFILE_CONSTRAINT:   return "constraint";
+            case PROFILE_BOUNDS:       return "bounds";
+            default:                   return "invalid";
+        }
+    }
+
+};
+
+/**
+ * \class ProfileScope
+ * Adds the lifetime of the object to a phase of a Profiler. 
+ */
+class ProfileScope {
+    Profiler & profiler;
+    const ProfilePhase phase;
+    const uint64_t start;
+
+  public:
+    ProfileScope( Profiler & profiler, ProfilePhase phase ) :
+        profiler( profiler ),
+        phase( phase ),
+        start( Profiler::now() )
+    {}
+
+    ~ProfileScope(){ profiler.add( phase, Profiler::now() - start ); }
+};
+
+}// namespace
+
+#endif 
@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _SOLVE_STATS_H_
+#define _SOLVE_STATS_H_
+
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mopt {
+
+/**
+ * \enum StopReason
+ * Why a stage of optimization ended.
+ */
+enum StopReason {
+    STOP_NONE,           ///< the stage has not run, or has not ended
+    STOP_CONVERGED,      ///< the relative change of the objective, or
+                         /// of the variables, went below tolerance
+    STOP_MAX_ITERATIONS, ///< the iteration or evaluation limit was hit
+    STOP_TIMEOUT,        ///< the time limit was hit
+    STOP_OBSERVER,       ///< the observer asked the optimizer to stop
+    STOP_FAILURE         ///< the optimizer gave up, see stop_message
+};
+
+inline const char * stopReasonToString( StopReason reason )
+{
+    switch ( reason ){
+        case STOP_NONE:           return "NONE";
+        case STOP_CONVERGED:      return "CONVERGED";
+        case STOP_MAX_ITERATIONS: return "MAX_ITERATIONS";
+        case STOP_TIMEOUT:        return "TIMEOUT";
+        case STOP_OBSERVER:       return "OBSERVER";
+        case STOP_FAILURE:        return "FAILURE";
+        default:                  return "INVALID";
+    }
+}
+
+/**
+ * \struct StageStats
+ * Statistics for one call of an optimizer, i.e. one stage of the
+ * multigrid solve. The evaluation counts come from the Profiler.
+ */
+struct StageStats {
+    int level;               ///< number of upsamplings before the stage
+    int N;                   ///< trajectory length during the stage
+    bool subsampled;
+    std::string algorithm;
+
+    size_t iterations;
+    uint64_t objective_evaluations;
+    uint64_t collision_evaluations;
+    uint64_t constraint_evaluations;
+    uint64_t metric_solves;
+
+    double final_objective;
+    double constraint_magnitude;
+    double seconds;
+
+    StopReason stop_reason;
+    std::string stop_message; ///< extra information, i.e. the NLopt result
+
+    StageStats() :
+        level( 0 ), N( 0 ), subsampled( false ),
+        iterations( 0 ),
+        objective_evaluations( 0 ), collision_evaluations( 0 ),
+        constraint_evaluations( 0 ), metric_solves( 0 ),
+        final_objective( 0 ), constraint_magnitude( 0 ), seconds( 0 ),
+        stop_reason( STOP_NONE )
+    {}
+};
+
+/**
+ * \struct SolveStats
+ * Everything that happened during a call to MotionOptimizer::solve(),
+ * one entry per stage in the order the stages ran.
+ */
+struct SolveStats {
+    std::vector< StageStats > stages;
+    double seconds;
+
+    SolveStats() : seconds( 0 ) {}
+
+    void clear(){ stages.clear(); seconds = 0; }
+
+    size_t totalIterations() const {
+        size_t total = 0;
+        for ( size_t i = 0; i < stages.size(); ++i ){
+            total += stages[i].iterations;
+        }
+        return total;
+    }
+
+    uint64_t totalObjectiveEvaluations() const {
+        uint64_t total = 0;
+        for ( size_t i = 0; i < stages.size(); ++i ){
+            total += stages[i].objective_evaluations;
+        }
+        return total;
+    }
+
+    /** The reason the final stage stopped. */
+    StopReason stopReason() const {
+        return stages.empty() ? STOP_NONE : stages.back().stop_reason;
+    }
+
+    void print( std::ostream & ostr = std::cout ) const {
+        for ( size_t i = 0; i < stages.size(); ++i ){
+            const StageStats & s = stages[i];
+            ostr << "stage " << i 
+                 << ": level=" << s.level 
+                 << ", N=" << s.N
+                 << ( s.subsampled ? " (subsampled)" : "" )
+                 << ", algorithm=" << s.algorithm
+                 << ", iter=" << s.iterations
+                 << ", objective_evals=" << s.objective_evaluations
+                 << ", collision_evals=" << s.collision_evaluations
+                 << ", constraint_evals=" << s.constraint_evaluations
+                 << ", metric_solves=" << s.metric_solves
+                 << ", objective=" << s.final_objective
+                 << ", constraint=" << s.constraint_magnitude
+                 << ", time=" << s.seconds
+                 << ", stop=" << stopReasonToString( s.stop_reason );
+            if ( !s.stop_message.empty() ){
+                ostr << " (" << s.stop_message << ")";
+            }
+            ostr << "\n";
+        }
+        ostr << "total: iter=" << totalIterations()
+             << ", time=" << seconds << "\n";
+    }
+};
+
+}// namespace
+
+#endif 
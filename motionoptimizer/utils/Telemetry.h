@@ -0,0 +1,337 @@
+/*
+* Copyright (c) 2008-2015, Matt Zucker and Temple Price
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+namespace mopt {
+
+/**
+ * \struct TelemetryRecord
+ * A fixed size, binary record of a single optimizer event. 
+ * The timings are the totals of the solve so far, so that the time
+ * spent between two records is their difference.
+ */
+struct TelemetryRecord {
+    uint64_t time;            ///< ns since the sink was started
+    uint32_t level;           ///< the multigrid level
+    uint32_t iteration;
+    uint32_t event;           ///< the EventType
+    uint32_t N;               ///< the trajectory length
+    double objective;
+    double constraint;        ///< constraint magnitude
+    double step;              ///< step size, zero if unknown
+    uint64_t objective_nsec;  ///< time in objective evaluation
+    uint64_t collision_nsec;  ///< time in the collision function
+    uint64_t metric_nsec;     ///< time in metric solves
+};
+
+/**
+ * \class TelemetrySink
+ * A single producer, single consumer ring buffer of TelemetryRecords.
+ * The buffer is allocated up front and recording never locks or 
+ * allocates, it is a copy and a release store.
+ *
+ * If a flush has been started, a background thread drains the buffer
+ * to a binary or CSV file, and records are dropped (and counted)
+ * if the buffer is full. Without a flush the buffer keeps the most
+ * recent records, which can be read with getRecords() when the
+ * optimizer is done.
+ */
+class TelemetrySink {
+
+  public:
+
+    enum Format {
+        BINARY, ///< a header followed by the raw records
+        CSV     ///< one line per record
+    };
+
+  private:
+
+    std::vector< TelemetryRecord > buffer;
+    uint64_t mask;
+    
+    //head is only written by the producer and tail is only written
+    //  by the consumer, the exception being the overwriting of old
+    //  records when there is no consumer.
+    uint64_t head, tail;
+    uint64_t dropped;
+
+    uint64_t start_time;
+
+    pthread_t thread;
+    FILE * file;
+    Format format;
+    bool flushing;
+    int stop_flag;
+
+    //magic number at the start of a binary file.
+    static const char * MAGIC() { return "MOPTTEL1"; }
+
+  public:
+    
+    /** Capacity is rounded up to a power of two. */
+    explicit TelemetrySink( size_t capacity = 4096 ) :
+        head( 0 ), tail( 0 ), dropped( 0 ),
+        file( NULL ), format( BINARY ), flushing( false ), stop_flag( 0 )
+    {
+        size_t size = 1;
+        while ( size < capacity ){ size <<= 1; }
+        buffer.resize( size );
+        mask = size - 1;
+        start_time = Profiler::now();
+    }
+
+    ~TelemetrySink(){ stopFlush(); }
+
+    size_t capacity() const { return buffer.size(); }
+    
+    /** Records lost because a flush could not keep up. */
+    uint64_t getDropped() const {
+        return __atomic_load_n( &dropped, __ATOMIC_RELAXED );
+    }
+
+    /** The time base that TelemetryRecord::time is relative to. */
+    uint64_t getStartTime() const { return start_time; }
+
+    /** Empties the buffer and restarts the clock. Do not call while
+     *  an optimizer is recording.
+     */
+    void reset(){
+        __atomic_store_n( &tail, head, __ATOMIC_RELEASE );
+        dropped = 0;
+        start_time = Profiler::now();
+    }
+
+    /** Adds a record, this is called from the optimizer thread. */
+    inline void record( const TelemetryRecord & r ){
+        const uint64_t h = head;
+        const uint64_t t = __atomic_load_n( &tail, __ATOMIC_ACQUIRE );
+
+        if ( h - t >= buffer.size() ){
+            if ( flushing ){
+                __atomic_fetch_add( &dropped, 1, __ATOMIC_RELAXED );
+                return;
+            }
+            //nobody is reading, forget the oldest record.
+            __atomic_store_n( &tail, t + 1, __ATOMIC_RELEASE );
+        }
+
+        buffer[ h & mask ] = r;
+        __atomic_store_n( &head, h + 1, __ATOMIC_RELEASE );
+    }
+
+    /** Copies the records in the buffer, oldest first. Only valid if
+     *  there is no flush running.
+     */
+    void getRecords( std::vector< TelemetryRecord > & records ) const {
+        const uint64_t h = __atomic_load_n( &head, __ATOMIC_ACQUIRE );
+        const uint64_t t = __atomic_load_n( &tail, __ATOMIC_ACQUIRE );
+        records.clear();
+        records.reserve( h - t );
+        for ( uint64_t i = t; i < h; ++i ){
+            records.push_back( buffer[ i & mask ] );
+        }
+    }
+
+    /**
+     * Starts a background thread that writes records to filename in
+     * the given format. Returns false if the file could not be opened
+     * or if a flush is already running.
+     */
+    bool startFlush( const std::string & filename, Format f = BINARY ){
+        if ( flushing ){ return false; }
+
+        file = fopen( filename.c_str(), f == BINARY ? "wb" : "w" );
+        if ( !file ){ return false; }
+
+        format = f;
+        writeHeader();
+
+        stop_flag = 0;
+        flushing = true;
+        if ( pthread_create( &thread, NULL, flushThread, this ) != 0 ){
+            flushing = false;
+            fclose( file );
+            file = NULL;
+            return false;
+        }
+        return true;
+    }
+
+    /** Stops the flush thread, writes what is left and closes the file.*/
+    void stopFlush(){
+        if ( !flushing ){ return; }
+
+        __atomic_store_n( &stop_flag, 1, __ATOMIC_RELEASE );
+        pthread_join( thread, NULL );
+
+        drain();
+        fclose( file );
+        file = NULL;
+        flushing = false;
+    }
+
+    /** Writes a single record as a line of CSV. */
+    static void writeCSV( FILE * f, const TelemetryRecord & r ){
+        fprintf( f, "%llu,%u,%u,%u,%u,%.17g,%.17g,%.17g,%llu,%llu,%llu\n",
+                 (unsigned long long) r.time,
+                 r.level, r.iteration, r.event, r.N,
+                 r.objective, r.constraint, r.step,
+                 (unsigned long long) r.objective_nsec,
+                 (unsigned long long) r.collision_nsec,
+                 (unsigned long long) r.metric_nsec );
+    }
+
+    /**
+     * Reads a file written by a BINARY flush. Returns false if the
+     * file is not a telemetry file.
+     */
+    static bool readBinary( const std::string & filename,
+                            std::vector< TelemetryRecord > & records ){
+        FILE * f = fopen( filename.c_str(), "rb" );
+        if ( !f ){ return false; }
+
+        char magic[8];
+        uint32_t record_size = 0;
+        bool ok = ( fread( magic, 1, 8, f ) == 8 && 
+                    memcmp( magic, MAGIC(), 8 ) == 0 &&
+                    fread( &record_size, sizeof(record_size), 1, f ) == 1 &&
+                    record_size == sizeof(TelemetryRecord) );
+        
+        records.clear();
+        TelemetryRecord r;
+        while ( ok && fread( &r, sizeof(r), 1, f ) == 1 ){
+            records.push_back( r );
+        }
+        fclose( f );
+        return ok;
+    }
+
+  private:
+    
+    void writeHeader(){
+        if ( format == BINARY ){
+            const uint32_t record_size = sizeof(TelemetryRecord);
+            fwrite( MAGIC(), 1, 8, file );
+            fwrite( &record_size, sizeof(record_size), 1, file );
+        } else {
+            fprintf( file, "time,level,iteration,event,N,objective,"
+                           "constraint,step,objective_nsec,"
+                           "collision_nsec,metric_nsec\n" );
+        }
+    }
+
+    //writes everything in the buffer to the file, returns the number
+    //  of records written.
+    size_t drain(){
+        const uint64_t h = __atomic_load_n( &head, __ATOMIC_ACQUIRE );
+        uint64_t t = tail;
+
+        const size_t count = h - t;
+        while ( t < h ){
+            //write contiguous pieces of the buffer at once.
+            const uint64_t begin = t & mask;
+            const uint64_t end = std::min( begin + (h - t), 
+                                           uint64_t(buffer.size()) );
+            if ( format == BINARY ){
+                fwrite( &buffer[begin], sizeof(TelemetryRecord),
+                        end - begin, file );
+            } else {
+                for ( uint64_t i = begin; i < end; ++i ){
+                    writeCSV( file, buffer[i] );
+                }
+            }
+            t += end - begin;
+            __atomic_store_n( &tail, t, __ATOMIC_RELEASE );
+        }
+        return count;
+    }
+
+    static void * flushThread( void * data ){
+        TelemetrySink * sink = static_cast< TelemetrySink * >( data );
+
+        while ( !__atomic_load_n( &sink->stop_flag, __ATOMIC_ACQUIRE ) ){
+            //sleep only if there was nothing to do.
+            if ( sink->drain() == 0 ){ usleep( 1000 ); }
+        }
+        return NULL;
+    }
+
+};
+
+/**
+ * Appends the records in a sink to a text file as a single line
+ * labeled with name, in the format that demo/data_parser.py reads.
+ * Does nothing if filename is empty.
+ */
+inline void appendTelemetryToFile( const std::string & filename,
+                                   const std::string & name,
+                                   const TelemetrySink & telemetry )
+{
+    if ( filename.empty() ){ return; }
+
+    std::vector< TelemetryRecord > records;
+    telemetry.getRecords( records );
+
+    std::ofstream file( filename.c_str(), std::ios::app );
+    file << name << " {";
+    for ( size_t i = 0; i < records.size(); ++i ) {
+        const TelemetryRecord & r = records[i];
+        file << "[total:" << r.time * 1e-9
+             << ", gradient:" << r.objective_nsec * 1e-9
+             << ", collision:" << r.collision_nsec * 1e-9
+             << ", iter:" << r.iteration
+             << ", constraint:" << r.constraint
+             << ", objective:" << r.objective
+             << "], ";
+    }
+    file << "}\n";
+}
+
+}// namespace
+
+#endif 
@@ -76,9 +76,9 @@ typedef Eigen::Map<MatXR, 0, Eigen::OuterStride<> > SubMatMapR;
 
 typedef Eigen::Block<DynamicMatMap, 1, Eigen::Dynamic> Row;
 typedef const Eigen::Block<const DynamicMatMap, 1, Eigen::Dynamic> ConstRow;
-typedef Eigen::Block<DynamicMatMap, Eigen::Dynamic, 1, Eigen::Dynamic> Col;
+typedef Eigen::Block<DynamicMatMap, Eigen::Dynamic, 1, true> Col;
 typedef const Eigen::Block< const DynamicMatMap, Eigen::Dynamic,
-                            1, Eigen::Dynamic> ConstCol;
+                            1, true> ConstCol;
 
 
 //Simple enum types.
@@ -0,0 +1,592 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "CCDBroadPhase.h"
+#include <algorithm>
+#include <cassert>
+
+namespace ccdw {
+
+  static inline ccd_real_t area(const AABB& b) {
+    vec3 d = b.p1 - b.p0;
+    return 2*(d.x()*d.y() + d.y()*d.z() + d.z()*d.x());
+  }
+
+  // true if the boxes are less than dmin apart along every axis,
+  // which they must be if anything inside them is less than dmin
+  // apart.
+  static inline bool overlaps(const AABB& a, const AABB& b, 
+                              ccd_real_t dmin) {
+    for (int i=0; i<3; ++i) {
+      if (a.p0[i] > b.p1[i] + dmin || b.p0[i] > a.p1[i] + dmin) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static inline bool contains(const AABB& outer, const AABB& inner) {
+    for (int i=0; i<3; ++i) {
+      if (inner.p0[i] < outer.p0[i] || inner.p1[i] > outer.p1[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static inline ProxyPair makePair(size_t p1, const Convex* c1,
+                                   size_t p2, const Convex* c2) {
+    ProxyPair p;
+    p.proxy1 = p1;
+    p.proxy2 = p2;
+    p.c1 = c1;
+    p.c2 = c2;
+    return p;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  BroadPhase::BroadPhase(ccd_real_t margin):
+    _margin(margin),
+    _root(NULL_NODE),
+    _freeList(NULL_NODE),
+    _count(0)
+  {
+    assert(margin >= 0);
+  }
+
+  size_t BroadPhase::add(const Convex* c, int group) {
+
+    assert(c);
+
+    int leaf = _allocate();
+
+    _nodes[leaf].box = _tightBounds(c);
+    _nodes[leaf].box.dilate(_margin);
+    _nodes[leaf].convex = c;
+    _nodes[leaf].group = group;
+    _nodes[leaf].height = 0;
+
+    _insertLeaf(leaf);
+    ++_count;
+
+    return leaf;
+
+  }
+
+  void BroadPhase::remove(size_t proxy) {
+
+    assert(_isProxy(proxy));
+
+    _removeLeaf(proxy);
+    _free(proxy);
+    --_count;
+
+  }
+
+  bool BroadPhase::update(size_t proxy) {
+
+    assert(_isProxy(proxy));
+
+    AABB tight = _tightBounds(_nodes[proxy].convex);
+
+    if (contains(_nodes[proxy].box, tight)) {
+      return false;
+    }
+
+    _removeLeaf(proxy);
+
+    tight.dilate(_margin);
+    _nodes[proxy].box = tight;
+
+    _insertLeaf(proxy);
+
+    return true;
+
+  }
+
+  void BroadPhase::updateAll() {
+    for (size_t i=0; i<_nodes.size(); ++i) {
+      if (_isProxy(i)) { update(i); }
+    }
+  }
+
+  void BroadPhase::clear() {
+    _nodes.clear();
+    _root = NULL_NODE;
+    _freeList = NULL_NODE;
+    _count = 0;
+  }
+
+  size_t BroadPhase::size() const {
+    return _count;
+  }
+
+  bool BroadPhase::empty() const {
+    return _root == NULL_NODE;
+  }
+
+  const Convex* BroadPhase::convex(size_t proxy) const {
+    assert(_isProxy(proxy));
+    return _nodes[proxy].convex;
+  }
+
+  int BroadPhase::group(size_t proxy) const {
+    assert(_isProxy(proxy));
+    return _nodes[proxy].group;
+  }
+
+  const AABB& BroadPhase::bounds(size_t proxy) const {
+    assert(_isProxy(proxy));
+    return _nodes[proxy].box;
+  }
+
+  ccd_real_t BroadPhase::margin() const {
+    return _margin;
+  }
+
+  int BroadPhase::height() const {
+    return _root == NULL_NODE ? 0 : _nodes[_root].height;
+  }
+
+  void BroadPhase::query(const AABB& box, 
+                         std::vector<size_t>& proxies) const {
+
+    if (_root == NULL_NODE) { return; }
+
+    std::vector<int> stack;
+    stack.push_back(_root);
+
+    while (!stack.empty()) {
+
+      const Node& n = _nodes[stack.back()];
+      int index = stack.back();
+      stack.pop_back();
+
+      if (!overlaps(n.box, box, 0)) { continue; }
+
+      if (n.isLeaf()) {
+        proxies.push_back(index);
+      } else {
+        stack.push_back(n.child1);
+        stack.push_back(n.child2);
+      }
+
+    }
+
+  }
+
+  void BroadPhase::selfPairs(std::vector<ProxyPair>& pairs,
+                             ccd_real_t dmin) const {
+
+    std::vector<int> stack;
+
+    for (size_t i=0; i<_nodes.size(); ++i) {
+
+      if (!_isProxy(i)) { continue; }
+
+      const Node& leaf = _nodes[i];
+
+      stack.clear();
+      stack.push_back(_root);
+
+      while (!stack.empty()) {
+
+        int index = stack.back();
+        stack.pop_back();
+
+        const Node& n = _nodes[index];
+
+        if (!overlaps(n.box, leaf.box, dmin)) { continue; }
+
+        if (!n.isLeaf()) {
+          stack.push_back(n.child1);
+          stack.push_back(n.child2);
+        } else if (size_t(index) > i && 
+                   (leaf.group == 0 || n.group != leaf.group)) {
+          pairs.push_back(makePair(i, leaf.convex, index, n.convex));
+        }
+
+      }
+
+    }
+
+  }
+
+  void BroadPhase::pairs(const BroadPhase& other,
+                         std::vector<ProxyPair>& pairs,
+                         ccd_real_t dmin) const {
+
+    if (_root == NULL_NODE || other._root == NULL_NODE) { return; }
+
+    std::vector< std::pair<int, int> > stack;
+    stack.push_back(std::make_pair(_root, other._root));
+
+    while (!stack.empty()) {
+
+      int ia = stack.back().first;
+      int ib = stack.back().second;
+      stack.pop_back();
+
+      const Node& a = _nodes[ia];
+      const Node& b = other._nodes[ib];
+
+      if (!overlaps(a.box, b.box, dmin)) { continue; }
+
+      if (a.isLeaf() && b.isLeaf()) {
+        pairs.push_back(makePair(ia, a.convex, ib, b.convex));
+      } else if (b.isLeaf() || 
+                 (!a.isLeaf() && area(a.box) > area(b.box))) {
+        // descend into the larger box
+        stack.push_back(std::make_pair(a.child1, ib));
+        stack.push_back(std::make_pair(a.child2, ib));
+      } else {
+        stack.push_back(std::make_pair(ia, b.child1));
+        stack.push_back(std::make_pair(ia, b.child2));
+      }
+
+    }
+
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  AABB BroadPhase::_tightBounds(const Convex* c) {
+    vec3 ctr;
+    c->center(ctr);
+    vec3 r(c->maxDist());
+    return AABB(ctr - r, ctr + r);
+  }
+
+  int BroadPhase::_allocate() {
+
+    int index;
+
+    if (_freeList == NULL_NODE) {
+      index = _nodes.size();
+      _nodes.push_back(Node());
+    } else {
+      index = _freeList;
+      _freeList = _nodes[index].parent;
+    }
+
+    Node& n = _nodes[index];
+    n.parent = n.child1 = n.child2 = NULL_NODE;
+    n.height = 0;
+    n.convex = 0;
+    n.group = 0;
+
+    return index;
+
+  }
+
+  void BroadPhase::_free(int index) {
+    Node& n = _nodes[index];
+    n.parent = _freeList;
+    n.child1 = n.child2 = NULL_NODE;
+    n.height = -1;
+    n.convex = 0;
+    _freeList = index;
+  }
+
+  bool BroadPhase::_isProxy(size_t proxy) const {
+    return (proxy < _nodes.size() && 
+            _nodes[proxy].height == 0 && 
+            _nodes[proxy].convex);
+  }
+
+  void BroadPhase::_insertLeaf(int leaf) {
+
+    if (_root == NULL_NODE) {
+      _root = leaf;
+      _nodes[leaf].parent = NULL_NODE;
+      return;
+    }
+
+    // find the sibling which adds the least surface area to the
+    // tree, descending while it is cheaper to push the leaf down.
+    const AABB box = _nodes[leaf].box;
+    int index = _root;
+
+    while (!_nodes[index].isLeaf()) {
+
+      const Node& n = _nodes[index];
+
+      ccd_real_t a = area(n.box);
+      ccd_real_t combined = area(AABB::unite(n.box, box));
+
+      ccd_real_t cost = 2*combined;
+      ccd_real_t inherited = 2*(combined - a);
+
+      ccd_real_t child_cost[2];
+      int children[2] = { n.child1, n.child2 };
+
+      for (int c=0; c<2; ++c) {
+        const Node& child = _nodes[children[c]];
+        ccd_real_t grown = area(AABB::unite(child.box, box));
+        if (!child.isLeaf()) { grown -= area(child.box); }
+        child_cost[c] = grown + inherited;
+      }
+
+      if (cost < child_cost[0] && cost < child_cost[1]) {
+        break;
+      }
+
+      index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+
+    }
+
+    int sibling = index;
+    int oldParent = _nodes[sibling].parent;
+
+    // may reallocate _nodes
+    int newParent = _allocate();
+
+    _nodes[newParent].parent = oldParent;
+    _nodes[newParent].box = AABB::unite(box, _nodes[sibling].box);
+    _nodes[newParent].height = _nodes[sibling].height + 1;
+    _nodes[newParent].child1 = sibling;
+    _nodes[newParent].child2 = leaf;
+
+    if (oldParent != NULL_NODE) {
+      if (_nodes[oldParent].child1 == sibling) {
+        _nodes[oldParent].child1 = newParent;
+      } else {
+        _nodes[oldParent].child2 = newParent;
+      }
+    } else {
+      _root = newParent;
+    }
+
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    // refit and rebalance the ancestors
+    index = _nodes[leaf].parent;
+
+    while (index != NULL_NODE) {
+
+      index = _balance(index);
+
+      Node& n = _nodes[index];
+      const Node& c1 = _nodes[n.child1];
+      const Node& c2 = _nodes[n.child2];
+
+      n.height = 1 + std::max(c1.height, c2.height);
+      n.box = AABB::unite(c1.box, c2.box);
+
+      index = n.parent;
+
+    }
+
+  }
+
+  void BroadPhase::_removeLeaf(int leaf) {
+
+    if (leaf == _root) {
+      _root = NULL_NODE;
+      return;
+    }
+
+    int parent = _nodes[leaf].parent;
+    int grandParent = _nodes[parent].parent;
+    int sibling = (_nodes[parent].child1 == leaf ? 
+                   _nodes[parent].child2 : _nodes[parent].child1);
+
+    _free(parent);
+
+    if (grandParent == NULL_NODE) {
+      _root = sibling;
+      _nodes[sibling].parent = NULL_NODE;
+      return;
+    }
+
+    if (_nodes[grandParent].child1 == parent) {
+      _nodes[grandParent].child1 = sibling;
+    } else {
+      _nodes[grandParent].child2 = sibling;
+    }
+    _nodes[sibling].parent = grandParent;
+
+    int index = grandParent;
+
+    while (index != NULL_NODE) {
+
+      index = _balance(index);
+
+      Node& n = _nodes[index];
+      const Node& c1 = _nodes[n.child1];
+      const Node& c2 = _nodes[n.child2];
+
+      n.height = 1 + std::max(c1.height, c2.height);
+      n.box = AABB::unite(c1.box, c2.box);
+
+      index = n.parent;
+
+    }
+
+  }
+
+  // if one child of a is more than one level taller than the other,
+  // rotates it up to take the place of a, returning the index of the
+  // node now in the place of a.
+  int BroadPhase::_balance(int ia) {
+
+    Node& a = _nodes[ia];
+
+    if (a.isLeaf() || a.height < 2) {
+      return ia;
+    }
+
+    int ib = a.child1;
+    int ic = a.child2;
+
+    Node& b = _nodes[ib];
+    Node& c = _nodes[ic];
+
+    int balance = c.height - b.height;
+
+    if (balance > 1) {
+
+      // rotate c up
+      int ifn = c.child1;
+      int ign = c.child2;
+      Node& f = _nodes[ifn];
+      Node& g = _nodes[ign];
+
+      c.child1 = ia;
+      c.parent = a.parent;
+      a.parent = ic;
+
+      if (c.parent != NULL_NODE) {
+        if (_nodes[c.parent].child1 == ia) {
+          _nodes[c.parent].child1 = ic;
+        } else {
+          _nodes[c.parent].child2 = ic;
+        }
+      } else {
+        _root = ic;
+      }
+
+      if (f.height > g.height) {
+        c.child2 = ifn;
+        a.child2 = ign;
+        g.parent = ia;
+        a.box = AABB::unite(b.box, g.box);
+        c.box = AABB::unite(a.box, f.box);
+        a.height = 1 + std::max(b.height, g.height);
+        c.height = 1 + std::max(a.height, f.height);
+      } else {
+        c.child2 = ign;
+        a.child2 = ifn;
+        f.parent = ia;
+        a.box = AABB::unite(b.box, f.box);
+        c.box = AABB::unite(a.box, g.box);
+        a.height = 1 + std::max(b.height, f.height);
+        c.height = 1 + std::max(a.height, g.height);
+      }
+
+      return ic;
+
+    } else if (balance < -1) {
+
+      // rotate b up
+      int id = b.child1;
+      int ie = b.child2;
+      Node& d = _nodes[id];
+      Node& e = _nodes[ie];
+
+      b.child1 = ia;
+      b.parent = a.parent;
+      a.parent = ib;
+
+      if (b.parent != NULL_NODE) {
+        if (_nodes[b.parent].child1 == ia) {
+          _nodes[b.parent].child1 = ib;
+        } else {
+          _nodes[b.parent].child2 = ib;
+        }
+      } else {
+        _root = ib;
+      }
+
+      if (d.height > e.height) {
+        b.child2 = id;
+        a.child1 = ie;
+        e.parent = ia;
+        a.box = AABB::unite(c.box, e.box);
+        b.box = AABB::unite(a.box, d.box);
+        a.height = 1 + std::max(c.height, e.height);
+        b.height = 1 + std::max(a.height, d.height);
+      } else {
+        b.child2 = ie;
+        a.child1 = id;
+        d.parent = ia;
+        a.box = AABB::unite(c.box, d.box);
+        b.box = AABB::unite(a.box, e.box);
+        a.height = 1 + std::max(c.height, d.height);
+        b.height = 1 + std::max(a.height, e.height);
+      }
+
+      return ib;
+
+    }
+
+    return ia;
+
+  }
+
+  //////////////////////////////////////////////////////////////////////
+
+  size_t queryPairs(const Checker& checker,
+                    QueryType qtype,
+                    const std::vector<ProxyPair>& pairs,
+                    std::vector<Report>* reports,
+                    ccd_real_t dmin) {
+
+    size_t count = 0;
+    Report report;
+
+    for (size_t i=0; i<pairs.size(); ++i) {
+      if (checker.query(qtype, reports ? &report : 0,
+                        pairs[i].c1, pairs[i].c2, dmin)) {
+        ++count;
+        if (reports) { reports->push_back(report); }
+      }
+    }
+
+    return count;
+
+  }
+
+}
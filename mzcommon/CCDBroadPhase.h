@@ -0,0 +1,164 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _CCDBROADPHASE_H_
+#define _CCDBROADPHASE_H_
+
+#include "CCDWrapper.h"
+#include "Box3.h"
+#include <vector>
+
+namespace ccdw {
+
+  typedef Box3_t<ccd_real_t> AABB;
+
+  // A pair of proxies whose boxes overlap, identified by the proxy
+  // indices returned from BroadPhase::add().
+  struct ProxyPair {
+    size_t proxy1;
+    size_t proxy2;
+    const Convex* c1;
+    const Convex* c2;
+  };
+
+  // A dynamic AABB tree over Convex objects, so that a scene with
+  // many objects only sends the pairs that might be close to the
+  // Checker. Each object is bounded by the box around the sphere of
+  // radius maxDist() at its center(), enlarged by a margin so that
+  // small motions do not change the tree.
+  //
+  // The tree holds pointers: call update() after an object moves
+  // (e.g. after changing the xform of a TransformedConvex), and keep
+  // the objects alive until they are removed.
+  class BroadPhase {
+  public:
+
+    explicit BroadPhase(ccd_real_t margin=0);
+
+    // adds c, returning its proxy index. Proxies with the same
+    // nonzero group are never paired with each other, e.g. to skip
+    // adjacent links of a robot in self collision queries.
+    size_t add(const Convex* c, int group=0);
+
+    void remove(size_t proxy);
+
+    // recomputes the bounds of a proxy, returning true if it had
+    // left its enlarged box and was reinserted.
+    bool update(size_t proxy);
+
+    void updateAll();
+
+    void clear();
+
+    // the number of proxies
+    size_t size() const;
+
+    bool empty() const;
+
+    const Convex* convex(size_t proxy) const;
+
+    int group(size_t proxy) const;
+
+    // the enlarged box of a proxy
+    const AABB& bounds(size_t proxy) const;
+
+    ccd_real_t margin() const;
+
+    // the height of the tree, zero for a single proxy.
+    int height() const;
+
+    // appends the proxies whose boxes overlap box.
+    void query(const AABB& box, std::vector<size_t>& proxies) const;
+
+    // appends every pair of proxies in this tree whose boxes are
+    // less than dmin apart, with proxy1 < proxy2.
+    void selfPairs(std::vector<ProxyPair>& pairs,
+                   ccd_real_t dmin=0) const;
+
+    // appends every pair with proxy1 in this tree and proxy2 in
+    // other whose boxes are less than dmin apart, e.g. for a robot
+    // against the world. Groups are not compared across trees.
+    void pairs(const BroadPhase& other,
+               std::vector<ProxyPair>& pairs,
+               ccd_real_t dmin=0) const;
+
+  private:
+
+    enum { NULL_NODE = -1 };
+
+    // leaves have child1 == NULL_NODE and hold a convex; the index
+    // of a leaf is its proxy index. Free nodes are chained through
+    // parent.
+    struct Node {
+      AABB box;
+      int parent;
+      int child1;
+      int child2;
+      int height;
+      const Convex* convex;
+      int group;
+      bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    static AABB _tightBounds(const Convex* c);
+
+    int _allocate();
+    void _free(int node);
+
+    void _insertLeaf(int leaf);
+    void _removeLeaf(int leaf);
+    int _balance(int a);
+
+    bool _isProxy(size_t proxy) const;
+
+    ccd_real_t _margin;
+
+    std::vector<Node> _nodes;
+    int _root;
+    int _freeList;
+    size_t _count;
+
+  };
+
+  // runs checker.query() for each pair, appending a report for each
+  // pair that is closer than dmin to reports, if it is not null.
+  // Returns the number of such pairs.
+  size_t queryPairs(const Checker& checker,
+                    QueryType qtype,
+                    const std::vector<ProxyPair>& pairs,
+                    std::vector<Report>* reports=0,
+                    ccd_real_t dmin=0);
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "CCDQueryCache.h"
+#include <cassert>
+
+namespace ccdw {
+
+  QueryCache::QueryCache(const Checker* checker):
+    _checker(checker),
+    _queries(0),
+    _skipped(0)
+  {
+    assert(checker);
+  }
+
+  bool QueryCache::query(QueryType qtype, Report* report,
+                         const Convex* c1, const Convex* c2,
+                         ccd_real_t dmin) {
+
+    assert( c1 );
+    assert( c2 );
+
+    ++_queries;
+
+    Pose pose1, pose2;
+    _getPose(c1, pose1);
+    _getPose(c2, pose2);
+
+    EntryMap::iterator i = _entries.find(Key(c1, c2));
+
+    if (i != _entries.end()) {
+
+      const Entry& e = i->second;
+
+      // GJK distances are only good to within dist_tolerance
+      ccd_real_t lower = (e.warm.distance - 
+                          _checker->ccd.dist_tolerance -
+                          _motion(e.pose1, pose1) - 
+                          _motion(e.pose2, pose2));
+
+      if (lower > dmin) {
+        if (report) {
+          *report = Report(c1, c2);
+        }
+        ++_skipped;
+        return false;
+      }
+
+    } else {
+
+      i = _entries.insert(std::make_pair(Key(c1, c2), Entry())).first;
+
+    }
+
+    Entry& e = i->second;
+
+    bool rval = _checker->query(qtype, report, c1, c2, dmin, &e.warm);
+
+    e.pose1 = pose1;
+    e.pose2 = pose2;
+
+    return rval;
+
+  }
+
+  size_t QueryCache::queryPairs(QueryType qtype,
+                                const std::vector<ProxyPair>& pairs,
+                                std::vector<Report>* reports,
+                                ccd_real_t dmin) {
+
+    size_t count = 0;
+    Report report;
+
+    for (size_t i=0; i<pairs.size(); ++i) {
+      if (query(qtype, reports ? &report : 0,
+                pairs[i].c1, pairs[i].c2, dmin)) {
+        ++count;
+        if (reports) { reports->push_back(report); }
+      }
+    }
+
+    return count;
+
+  }
+
+  void QueryCache::forget(const Convex* c) {
+    EntryMap::iterator i = _entries.begin();
+    while (i != _entries.end()) {
+      if (i->first.first == c || i->first.second == c) {
+        _entries.erase(i++);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  void QueryCache::clear() {
+    _entries.clear();
+  }
+
+  size_t QueryCache::size() const {
+    return _entries.size();
+  }
+
+  size_t QueryCache::queries() const {
+    return _queries;
+  }
+
+  size_t QueryCache::skipped() const {
+    return _skipped;
+  }
+
+  void QueryCache::resetCounts() {
+    _queries = _skipped = 0;
+  }
+
+  void QueryCache::_getPose(const Convex* c, Pose& pose) {
+
+    c->center(pose.center);
+    pose.radius = c->maxDist();
+
+    const TransformedConvex* t = dynamic_cast<const TransformedConvex*>(c);
+
+    if (t) {
+      pose.rotation = t->xform.rotation();
+    } else {
+      pose.rotation = quat();
+    }
+
+  }
+
+  ccd_real_t QueryCache::_motion(const Pose& pose, const Pose& current) {
+
+    // every point is within radius of the center, so rotating by
+    // angle about the center moves it at most radius*angle.
+    ccd_real_t angle = quat::dist(pose.rotation, current.rotation);
+
+    return ((current.center - pose.center).norm() + 
+            std::max(pose.radius, current.radius) * angle);
+
+  }
+
+}
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _CCDQUERYCACHE_H_
+#define _CCDQUERYCACHE_H_
+
+#include "CCDBroadPhase.h"
+#include <map>
+
+namespace ccdw {
+
+  // Runs Checker queries for pairs of objects that are queried over
+  // and over with small motions in between, as in each iteration of
+  // a trajectory optimizer. For each pair it keeps a WarmStart and
+  // the poses the pair was last checked at:
+  //
+  //  - Before GJK or MPR, a separating axis is looked for from the
+  //    last one found for the pair, which answers the query for
+  //    pairs that stay apart but move too much for the early out
+  //    below (see WarmStart).
+  //
+  //  - If the pair was further apart than dmin by more than the
+  //    objects can have moved since, the query returns false without
+  //    calling the Checker at all.
+  //
+  // Motion is measured from center() and, for a TransformedConvex,
+  // the rotation of its xform; other objects must not change shape
+  // while they are in the cache. Entries are keyed by pointer, so
+  // call clear() (or forget()) before deleting objects.
+  class QueryCache {
+  public:
+
+    explicit QueryCache(const Checker* checker);
+
+    // same as Checker::query
+    bool query(QueryType qtype, Report* report,
+               const Convex* c1, const Convex* c2,
+               ccd_real_t dmin=0);
+
+    // runs query() for each pair, appending a report for each pair
+    // that is closer than dmin to reports, if it is not null.
+    // Returns the number of such pairs.
+    size_t queryPairs(QueryType qtype,
+                      const std::vector<ProxyPair>& pairs,
+                      std::vector<Report>* reports=0,
+                      ccd_real_t dmin=0);
+
+    // removes every entry involving c
+    void forget(const Convex* c);
+
+    void clear();
+
+    size_t size() const;
+
+    // the number of queries so far, and how many of them were
+    // answered without calling the checker.
+    size_t queries() const;
+    size_t skipped() const;
+
+    void resetCounts();
+
+  private:
+
+    struct Pose {
+      vec3 center;
+      quat rotation;
+      ccd_real_t radius;
+    };
+
+    struct Entry {
+      WarmStart warm;
+      Pose pose1;
+      Pose pose2;
+    };
+
+    typedef std::pair<const Convex*, const Convex*> Key;
+    typedef std::map<Key, Entry> EntryMap;
+
+    static void _getPose(const Convex* c, Pose& pose);
+
+    // an upper bound on how far any point of c has moved since pose
+    static ccd_real_t _motion(const Pose& pose, const Pose& current);
+
+    const Checker* _checker;
+
+    EntryMap _entries;
+
+    size_t _queries;
+    size_t _skipped;
+
+  };
+
+}
+
+#endif
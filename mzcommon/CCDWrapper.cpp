@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <string.h>
 #include <sstream>
+#include <algorithm>
 
 namespace ccdw {
 
@@ -522,6 +523,40 @@ namespace ccdw {
   Report::Report(const Convex* a, const Convex* b): 
     c1(a), c2(b), flags(0), distance(0), algorithm(NUM_ALGORITHMS) {}
 
+  WarmStart::WarmStart(): 
+    direction(1, 0, 0), haveDirection(false), distance(0) {}
+
+  // Looks for an axis separating c1 and c2 by more than target. The
+  // gap along a unit vector n (pointing from c1 towards c2) between
+  // the support points of c1 along n and of c2 along -n is a lower
+  // bound on the distance between them. Starting from n, moves to the
+  // line between the support points a few times, which for smooth or
+  // nearby shapes closes in on the direction between the closest
+  // points. Sets n to the best axis found and returns its gap.
+  static ccd_real_t separatingAxis(const Convex* c1, const Convex* c2,
+                                   ccd_real_t target, vec3& n) {
+
+    vec3 axis = n;
+    ccd_real_t best = 0;
+
+    for (int i=0; i<5; ++i) {
+      vec3 s1, s2;
+      c1->support(axis, s1);
+      c2->support(-axis, s2);
+      vec3 d = s2 - s1;
+      ccd_real_t gap = vec3::dot(axis, d);
+      if (!i || gap > best) {
+        best = gap;
+        n = axis;
+      }
+      if (best > target || !d.norm2()) { break; }
+      axis = d / d.norm();
+    }
+
+    return best;
+
+  }
+
   Checker::Checker() {
     CCD_INIT(&ccd);
     ccd.support1 = ccdw::support;
@@ -557,7 +592,7 @@ namespace ccdw {
   
   bool Checker::query(QueryType qtype, Report* report,
                          const Convex* orig_c1, const Convex* orig_c2,
-                         ccd_real_t dmin) const {
+                         ccd_real_t dmin, WarmStart* warm) const {
 
     assert( orig_c1 );
     assert( orig_c2 );
@@ -578,9 +613,32 @@ namespace ccdw {
     ccd_real_t d = dmin + r1 + r2;
 
     if ((ctr2-ctr1).norm2()  > d*d) {
+      if (warm) {
+        warm->distance = (ctr2-ctr1).norm() - r1 - r2;
+      }
       return false;
     }
 
+    // then look for a separating axis, starting from the last one
+    // or the line between the centers.
+    ccd_real_t gap = 0;
+
+    if (warm) {
+      vec3 n = warm->direction;
+      if (!warm->haveDirection && (ctr2-ctr1).norm2()) {
+        n = vec3::normalize(ctr2-ctr1);
+      }
+      gap = separatingAxis(orig_c1, orig_c2, dmin, n);
+      warm->haveDirection = (gap > 0);
+      if (warm->haveDirection) { 
+        warm->direction = n; 
+      }
+      if (gap > dmin) {
+        warm->distance = gap;
+        return false;
+      }
+    }
+
     const Convex* c1 = orig_c1;
     const Convex* c2 = orig_c2;
 
@@ -605,8 +663,11 @@ namespace ccdw {
 
     Convex* dilated = 0;
 
+    // the GJK distance, if it is computed below
+    ccd_real_t actual = 0;
+
     if (dmin && qtype != QUERY_INTERSECT) {
-      ccd_real_t actual = ccdGJKDist(c1, c2, &ccd);
+      actual = ccdGJKDist(c1, c2, &ccd);
       if (actual > 0) {
         if (actual < dmin + ccd.dist_tolerance) {
           if (qtype == QUERY_PENETRATION) {
@@ -726,6 +787,15 @@ namespace ccdw {
       report->algorithm = actual_algorithm;
     }
 
+    if (warm) {
+      if (intersect) {
+        warm->haveDirection = false;
+        warm->distance = 0;
+      } else {
+        warm->distance = std::max(std::max(gap, actual), ccd_real_t(0));
+      }
+    }
+
     delete dilated;
     delete transformed;
     
@@ -267,6 +267,28 @@ namespace ccdw {
     
   };
 
+  // Carries state between queries of the same pair of objects. If
+  // haveDirection is set, direction is a unit vector (in world
+  // coordinates, pointing from the first object towards the second)
+  // along which the objects were last found to be apart. A query
+  // looks for an axis separating the objects by more than dmin,
+  // starting from direction (or the line between the centers) and
+  // taking a few steps towards the closest points, and returns false
+  // without running GJK or MPR if it finds one. The best axis found
+  // is kept, and haveDirection is cleared if none separates them.
+  // distance is a lower bound on the distance between the objects,
+  // zero if they intersect.
+  class WarmStart {
+  public:
+
+    vec3 direction;
+    bool haveDirection;
+    ccd_real_t distance;
+
+    WarmStart();
+
+  };
+
   class Checker {
   public:
 
@@ -286,9 +308,11 @@ namespace ccdw {
                      const Convex* c1, const Convex* c2,
                      ccd_real_t dmin=0) const;
 
+    // if warm is given, a separating axis is looked for from it
+    // before the narrow phase, and it is updated (see WarmStart).
     bool query(QueryType qtype, Report* report,
                const Convex* c1, const Convex* c2,
-               ccd_real_t dmin=0) const;
+               ccd_real_t dmin=0, WarmStart* warm=0) const;
 
   };
 
@@ -33,12 +33,19 @@
 
 #include "DtGrid.h"
 #include <float.h>
+#include <math.h>
 #include <iostream>
 #include <stdio.h>
 #include <stdexcept>
 #include <assert.h>
 #include <fstream>
 #include "Bresenham.h"
+#include "TriMeshBVH.h"
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
 
 
 template <> const float DtGrid_t<float>::DT_INF = FLT_MAX;
@@ -46,10 +53,10 @@ template <> const double DtGrid_t<double>::DT_INF = DBL_MAX;
 
 #define debug if (0) std::cerr
 
-#include <map>
 
 template <class real>
 DtGrid_t<real>::DtGrid_t() {
+  _layout = LAYOUT_LINEAR;
   clear();
 }
 
@@ -68,6 +75,8 @@ void DtGrid_t<real>::clear() {
   this->_clear();
   _data.clear();
   _gdata.clear();
+  _mapping.unmap();
+  for (int i=0; i<3; ++i) { _loff[i].clear(); }
   _hmap.clear();
   _minDist = DT_INF;
   _maxDist = -DT_INF;
@@ -75,32 +84,34 @@ void DtGrid_t<real>::clear() {
 
 template <class real>
 real& DtGrid_t<real>::operator()(size_t x, size_t y, size_t z) {
-  return _data[this->sub2ind(x,y,z)];
+  return _data[_index(x,y,z)];
 }
 
 template <class real>
 const real& DtGrid_t<real>::operator()(size_t x, size_t y, size_t z) const {
-  return _data[this->sub2ind(x,y,z)];
+  return _data[_index(x,y,z)];
 }
 
 template <class real>
 const real& DtGrid_t<real>::operator()(const vec3u& s) const {
-  return _data[this->sub2ind(s)];
+  return _data[_index(s)];
 }
 
 template <class real>
 real& DtGrid_t<real>::operator()(const vec3u& s) {
-  return _data[this->sub2ind(s)];
+  return _data[_index(s)];
 }
 
 template <class real>
 const real& DtGrid_t<real>::operator[](size_t idx) const {
-  return _data[idx];
+  if (_layout == LAYOUT_LINEAR) { return _data[idx]; }
+  return _data[_index(this->ind2sub(idx))];
 }
 
 template <class real>
 real& DtGrid_t<real>::operator[](size_t idx) {
-  return _data[idx];
+  if (_layout == LAYOUT_LINEAR) { return _data[idx]; }
+  return _data[_index(this->ind2sub(idx))];
 }
 
 template <class real>
@@ -152,7 +163,7 @@ real DtGrid_t<real>::_sample(const vec3& v, vec3* grad) const {
       coeff *= alpha[d[j]][j];
     }
     if (!coeff) { continue; }
-    f += coeff * _data[this->sub2ind(s)];
+    f += coeff * _data[_index(s)];
     if (grad) {
       g += coeff * gradient(s);
     }
@@ -175,6 +186,94 @@ real DtGrid_t<real>::sample(const vec3& v, vec3& gradient) const {
 }
   
 
+template <class real>
+void DtGrid_t<real>::sampleBatch(const vec3* pts, size_t n,
+                                 real* vals, vec3* grads) const {
+
+  enum { BATCH = 64 };
+
+  if (this->empty()) {
+    for (size_t i=0; i<n; ++i) {
+      vals[i] = 0;
+      if (grads) { grads[i] = vec3(0); }
+    }
+    return;
+  }
+
+  const real cs = this->_cellSize;
+  const real invCS = 1/cs;
+  const bool stored = !_gdata.empty();
+
+  // per point: index of the floor cell, weight of the upper
+  // neighbor on each axis, and the offset to that neighbor (zero
+  // when its weight is, so every corner read stays in the grid)
+  size_t base[BATCH];
+  size_t cell[3][BATCH];
+  real   u[3][BATCH];
+  size_t off[3][BATCH];
+
+  for (size_t start=0; start<n; start+=BATCH) {
+
+    const size_t m = std::min(size_t(BATCH), n-start);
+    const vec3* p = pts + start;
+
+    for (size_t k=0; k<m; ++k) { base[k] = 0; }
+
+    // same arithmetic as floorCell() and _sample(), without branches
+    for (int j=0; j<3; ++j) {
+      const real o = this->_origin[j];
+      const size_t last = this->_dims[j]-1;
+      for (size_t k=0; k<m; ++k) {
+        real t = std::max((p[k][j] - o) * invCS - real(0.5), real(0));
+        size_t fs = std::min(size_t(t), last);
+        real diff = p[k][j] - (o + (fs + real(0.5))*cs);
+        bool upper = (diff >= 0) & (diff < cs) & (fs < last);
+        u[j][k] = upper ? diff * invCS : real(0);
+        size_t next = _loff[j][std::min(fs+1, last)];
+        off[j][k] = upper ? next - _loff[j][fs] : 0;
+        cell[j][k] = fs;
+        base[k] += _loff[j][fs];
+      }
+    }
+
+    for (size_t k=0; k<m; ++k) {
+
+      real f = 0;
+      vec3 g(0);
+
+      const real a[3][2] = { 
+        { 1-u[0][k], u[0][k] },
+        { 1-u[1][k], u[1][k] },
+        { 1-u[2][k], u[2][k] },
+      };
+
+      // corners in the order of _sample's disp table
+      for (int i=0; i<8; ++i) {
+        const int dx = (i >> 2) & 1, dy = (i >> 1) & 1, dz = i & 1;
+        const real coeff = a[0][dx] * a[1][dy] * a[2][dz];
+        const size_t idx = (base[k] + (dx ? off[0][k] : 0) + 
+                            (dy ? off[1][k] : 0) + (dz ? off[2][k] : 0));
+        f += coeff * _data[idx];
+        if (!grads) { continue; }
+        if (stored) {
+          g += coeff * _gdata[idx];
+        } else if (coeff) {
+          // a nonzero coeff means the corner is the neighbor itself
+          g += coeff * _computeGradient(vec3u(cell[0][k] + dx, 
+                                              cell[1][k] + dy,
+                                              cell[2][k] + dz));
+        }
+      }
+
+      vals[start+k] = f;
+      if (grads) { grads[start+k] = g; }
+
+    }
+
+  }
+
+}
+
 template <class real>
 vec3_t<real> DtGrid_t<real>::gradient(size_t x, size_t y, size_t z) const {
   return gradient(vec3u(x,y,z));
@@ -183,14 +282,22 @@ vec3_t<real> DtGrid_t<real>::gradient(size_t x, size_t y, size_t z) const {
 template <class real>
 vec3_t<real> DtGrid_t<real>::gradient(vec3u s) const {
 
-  vec3 g(0);
-  if (!this->_size) { return g; }
+  if (!this->_size) { return vec3(0); }
 
   if (!_gdata.empty()) {
-    return _gdata[this->sub2ind(s)];
+    return _gdata[_index(s)];
   }
 
-  real vcur = _data[this->sub2ind(s)];
+  return _computeGradient(s);
+
+}
+
+template <class real>
+vec3_t<real> DtGrid_t<real>::_computeGradient(vec3u s) const {
+
+  vec3 g(0);
+
+  real vcur = _data[_index(s)];
   real invCS = 1/this->_cellSize;
 
   for (int d=0; d<3; ++d) {
@@ -200,13 +307,13 @@ vec3_t<real> DtGrid_t<real>::gradient(vec3u s) const {
     if (s[d] > 0) { 
 
       --s[d];
-      real vprev = _data[this->sub2ind(s)];
+      real vprev = _data[_index(s)];
       ++s[d];
 
       if (s[d]+1 < this->_dims[d]) {
 
         ++s[d];
-        real vnext = _data[this->sub2ind(s)];
+        real vnext = _data[_index(s)];
         --s[d];
 
         g[d] = (vnext-vprev) * invCS * 0.5f;
@@ -222,7 +329,7 @@ vec3_t<real> DtGrid_t<real>::gradient(vec3u s) const {
       assert( s[d]+1 < this->_dims[d] );
 
       ++s[d];
-      real vnext = _data[this->sub2ind(s)];
+      real vnext = _data[_index(s)];
       --s[d];
 
       g[d] = (vnext-vcur) * invCS;
@@ -302,7 +409,7 @@ void DtGrid_t<real>::_create() {
   
   this->_size = this->_dims.prod();
 
-  _data.resize(this->_size, DT_INF);
+  _data.resize(_createLayout(), DT_INF);
 
   _hmap.resize(this->_dims[_ax[0]], this->_dims[_ax[1]], 
                this->_cellSize,
@@ -372,40 +479,31 @@ void DtGrid_t<real>::computeDistsFromBinary(bool storeGradients) {
 
   if (this->empty()) { return; }
 
-  // set bintmp to true wherever data <= 0 and false wherever data > 0
-  // also set data to 0 wherever bintmp is true and inf otherwise
-  std::vector<bool> bintmp(this->_size);
-
-  for (size_t i=0; i<this->_size; ++i) {
-    bintmp[i] = (_data[i] <= 0);
-    _data[i] = (bintmp[i] ? 0 : DT_INF);
-  }
-
-  // compute the EDT of the data so far
-  _computeEDT();
-
-  // copy data into a temp vector
-  std::vector<real> tmp = _data;
+  Layout layout = _layout;
+  setLayout(LAYOUT_LINEAR);
 
-  // now set data to 0 wherever bintmp is false and inf otherwise
+  // occupied cells (data <= 0) start at -inf and free cells at inf,
+  // the signed EDT then gives each cell the distance to the nearest
+  // cell of the other kind, keeping its sign.
   for (size_t i=0; i<this->_size; ++i) {
-    _data[i] = (bintmp[i] ? DT_INF : 0);
+    _data[i] = (_data[i] <= 0 ? -DT_INF : DT_INF);
   }
 
-  // compute the EDT of the data again
-  _computeEDT();
+  _computeEDT(true);
 
   _minDist = DT_INF;
   _maxDist = -DT_INF;
 
+  // measure from the cell boundary rather than the cell center
   for (size_t i=0; i<this->_size; ++i) {
-    real d1 = std::max(tmp[i]-0.5f*this->_cellSize, real(0));
-    real d2 = std::max(_data[i]-0.5f*this->_cellSize, real(0));
-    _data[i] = d1-d2;
+    real d = std::max(fabs(_data[i])-0.5f*this->_cellSize, real(0));
+    _data[i] = (_data[i] < 0 ? -d : d);
     _minDist = std::min(_minDist, _data[i]);
     _maxDist = std::max(_maxDist, _data[i]);
   }
 
+  setLayout(layout);
+
   _gdata.clear();
 
   if (storeGradients) {
@@ -416,55 +514,60 @@ void DtGrid_t<real>::computeDistsFromBinary(bool storeGradients) {
 
 template <class real>
 void DtGrid_t<real>::computeDists(bool storeGradients) {
+  _computeDists(0, storeGradients);
+}
+
+template <class real>
+void DtGrid_t<real>::_computeDists(real keepDist, bool storeGradients) {
 
   if (this->empty()) { return; }
 
+  Layout layout = _layout;
+  setLayout(LAYOUT_LINEAR);
+
   // clear min/max dist
   _minDist = DT_INF;
   _maxDist = -DT_INF;
 
-  // store things near the boundary
-  typedef std::map<size_t, real> NearLookup;
-
-  // store whether we are inside
-  std::vector<bool> inside(this->_size, false);
-  NearLookup near;
+  // cells near the boundary keep their value, sorted by index
+  typedef std::pair<size_t, real> NearCell;
+  std::vector<NearCell> near;
 
+  // cells near the boundary become zero and everything else inf,
+  // keeping the sign so we know which cells are inside.
   for (size_t i=0; i<this->_size; ++i) {
-    if (_data[i] < 0) { 
-      inside[i] = true; 
-      _data[i] = -_data[i];
-    } 
-    // now positive
-    if (_data[i] != DT_INF) {
-      if (_data[i] < 0.87*this->_cellSize) {
-        near[i] = _data[i];
-        //_data[i] /= this->_cellSize;
-        //_data[i] *= _data[i];
-        _data[i] = 0;
-      } else {
-        _data[i] = DT_INF;
-      }
+    real d = fabs(_data[i]);
+    bool site = (d != DT_INF && d < 0.87*this->_cellSize);
+    if (site || (d != DT_INF && d < keepDist)) {
+      near.push_back(NearCell(i, _data[i]));
+    }
+    if (site) {
+      d = 0;
+    } else {
+      d = DT_INF;
     }
+    _data[i] = (signbit(_data[i]) ? -d : d);
   }
   
   _computeEDT();
 
-  for (size_t z=0; z<this->nz(); ++z) {
-    for (size_t y=0; y<this->ny(); ++y) {
-      for (size_t x=0; x<this->nx(); ++x) {
-        size_t idx = this->sub2ind(x,y,z);
-        typename NearLookup::const_iterator i = near.find(idx);
-        if (i != near.end()) {
-          _data[idx] = i->second;
-        }
-        if (inside[idx]) { _data[idx] = -_data[idx]; }
-        _minDist = std::min(_minDist, _data[idx]);
-        _maxDist = std::max(_maxDist, _data[idx]);
-      }
+  typename std::vector<NearCell>::const_iterator n = near.begin();
+
+  for (size_t idx=0; idx<this->_size; ++idx) {
+    if (n != near.end() && n->first == idx) {
+      _data[idx] = n->second;
+      ++n;
+    } else if (fabs(_data[idx]) < keepDist) {
+      // cells that weren't kept are known to be at least keepDist
+      // away, which the EDT from the sites can underestimate
+      _data[idx] = (signbit(_data[idx]) ? -keepDist : keepDist);
     }
+    _minDist = std::min(_minDist, _data[idx]);
+    _maxDist = std::max(_maxDist, _data[idx]);
   }
 
+  setLayout(layout);
+
   _gdata.clear();
 
   if (storeGradients) {
@@ -473,55 +576,317 @@ void DtGrid_t<real>::computeDists(bool storeGradients) {
 
 }
 
+// The lines of each pass of the EDT are independent, so each pass is
+// split across threads. Lines that are strided in memory (along y and
+// z) are transformed in tiles of EDT_TILE lines that are adjacent in
+// x, so gathering and scattering a tile reads whole cache lines.
+//
+// The sign of each cell is carried through the passes. In a signed
+// EDT, it also selects the channel: a positive cell holds its squared
+// distance to the nearest negative cell and vice versa. Either way,
+// each cell is a parabola site for the lower envelope only when its
+// value is finite.
+
+enum { EDT_TILE = 16 };
+
+// don't bother with threads for grids smaller than this
+static const size_t EDT_MIN_THREADED_SIZE = 32768;
+
+// Evaluates the lower envelope of the parabolas (x-p[j])^2 + f[j] at
+// the positions q[i], for m sites and nq queries that are both in
+// increasing order. v and z are scratch of size m and m+1.
 template <class real>
-void DtGrid_t<real>::_computeEDT() {
+static void envelope(const int* p, const real* f, int m,
+                     const int* q, int nq, real* out,
+                     int* v, real* z) {
 
-  size_t maxdim = this->_dims.max();
-  RealArray f(maxdim), ft(maxdim), zz(maxdim+1);
-  std::vector<int> v(maxdim);
+  const real inf = DtGrid_t<real>::DT_INF;
 
-  // along z
-  for (size_t y=0; y<this->ny(); ++y) {
-    for (size_t x=0; x<this->nx(); ++x) {
-      for (size_t z=0; z<this->nz(); ++z) {
-        f[z] = _data[this->sub2ind(x,y,z)];
-        assert(f[z] >= 0);
-      }
-      dt(f, this->nz(), ft, v, zz);
-      for (size_t z=0; z<this->nz(); ++z) {
-        _data[this->sub2ind(x,y,z)] = ft[z];
-      }
+  if (!m) {
+    for (int i=0; i<nq; ++i) { out[i] = inf; }
+    return;
+  }
+
+  int k = 0;
+
+  v[0] = 0;
+  z[0] = -inf;
+  z[1] =  inf;
+
+  for (int j=1; j<m; ++j) {
+    real s = ((f[j]+sqr(p[j]))-(f[v[k]]+sqr(p[v[k]])))/(2*p[j]-2*p[v[k]]);
+    while (s <= z[k]) {
+      --k;
+      s = ((f[j]+sqr(p[j]))-(f[v[k]]+sqr(p[v[k]])))/(2*p[j]-2*p[v[k]]);
     }
+    ++k;
+    v[k] = j;
+    z[k] = s;
+    z[k+1] = inf;
   }
 
-  // along y
-  for (size_t z=0; z<this->nz(); ++z) {
-    for (size_t x=0; x<this->nx(); ++x) {
-      for (size_t y=0; y<this->ny(); ++y) {
-        f[y] = _data[this->sub2ind(x,y,z)];
-        assert(f[y] >= 0);
+  k = 0;
+  for (int i=0; i<nq; ++i) {
+    while (z[k+1] < q[i]) { ++k; }
+    out[i] = sqr(q[i]-p[v[k]]) + f[v[k]];
+  }
+
+}
+
+template <class Job>
+struct JobRange {
+  const Job* job;
+  size_t begin, end;
+};
+
+template <class Job>
+static void* runJobRange(void* data) {
+  const JobRange<Job>* r = (const JobRange<Job>*)data;
+  r->job->run(r->begin, r->end);
+  return 0;
+}
+
+// calls job.run(begin, end) on nthreads contiguous pieces of [0, n),
+// the calling thread doing the last one.
+template <class Job>
+static void parallelFor(const Job& job, size_t n, size_t nthreads) {
+
+  nthreads = std::max(size_t(1), std::min(nthreads, n));
+
+  std::vector< JobRange<Job> > ranges(nthreads);
+  std::vector<pthread_t> threads(nthreads);
+
+  for (size_t i=0; i<nthreads; ++i) {
+    ranges[i].job = &job;
+    ranges[i].begin = n * i / nthreads;
+    ranges[i].end = n * (i+1) / nthreads;
+  }
+
+  for (size_t i=0; i+1<nthreads; ++i) {
+    if (pthread_create(&threads[i], 0, runJobRange<Job>, &ranges[i])) {
+      // fall back to doing it here
+      threads[i] = pthread_self();
+      job.run(ranges[i].begin, ranges[i].end);
+    }
+  }
+
+  job.run(ranges.back().begin, ranges.back().end);
+
+  for (size_t i=0; i+1<nthreads; ++i) {
+    if (!pthread_equal(threads[i], pthread_self())) {
+      pthread_join(threads[i], 0);
+    }
+  }
+
+}
+
+template <class real>
+struct EDTPass {
+
+  real* data;
+
+  size_t n;            // length of each line
+  size_t stride;       // offset between consecutive elements of a line
+  size_t ninner;       // number of lines adjacent in memory
+  size_t outerStride;  // offset between groups of adjacent lines
+  size_t tilesPerOuter;
+
+  bool signedDist;     // two channels, selected by sign
+  bool last;           // take the sqrt and scale on the last pass
+  real cellSize;
+
+  size_t count;        // number of tiles, or of lines if stride is 1
+
+  // transforms tiles [begin, end)
+  void run(size_t begin, size_t end) const;
+
+};
+
+template <class real>
+class EDTLine {
+public:
+
+  const EDTPass<real>& pass;
+
+  // per thread scratch
+  std::vector<int> p, q, v;
+  std::vector<real> f, z, out;
+
+  EDTLine(const EDTPass<real>& pass):
+    pass(pass),
+    p(pass.n), q(pass.n), v(pass.n),
+    f(pass.n), z(pass.n+1), out(pass.n) {}
+
+  real finish(real d2) const {
+    return pass.last ? sqrt(d2)*pass.cellSize : d2;
+  }
+
+  // transforms the line of n values starting at x, elements are
+  // stride apart.
+  void transform(real* x, size_t stride) {
+
+    const int n = pass.n;
+    const real inf = DtGrid_t<real>::DT_INF;
+
+    if (!pass.signedDist) {
+
+      int m = 0;
+      for (int i=0; i<n; ++i) {
+        real xi = fabs(x[i*stride]);
+        q[i] = i;
+        if (xi != inf) { p[m] = i; f[m] = xi; ++m; }
       }
-      dt(f, this->ny(), ft, v, zz);
-      for (size_t y=0; y<this->ny(); ++y) {
-        _data[this->sub2ind(x,y,z)] = ft[y];
+
+      envelope(&p[0], &f[0], m, &q[0], n, &out[0], &v[0], &z[0]);
+
+      for (int i=0; i<n; ++i) {
+        real d = finish(out[i]);
+        x[i*stride] = (signbit(x[i*stride]) ? -d : d);
       }
+
+      return;
+
     }
-  }
 
-  // along x
-  for (size_t z=0; z<this->nz(); ++z) {
-    for (size_t y=0; y<this->ny(); ++y) {
-      for (size_t x=0; x<this->nx(); ++x) {
-        f[x] = _data[this->sub2ind(x,y,z)];
-        assert(f[x] >= 0);
+    // one channel per sign. Cells of the other sign are zero in a
+    // channel, but only the ends of their runs can be nearest to a
+    // cell of this sign, so only those become sites.
+    for (int sign=0; sign<2; ++sign) {
+
+      int m = 0, nq = 0;
+
+      for (int i=0; i<n; ++i) {
+        real xi = x[i*stride];
+        if (bool(signbit(xi)) == bool(sign)) {
+          q[nq++] = i;
+          if (xi != inf && xi != -inf) { p[m] = i; f[m] = fabs(xi); ++m; }
+        } else if ((i > 0 && bool(signbit(x[(i-1)*stride])) == bool(sign)) ||
+                   (i+1 < n && bool(signbit(x[(i+1)*stride])) == bool(sign))) {
+          p[m] = i; f[m] = 0; ++m;
+        }
       }
-      dt(f, this->nx(), ft, v, zz);
-      for (size_t x=0; x<this->nx(); ++x) {
-        _data[this->sub2ind(x,y,z)] = sqrt(ft[x])*this->_cellSize;
+
+      envelope(&p[0], &f[0], m, &q[0], nq, &out[0], &v[0], &z[0]);
+
+      for (int i=0; i<nq; ++i) {
+        real d = finish(out[i]);
+        x[q[i]*stride] = (sign ? -d : d);
       }
+
     }
+
   }
 
+};
+
+template <class real>
+void EDTPass<real>::run(size_t begin, size_t end) const {
+
+  EDTLine<real> line(*this);
+
+  if (stride == 1) {
+    // contiguous lines need no tiling
+    for (size_t u=begin; u<end; ++u) {
+      line.transform(data + u*outerStride, 1);
+    }
+    return;
+  }
+
+  std::vector<real> tile(n*EDT_TILE);
+
+  for (size_t u=begin; u<end; ++u) {
+
+    size_t x0 = (u % tilesPerOuter) * EDT_TILE;
+    size_t w = std::min(size_t(EDT_TILE), ninner - x0);
+    real* base = data + (u / tilesPerOuter) * outerStride + x0;
+
+    for (size_t i=0; i<n; ++i) {
+      const real* src = base + i*stride;
+      for (size_t t=0; t<w; ++t) { tile[i*EDT_TILE + t] = src[t]; }
+    }
+
+    for (size_t t=0; t<w; ++t) {
+      line.transform(&tile[t], EDT_TILE);
+    }
+
+    for (size_t i=0; i<n; ++i) {
+      real* dst = base + i*stride;
+      for (size_t t=0; t<w; ++t) { dst[t] = tile[i*EDT_TILE + t]; }
+    }
+
+  }
+
+}
+
+template <class real>
+static void computeEDTPass(const EDTPass<real>& pass, size_t nthreads) {
+
+  // the unsigned transform of a single element is itself
+  if (pass.n == 1 && !pass.last && !pass.signedDist) { return; }
+
+  parallelFor(pass, pass.count, nthreads);
+
+}
+
+template <class real>
+size_t DtGrid_t<real>::_numThreads = 0;
+
+template <class real>
+void DtGrid_t<real>::setNumThreads(size_t n) { _numThreads = n; }
+
+template <class real>
+size_t DtGrid_t<real>::numThreads() {
+  if (_numThreads) { return _numThreads; }
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+template <class real>
+void DtGrid_t<real>::_computeEDT(bool signedDist) {
+
+  size_t nx = this->nx(), ny = this->ny(), nz = this->nz();
+
+  size_t nthreads = (this->_size < EDT_MIN_THREADED_SIZE ? 1 : numThreads());
+
+  EDTPass<real> pass;
+  pass.data = &_data[0];
+  pass.cellSize = this->_cellSize;
+  pass.signedDist = signedDist;
+
+  // along z, in tiles of adjacent x
+  pass.n = nz;
+  pass.stride = nx*ny;
+  pass.ninner = nx;
+  pass.outerStride = nx;
+  pass.tilesPerOuter = (nx + EDT_TILE - 1) / EDT_TILE;
+  pass.count = pass.tilesPerOuter * ny;
+  pass.last = false;
+  computeEDTPass(pass, nthreads);
+
+  // along y, in tiles of adjacent x
+  pass.n = ny;
+  pass.stride = nx;
+  pass.ninner = nx;
+  pass.outerStride = nx*ny;
+  pass.tilesPerOuter = (nx + EDT_TILE - 1) / EDT_TILE;
+  pass.count = pass.tilesPerOuter * nz;
+  computeEDTPass(pass, nthreads);
+
+  // along x, one contiguous line at a time
+  pass.n = nx;
+  pass.stride = 1;
+  pass.ninner = 1;
+  pass.outerStride = nx;
+  pass.tilesPerOuter = 1;
+  pass.count = ny*nz;
+  pass.last = true;
+  computeEDTPass(pass, nthreads);
+
+}
+
+template <class real>
+void DtGrid_t<real>::computeGradients() {
+  _createGradients();
 }
 
 template <class real>
@@ -529,17 +894,17 @@ void DtGrid_t<real>::_createGradients() {
 
   _gdata.clear();
 
-  Vec3Array tmp(this->_size);
+  Vec3Array tmp(_data.size(), vec3(0));
     
   for (size_t z=0; z<this->nz(); ++z) {
     for (size_t y=0; y<this->ny(); ++y) {
       for (size_t x=0; x<this->nx(); ++x) {
-        tmp[this->sub2ind(x,y,z)] = gradient(x,y,z);
+        tmp[_index(x,y,z)] = _computeGradient(vec3u(x,y,z));
       }
     }
   }
   
-  tmp.swap(_gdata);
+  _gdata.swap(tmp);
 
 }
 
@@ -573,7 +938,7 @@ inline bool operator<(const HitStruct_t<real>& a, const HitStruct_t<real>& b) {
 template <class real>
 void DtGrid_t<real>::scanConvert(const TriMesh3& g, bool asHeightmap) {
 
-  _scanConvert(g, 0, asHeightmap);
+  _scanConvert(g, 0, asHeightmap, 0);
 
 }
 
@@ -582,18 +947,173 @@ void DtGrid_t<real>::scanConvert(const TriMesh3& g,
                                  const Transform3& tx, 
                                  bool asHeightmap) {
 
-  _scanConvert(g, &tx, asHeightmap);
+  _scanConvert(g, &tx, asHeightmap, 0);
 
 }
-                     
+
+
+// Casts a line through the cell centers of each row along axis and
+// merges the mesh into the cells it crosses: inside cells (positive
+// winding number) are negative, cells within band of the surface get
+// their exact distance, and the rest +/-DT_INF. Each cell keeps the
+// smaller of its old and new value, so meshes accumulate as a union.
+template <class real>
+struct MeshScanJob {
+
+  typedef vec3_t<real> vec3;
+  typedef typename TriMeshBVH_t<real>::Hit Hit;
+
+  DtGrid_t<real>* grid;
+  const TriMeshBVH_t<real>* bvh;
+  real band;
+
+  void run(size_t begin, size_t end) const {
+
+    const real inf = DtGrid_t<real>::DT_INF;
+    const size_t nx = grid->nx(), ny = grid->ny();
+
+    Box3_t<real> near = bvh->bbox();
+    near.dilate(band);
+
+    std::vector<Hit> hits;
+
+    for (size_t row=begin; row<end; ++row) {
+
+      size_t y = row % ny, z = row / ny;
+
+      hits.clear();
+      bvh->lineHits(grid->cellCenter(0, y, z), 0, hits);
+      std::sort(hits.begin(), hits.end());
+
+      size_t h = 0;
+      int winding = 0;
+
+      for (size_t x=0; x<nx; ++x) {
+
+        vec3 p = grid->cellCenter(x, y, z);
+
+        // a crossing with the normal along -x enters the mesh
+        for (; h<hits.size() && hits[h].t < p[0]; ++h) {
+          winding -= hits[h].orient;
+        }
+
+        real d = inf;
+
+        if (near.contains(p)) {
+          vec3 closest;
+          size_t face;
+          real dist = bvh->closestPoint(p, band, closest, face);
+          if (dist < band) { d = dist; }
+        }
+
+        if (winding > 0) { d = -d; }
+
+        real& cur = (*grid)(x, y, z);
+        cur = std::min(cur, d);
+
+      }
+
+    }
+
+  }
+
+};
+
+// merges the highest crossing of each column along the reference
+// axis into the heightmap.
+template <class real>
+struct MeshHeightJob {
+
+  typedef typename TriMeshBVH_t<real>::Hit Hit;
+
+  DtGrid_t<real>* grid;
+  const TriMeshBVH_t<real>* bvh;
+
+  void run(size_t begin, size_t end) const {
+
+    const vec3u& ax = grid->referenceAxes();
+    const size_t nu = grid->dims()[ax[0]];
+
+    std::vector<Hit> hits;
+
+    for (size_t col=begin; col<end; ++col) {
+
+      vec3u s(0);
+      s[ax[0]] = col % nu;
+      s[ax[1]] = col / nu;
+
+      hits.clear();
+      bvh->lineHits(grid->cellCenter(s), ax[2], hits);
+      if (hits.empty()) { continue; }
+
+      real& height = grid->height(s[ax[0]], s[ax[1]]);
+      height = std::max(height, std::max_element(hits.begin(), 
+                                                 hits.end())->t);
+
+    }
+
+  }
+
+};
 
 template <class real>
 void DtGrid_t<real>::_scanConvert(const TriMesh3& g, 
                                   const Transform3* ptx, 
-                                  bool asHeightmap) {
+                                  bool asHeightmap,
+                                  real band) {
 
+  if (this->empty()) { return; }
+
+  TriMeshBVH_t<real> bvh(g, ptx);
+
+  size_t nthreads = (this->_size < EDT_MIN_THREADED_SIZE ? 1 : numThreads());
+
+  if (asHeightmap) {
+
+    MeshHeightJob<real> job;
+    job.grid = this;
+    job.bvh = &bvh;
+
+    parallelFor(job, this->_dims[_ax[0]] * this->_dims[_ax[1]], nthreads);
 
-  throw std::runtime_error("_scanConvert not implemented yet");
+    _hmap.recomputeExtents();
+
+  } else {
+
+    MeshScanJob<real> job;
+    job.grid = this;
+    job.bvh = &bvh;
+    // what computeDists() keeps as exact near the surface
+    job.band = std::max(band, real(0.87*this->_cellSize));
+
+    parallelFor(job, this->ny() * this->nz(), nthreads);
+
+  }
+
+}
+
+template <class real>
+void DtGrid_t<real>::computeDistsFromMesh(const TriMesh3& model, 
+                                          real band,
+                                          bool storeGradients) {
+
+  computeDistsFromMesh(model, Transform3(), band, storeGradients);
+
+}
+
+template <class real>
+void DtGrid_t<real>::computeDistsFromMesh(const TriMesh3& model, 
+                                          const Transform3& transform,
+                                          real band,
+                                          bool storeGradients) {
+
+  if (this->empty()) { return; }
+
+  for (size_t i=0; i<_data.size(); ++i) { _data[i] = DT_INF; }
+
+  _scanConvert(model, &transform, false, band);
+
+  _computeDists(band, storeGradients);
 
 }
 
@@ -647,14 +1167,40 @@ vec3_t<real> DtGrid_t<real>::heightVec(const vec2u& s) const {
   return heightVec(s[0], s[1]);
 }
 
+template <class real>
+void DtGrid_t<real>::updateRegion(const vec3u& lo, const vec3u& hi) {
+
+  if (this->empty()) { return; }
+
+  vec3u l, h;
+  for (int d=0; d<3; ++d) {
+    // the gradient of a cell depends on its neighbors
+    l[d] = lo[d] > 0 ? lo[d]-1 : 0;
+    h[d] = std::min(hi[d]+1, this->_dims[d]-1);
+  }
+
+  for (size_t z=l[2]; z<=h[2]; ++z) {
+    for (size_t y=l[1]; y<=h[1]; ++y) {
+      for (size_t x=l[0]; x<=h[0]; ++x) {
+        size_t i = _index(x,y,z);
+        _minDist = std::min(_data[i], _minDist);
+        _maxDist = std::max(_data[i], _maxDist);
+        if (!_gdata.empty()) {
+          _gdata[i] = _computeGradient(vec3u(x,y,z));
+        }
+      }
+    }
+  }
+
+}
+
 template <class real>
 void DtGrid_t<real>::recomputeExtents() {
 
   for (size_t z=0; z<this->nz(); ++z) {
     for (size_t y=0; y<this->ny(); ++y) {
       for (size_t x=0; x<this->nx(); ++x) {
-        vec3u s(x,y,z);
-        size_t i = this->sub2ind(s);
+        size_t i = _index(x,y,z);
         _minDist = std::min(_data[i], _minDist);
         _maxDist = std::max(_data[i], _maxDist);
       }
@@ -685,20 +1231,18 @@ typename DtGrid_t<real>::Axis DtGrid_t<real>::referenceAxis() const {
 template <class real>
 class LineMin3_t {
 public:
-  const vec3u& dims;
-  const std::vector<real>& data;
+  const DtGrid_t<real>& grid;
   real& minVal;
   vec3u& minPixel;
   
-  LineMin3_t(const vec3u& sz,
-             const std::vector<real>& d,
+  LineMin3_t(const DtGrid_t<real>& g,
              real& mv, 
              vec3u& mp):
     
-    dims(sz), data(d), minVal(mv), minPixel(mp) {}
+    grid(g), minVal(mv), minPixel(mp) {}
   
   void operator()(const vec3u& pixel) {
-    real d = data[vec3u::sub2ind(dims,pixel)];            
+    real d = grid(pixel);            
     if (d < minVal) {                           
       minVal = d;                               
       minPixel = pixel;                         
@@ -736,9 +1280,9 @@ real DtGrid_t<real>::lineMin(const vec3u& s1, const vec3u& s2, vec3u& minPixel)
   minPixel = s1;
   if (this->empty()) { return 0; }
   
-  real minVal = _data[this->sub2ind(s1)];
+  real minVal = _data[_index(s1)];
 
-  LineMin3_t<real> lm(this->_dims, _data, minVal, minPixel);
+  LineMin3_t<real> lm(*this, minVal, minPixel);
   
   bresenham3D(s1, s2, lm);
 
@@ -760,12 +1304,237 @@ void put(std::ostream& ostr, const Tval& value) {
   }
 }
 
+// header of the binary format, in native byte order. Sections
+// start on page boundaries so they can be used in place when mapped.
+struct DtGridFileHeader {
+
+  static const char MAGIC[8];
+  enum { 
+    VERSION = 1, 
+    BYTE_ORDER_MARK = 0x01020304,
+    ALIGNMENT = 4096
+  };
+
+  char     magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t realSize;
+  uint32_t layout;
+  uint32_t ax[3];
+  uint32_t reserved;
+
+  uint64_t dims[3];
+  uint64_t hdims[2];
+
+  double   origin[3];
+  double   cellSize;
+  double   minDist;
+  double   maxDist;
+
+  // offsets are in bytes from the start of the file, counts in
+  // elements; a section with count 0 is absent.
+  uint64_t dataOffset, dataCount;
+  uint64_t gradOffset, gradCount;
+  uint64_t hmapOffset, hmapCount;
+
+  static uint64_t align(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+};
+
+const char DtGridFileHeader::MAGIC[8] = { 
+  'M', 'Z', 'D', 'T', 'G', 'R', 'I', 'D' 
+};
+
+static void putPadding(std::ostream& ostr, uint64_t offset) {
+  static const char zeros[DtGridFileHeader::ALIGNMENT] = { 0 };
+  uint64_t pos = ostr.tellp();
+  if (offset > pos && 
+      !ostr.write(zeros, offset - pos)) {
+    throw std::runtime_error("error writing!\n");
+  }
+}
+
+template <class real>
+bool DtGrid_t<real>::saveBinary(const char* filename) const {
+
+  std::ofstream ostr(filename, std::ios::binary);
+  if (!ostr.is_open()) { return false; }
+
+  DtGridFileHeader h;
+  memset(&h, 0, sizeof(h));
+
+  memcpy(h.magic, DtGridFileHeader::MAGIC, sizeof(h.magic));
+  h.version = DtGridFileHeader::VERSION;
+  h.byteOrder = DtGridFileHeader::BYTE_ORDER_MARK;
+  h.realSize = sizeof(real);
+  h.layout = _layout;
+
+  for (int i=0; i<3; ++i) {
+    h.ax[i] = _ax[i];
+    h.dims[i] = this->_dims[i];
+    h.origin[i] = this->_origin[i];
+  }
+
+  h.hdims[0] = _hmap.nx();
+  h.hdims[1] = _hmap.ny();
+  h.cellSize = this->_cellSize;
+  h.minDist = _minDist;
+  h.maxDist = _maxDist;
+
+  h.dataOffset = DtGridFileHeader::align(sizeof(h));
+  h.dataCount = _data.size();
+  h.gradOffset = DtGridFileHeader::align(h.dataOffset + 
+                                         h.dataCount*sizeof(real));
+  h.gradCount = _gdata.size();
+  h.hmapOffset = DtGridFileHeader::align(h.gradOffset + 
+                                         h.gradCount*sizeof(vec3));
+  h.hmapCount = _hmap.size();
+
+  try {
+
+    put(ostr, h);
+
+    if (h.dataCount) {
+      putPadding(ostr, h.dataOffset);
+      ostr.write((const char*)&_data[0], h.dataCount*sizeof(real));
+    }
+
+    if (h.gradCount) {
+      putPadding(ostr, h.gradOffset);
+      ostr.write((const char*)&_gdata[0], h.gradCount*sizeof(vec3));
+    }
+
+    putPadding(ostr, h.hmapOffset);
+    for (size_t i=0; i<_hmap.size(); ++i) {
+      put(ostr, _hmap[i]);
+    }
+
+  } catch (...) {
+    return false;
+  }
+
+  return !ostr.fail();
+
+}
+
+template <class real>
+bool DtGrid_t<real>::loadBinary(const char* filename, 
+                                bool storeGradients) {
+
+  FileMapping mapping;
+  if (!mapping.map(filename)) { return false; }
+
+  DtGridFileHeader h;
+  if (mapping.size() < sizeof(h)) { return false; }
+  memcpy(&h, mapping.data(), sizeof(h));
+
+  if (memcmp(h.magic, DtGridFileHeader::MAGIC, sizeof(h.magic)) ||
+      h.version != DtGridFileHeader::VERSION ||
+      h.byteOrder != DtGridFileHeader::BYTE_ORDER_MARK ||
+      h.realSize != sizeof(real) ||
+      sizeof(vec3) != 3*sizeof(real) ||
+      h.layout > LAYOUT_MORTON) {
+    return false;
+  }
+
+  // the axes must be the rotation _create() makes from the
+  // reference axis, since everything downstream indexes with them
+  if (h.ax[2] >= 3 ||
+      h.ax[0] != (h.ax[2] + 1) % 3 ||
+      h.ax[1] != (h.ax[2] + 2) % 3) {
+    return false;
+  }
+
+  // every section must lie inside the file, aligned for its type;
+  // counts are compared by division so a huge count can't overflow
+  const uint64_t offsets[3] = { h.dataOffset, h.gradOffset, h.hmapOffset };
+  const uint64_t counts[3] = { h.dataCount, h.gradCount, h.hmapCount };
+  const uint64_t sizes[3] = { sizeof(real), sizeof(vec3), sizeof(real) };
+
+  for (int i=0; i<3; ++i) {
+    if (offsets[i] % sizeof(real) || 
+        offsets[i] > mapping.size() ||
+        counts[i] > (mapping.size() - offsets[i]) / sizes[i]) {
+      return false;
+    }
+  }
+
+  // the dims can't hold more cells than the data section before
+  // _createLayout() allocates tables and storage for them
+  uint64_t cells = 1;
+  for (int i=0; i<3; ++i) {
+    if (!h.dims[i] || h.dims[i] > h.dataCount / cells) { return false; }
+    cells *= h.dims[i];
+  }
+
+  clear();
+
+  vec3u dims(h.dims[0], h.dims[1], h.dims[2]);
+  vec3 origin(h.origin[0], h.origin[1], h.origin[2]);
+
+  this->_resize(dims, h.cellSize, origin);
+
+  for (int i=0; i<3; ++i) { _ax[i] = h.ax[i]; }
+
+  _layout = Layout(h.layout);
+
+  if (_createLayout() != h.dataCount ||
+      (h.gradCount && h.gradCount != h.dataCount) ||
+      h.hdims[0] != this->_dims[_ax[0]] ||
+      h.hdims[1] != this->_dims[_ax[1]] ||
+      h.hmapCount != h.hdims[0]*h.hdims[1]) {
+    clear();
+    return false;
+  }
+
+  _hmap.resize(this->_dims[_ax[0]], this->_dims[_ax[1]], 
+               this->_cellSize,
+               vec2(this->_origin[_ax[0]], this->_origin[_ax[1]]));
+
+  const real* hdata = (const real*)(mapping.data() + h.hmapOffset);
+  for (size_t i=0; i<_hmap.size(); ++i) {
+    _hmap[i] = hdata[i];
+  }
+  _hmap.recomputeExtents();
+
+  _minDist = h.minDist;
+  _maxDist = h.maxDist;
+
+  _data.setExternal((real*)(mapping.data() + h.dataOffset), h.dataCount);
+
+  if (h.gradCount && storeGradients) {
+    _gdata.setExternal((vec3*)(mapping.data() + h.gradOffset), 
+                       h.gradCount);
+  }
+
+  _mapping.swap(mapping);
+
+  if (storeGradients && _gdata.empty()) {
+    _createGradients();
+  }
+
+  return true;
+
+}
+
 template <class real>
 bool DtGrid_t<real>::load(const char* filename, bool storeGradients) {
 
-  std::ifstream istr(filename);
+  std::ifstream istr(filename, std::ios::binary);
   if (!istr.is_open()) { return false; }
 
+  char magic[sizeof(DtGridFileHeader::MAGIC)];
+  if (istr.read(magic, sizeof(magic)) &&
+      !memcmp(magic, DtGridFileHeader::MAGIC, sizeof(magic))) {
+    istr.close();
+    return loadBinary(filename, storeGradients);
+  }
+
+  istr.clear();
+  istr.seekg(0);
+
   clear();
 
   try {
@@ -808,6 +1577,11 @@ bool DtGrid_t<real>::load(const char* filename, bool storeGradients) {
     get(istr, _maxDist);
     _hmap.recomputeExtents();
 
+    Layout layout = _layout;
+    _layout = LAYOUT_LINEAR;
+    _createLayout();
+    setLayout(layout);
+
   } catch (...) {
     
     clear();
@@ -826,7 +1600,7 @@ bool DtGrid_t<real>::load(const char* filename, bool storeGradients) {
 template <class real>
 void DtGrid_t<real>::save(const char* filename) const { 
 
-  std::ofstream ostr(filename);
+  std::ofstream ostr(filename, std::ios::binary);
   if (!ostr.is_open()) { return; }
 
 
@@ -841,7 +1615,7 @@ void DtGrid_t<real>::save(const char* filename) const {
   put(ostr, this->_cellSize);
 
   for (size_t i=0; i<this->_size; ++i) {
-    put(ostr, _data[i]);
+    put(ostr, (*this)[i]);
   }
 
   for (size_t i=0; i<_hmap.size(); ++i) {
@@ -928,8 +1702,7 @@ void DtGrid_t<real>::processPointCloudAsHeightmap(const std::vector<vec3>& point
         }
 
         // choose magnitude of smaller and negate if either negative
-        size_t idx = this->sub2ind(s);
-        real& cur = _data[idx];
+        real& cur = _data[_index(s)];
 
         bool neg = (d < 0 || cur < 0);
         cur = std::min(fabs(d), fabs(cur)) * (neg ? -1 : 1);
@@ -1011,7 +1784,7 @@ void DtGrid_t<real>::computeDistsFromHeightMap(bool storeGradients) {
           d = -DT_INF;
         }
 
-        _data[this->sub2ind(s)] = d;
+        _data[_index(s)] = d;
 
       }
 
@@ -1023,6 +1796,99 @@ void DtGrid_t<real>::computeDistsFromHeightMap(bool storeGradients) {
   
 }
 
+template <class real>
+typename DtGrid_t<real>::Layout DtGrid_t<real>::layout() const {
+  return _layout;
+}
+
+template <class real>
+size_t DtGrid_t<real>::_createLayout() {
+
+  // brick extents and number of bricks along each axis; the linear
+  // layout is a single brick covering the grid.
+  vec3u b, nb;
+
+  for (int j=0; j<3; ++j) {
+    size_t n = this->_dims[j];
+    switch (_layout) {
+    case LAYOUT_BRICKED: b[j] = std::min(n, size_t(4)); break;
+    case LAYOUT_MORTON:  b[j] = (n > 1 ? 8 : 1); break;
+    default:             b[j] = n; break;
+    }
+    nb[j] = (n + b[j] - 1) / b[j];
+  }
+
+  // Morton order interleaves the bits of the axes that have any
+  size_t rank[3], naxes = 0;
+  for (int j=0; j<3; ++j) {
+    rank[j] = naxes;
+    if (b[j] > 1) { ++naxes; }
+  }
+
+  size_t cellStride = 1, brickStride = b.prod();
+
+  for (int j=0; j<3; ++j) {
+
+    _loff[j].resize(this->_dims[j]);
+
+    for (size_t c=0; c<this->_dims[j]; ++c) {
+
+      size_t w = c % b[j], within = 0;
+
+      if (_layout == LAYOUT_MORTON) {
+        for (size_t bit=0; (w >> bit); ++bit) {
+          within |= ((w >> bit) & 1) << (bit*naxes + rank[j]);
+        }
+      } else {
+        within = w * cellStride;
+      }
+
+      _loff[j][c] = (c / b[j]) * brickStride + within;
+
+    }
+
+    cellStride *= b[j];
+    brickStride *= nb[j];
+
+  }
+
+  return brickStride;
+
+}
+
+template <class real>
+void DtGrid_t<real>::setLayout(Layout layout) {
+
+  if (layout == _layout) { return; }
+
+  std::vector<size_t> oldOff[3];
+  for (int j=0; j<3; ++j) { oldOff[j].swap(_loff[j]); }
+
+  _layout = layout;
+
+  if (this->empty()) { return; }
+
+  size_t storage = _createLayout();
+
+  RealArray data(storage, DT_INF);
+  Vec3Array gdata(_gdata.empty() ? 0 : storage, vec3(0));
+
+  for (size_t z=0; z<this->nz(); ++z) {
+    for (size_t y=0; y<this->ny(); ++y) {
+      for (size_t x=0; x<this->nx(); ++x) {
+        size_t from = oldOff[0][x] + oldOff[1][y] + oldOff[2][z];
+        size_t to = _index(x,y,z);
+        data[to] = _data[from];
+        if (!gdata.empty()) { gdata[to] = _gdata[from]; }
+      }
+    }
+  }
+
+  _data.swap(data);
+  _gdata.swap(gdata);
+
+}
+
 template class DtGrid_t<float>;
 template class DtGrid_t<double>;
 
@@ -39,6 +39,7 @@
 #include "vec2u.h"
 #include "vec2.h"
 #include "HeightMap.h"
+#include "MappedArray.h"
 
 template <class real>
 class DtGrid_t: public Grid3_t<real> {
@@ -62,6 +63,15 @@ public:
     AXIS_Z = 2,
   };
 
+  // order of the cells in memory. Bricked layouts keep the 8 cells
+  // of a trilinear lookup in one or two cache lines; cells past the
+  // edge of the grid are padded out to whole bricks.
+  enum Layout {
+    LAYOUT_LINEAR = 0,  // x fastest, as Grid3_t::sub2ind
+    LAYOUT_BRICKED = 1, // 4x4x4 bricks of linearly ordered cells
+    LAYOUT_MORTON = 2,  // 8x8x8 bricks of Morton ordered cells
+  };
+
   //////////////////////////////////////////////////////////////////////
 
   DtGrid_t();
@@ -114,6 +124,14 @@ public:
 
   real sample(const vec3& v, vec3& gradient) const;
 
+  // samples n points at once, giving the same results as calling
+  // sample() on each. grads may be NULL. Cells and weights are
+  // computed for a block of points at a time in structure-of-arrays
+  // form so the compiler can vectorize them, and values and
+  // gradients are gathered in a single pass over the corners.
+  void sampleBatch(const vec3* pts, size_t n, 
+                   real* vals, vec3* grads) const;
+
   // returns the position of minimum value along the line connecting
   // s1 and s2
   real lineMin(const vec3u& s1, const vec3u& s2, vec3u& smin) const;
@@ -147,6 +165,11 @@ public:
   real minDist() const;
   real maxDist() const;
 
+  // adds a closed mesh to the grid: cells within a cell of its
+  // surface get their exact signed distance and cells further away
+  // +/-DT_INF, ready for computeDists(). With asHeightmap, the top
+  // of the mesh along the reference axis is merged into the
+  // heightmap instead, for computeDistsFromHeightMap().
   void scanConvert(const TriMesh3& model, 
                    bool asHeightmap=false);
 
@@ -164,35 +187,108 @@ public:
 
   void computeDistsFromBinary(bool storeGradients=true);
 
+  // signed distances to a closed mesh, exact for cells within band of
+  // its surface (computed in parallel using a BVH) and filled in by
+  // the EDT elsewhere. Inside is where the winding number of the
+  // mesh along x is positive.
+  void computeDistsFromMesh(const TriMesh3& model, real band,
+                            bool storeGradients=true);
+
+  void computeDistsFromMesh(const TriMesh3& model,
+                            const Transform3& transform,
+                            real band,
+                            bool storeGradients=true);
+
   void recomputeExtents();
 
+  // (re)computes the stored gradients from the current distances.
+  void computeGradients();
+
+  Layout layout() const;
+
+  // reorders the cells and stored gradients. The layout is kept
+  // through resize() and load(); the distance transforms and save()
+  // work on a linear copy internally.
+  void setLayout(Layout layout);
+
+  // call after changing the distances of the cells in the box
+  // [lo, hi] through operator(): recomputes the stored gradients
+  // that depend on them, and widens minDist/maxDist to cover them.
+  void updateRegion(const vec3u& lo, const vec3u& hi);
+
   static void dt(const RealArray& f,
                  size_t n,
                  RealArray& ft,
                  IntArray& v,
                  RealArray& z);
 
+  // the number of threads used to compute distance transforms,
+  // 0 (the default) uses one per processor.
+  static void setNumThreads(size_t n);
+  static size_t numThreads();
+
+  // load() reads either format below, telling them apart by the
+  // first bytes of the file.
   bool load(const char* filename, bool storeGradients=true);
   void save(const char* filename) const;
+
+  // The binary format is a fixed header followed by page aligned
+  // sections holding the distances (in the current layout), the
+  // gradients if stored, and the heightmap. loadBinary() maps the
+  // file copy-on-write and uses the distances and gradients in
+  // place, so processes loading the same file share one copy in the
+  // page cache. Gradients are only computed if the file has none and
+  // storeGradients is set.
+  bool saveBinary(const char* filename) const;
+  bool loadBinary(const char* filename, bool storeGradients=true);
    
 private:
 
   void _create();
   void _createGradients();
-  void _computeEDT();
+
+  // fills _loff for _layout and returns the number of cells to
+  // store, including padding.
+  size_t _createLayout();
+
+  size_t _index(size_t x, size_t y, size_t z) const {
+    return _loff[0][x] + _loff[1][y] + _loff[2][z];
+  }
+
+  size_t _index(const vec3u& s) const {
+    return _index(s[0], s[1], s[2]);
+  }
+
+  vec3 _computeGradient(vec3u s) const;
+  // distance transform of _data, carrying the sign of each
+  // cell. If signedDist, positive and negative cells are measured to
+  // the nearest cell of the other sign; otherwise to the nearest
+  // finite cell.
+  void _computeEDT(bool signedDist=false);
+
+  static size_t _numThreads;
   
   real _sample(const vec3& v, vec3* gradient) const;
 
   void _scanConvert(const TriMesh3& model, 
                     const Transform3* transform,
-                    bool asHeightmap);
+                    bool asHeightmap,
+                    real band);
+
+  // computeDists(), also keeping the values of cells closer than
+  // keepDist to the surface.
+  void _computeDists(real keepDist, bool storeGradients);
 
   vec3u  _ax;
   
-  RealArray _data;
+  MappedArray<real> _data;
 
   // gradient data
-  Vec3Array _gdata;
+  MappedArray<vec3> _gdata;
+
+  // per axis offsets into _data of each cell coordinate
+  Layout _layout;
+  std::vector<size_t> _loff[3];
 
   real _minDist;
   real _maxDist;
@@ -200,6 +296,10 @@ private:
   // heightmap data
   HeightMap _hmap;
 
+  // backs _data and _gdata after loadBinary(); declared after them
+  // so that assigning a grid copies their contents before unmapping.
+  FileMapping _mapping;
+
 };
 
 typedef DtGrid_t<float> DtGridf;
@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "DtGridPyramid.h"
+#include <assert.h>
+
+template <class real>
+DtGridPyramid_t<real>::DtGridPyramid_t(): _base(0) {}
+
+template <class real>
+void DtGridPyramid_t<real>::clear() {
+  _base = 0;
+  _levels.clear();
+}
+
+template <class real>
+void DtGridPyramid_t<real>::build(const DtGrid& grid, 
+                                  size_t numLevels,
+                                  bool storeGradients) {
+
+  clear();
+
+  if (grid.empty() || !numLevels) { return; }
+
+  _base = &grid;
+  _levels.reserve(numLevels-1);
+
+  while (numLevels > 1 + _levels.size()) {
+
+    const DtGrid& fine = level(_levels.size());
+    const vec3u& fdims = fine.dims();
+
+    if (fdims.prod() == 1) { break; }
+
+    vec3u dims;
+    for (int i=0; i<3; ++i) { dims[i] = (fdims[i] + 1) / 2; }
+
+    _levels.push_back(DtGrid());
+    DtGrid& coarse = _levels.back();
+
+    coarse.resize(dims[0], dims[1], dims[2], fine.referenceAxis(),
+                  2*fine.cellSize(), fine.origin());
+
+    for (size_t z=0; z<dims[2]; ++z) {
+      for (size_t y=0; y<dims[1]; ++y) {
+        for (size_t x=0; x<dims[0]; ++x) {
+          real d = DtGrid::DT_INF;
+          for (size_t dz=0; dz<2 && 2*z+dz<fdims[2]; ++dz) {
+            for (size_t dy=0; dy<2 && 2*y+dy<fdims[1]; ++dy) {
+              for (size_t dx=0; dx<2 && 2*x+dx<fdims[0]; ++dx) {
+                d = std::min(d, fine(2*x+dx, 2*y+dy, 2*z+dz));
+              }
+            }
+          }
+          coarse(x,y,z) = d;
+        }
+      }
+    }
+
+    coarse.recomputeExtents();
+    coarse.setLayout(grid.layout());
+
+    if (storeGradients) { coarse.computeGradients(); }
+
+  }
+
+}
+
+template <class real>
+size_t DtGridPyramid_t<real>::numLevels() const {
+  return _base ? 1 + _levels.size() : 0;
+}
+
+template <class real>
+const DtGrid_t<real>& DtGridPyramid_t<real>::level(size_t i) const {
+  assert(i < numLevels());
+  return i ? _levels[i-1] : *_base;
+}
+
+template <class real>
+size_t DtGridPyramid_t<real>::levelForSpacing(real spacing) const {
+  size_t i = 0;
+  while (i+1 < numLevels() && level(i+1).cellSize() <= spacing) { ++i; }
+  return i;
+}
+
+template class DtGridPyramid_t<float>;
+template class DtGridPyramid_t<double>;
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _DTGRIDPYRAMID_H_
+#define _DTGRIDPYRAMID_H_
+
+#include "DtGrid.h"
+#include <vector>
+
+// A mipmap of a distance field: level 0 is the grid itself and each
+// level above it has cells twice as large, holding the minimum of
+// the (up to 8) cells of the level below that it covers. A coarse
+// level never reports more clearance than the finer cells under it,
+// and is small enough to stay in cache while optimizing coarse
+// trajectories.
+
+template <class real>
+class DtGridPyramid_t {
+public:
+
+  typedef DtGrid_t<real> DtGrid;
+
+  DtGridPyramid_t();
+
+  // builds up to numLevels levels (including grid, which must
+  // outlive the pyramid), stopping early once a level is a single
+  // cell. Coarse levels get the layout of grid.
+  void build(const DtGrid& grid, size_t numLevels, 
+             bool storeGradients=true);
+
+  void clear();
+
+  size_t numLevels() const;
+
+  const DtGrid& level(size_t i) const;
+
+  // the coarsest level whose cells are no larger than spacing, or
+  // level 0 if there is none.
+  size_t levelForSpacing(real spacing) const;
+
+private:
+
+  // level 0 is not owned, so a copy would point at the old grid
+  DtGridPyramid_t(const DtGridPyramid_t&);
+  DtGridPyramid_t& operator=(const DtGridPyramid_t&);
+
+  const DtGrid* _base;
+
+  // levels 1 and up
+  std::vector<DtGrid> _levels;
+
+};
+
+typedef DtGridPyramid_t<float> DtGridPyramidf;
+typedef DtGridPyramid_t<double> DtGridPyramidd;
+
+#endif
@@ -0,0 +1,339 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "DynamicDtGrid.h"
+#include <limits.h>
+#include <math.h>
+#include <assert.h>
+
+template <class real>
+DynamicDtGrid_t<real>::DynamicDtGrid_t(DtGrid& grid):
+  _grid(grid),
+  _dims(grid.dims())
+{
+
+  size_t size = grid.size();
+
+  assert(size < size_t(INT_MAX));
+
+  Field* fields[2] = { &_outside, &_inside };
+  for (int i=0; i<2; ++i) {
+    fields[i]->site.resize(size, NO_SITE);
+    fields[i]->sqdist.resize(size, INT_MAX);
+    fields[i]->raise.resize(size, 0);
+  }
+
+  _occupied.resize(size);
+  _isChanged.resize(size, 0);
+
+  for (int d=0; d<3; ++d) {
+    _brickDims[d] = (_dims[d] + BRICK_SIZE - 1) / BRICK_SIZE;
+  }
+
+  size_t nbricks = _brickDims[0] * _brickDims[1] * _brickDims[2];
+  _brickLo.resize(nbricks);
+  _brickHi.resize(nbricks);
+  _brickChanged.resize(nbricks, 0);
+
+  for (int dz=-1; dz<=1; ++dz) {
+    for (int dy=-1; dy<=1; ++dy) {
+      for (int dx=-1; dx<=1; ++dx) {
+        if (dx || dy || dz) {
+          Offset o = { dx, dy, dz };
+          _neighbors.push_back(o);
+        }
+      }
+    }
+  }
+
+  // every cell is a site of one of the fields
+  for (size_t i=0; i<size; ++i) {
+    _occupied[i] = (grid[i] < 0);
+    _addSite(_occupied[i] ? _outside : _inside, i);
+  }
+
+  update();
+
+}
+
+template <class real>
+bool DynamicDtGrid_t<real>::occupied(const vec3u& s) const {
+  return _occupied[_grid.sub2ind(s)];
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::setOccupied(const vec3u& s, bool occupied) {
+
+  int idx = _grid.sub2ind(s);
+
+  if (bool(_occupied[idx]) == occupied) { return; }
+
+  _occupied[idx] = occupied;
+
+  if (occupied) {
+    _addSite(_outside, idx);
+    _removeSite(_inside, idx);
+  } else {
+    _removeSite(_outside, idx);
+    _addSite(_inside, idx);
+  }
+
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::setRegion(const vec3u& lo, const vec3u& hi,
+                                      bool occupied) {
+
+  for (size_t z=lo[2]; z<=hi[2] && z<_dims[2]; ++z) {
+    for (size_t y=lo[1]; y<=hi[1] && y<_dims[1]; ++y) {
+      for (size_t x=lo[0]; x<=hi[0] && x<_dims[0]; ++x) {
+        setOccupied(vec3u(x,y,z), occupied);
+      }
+    }
+  }
+
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::applyMask(const vec3u& origin, 
+                                      const vec3u& size,
+                                      const unsigned char* mask) {
+
+  for (size_t z=0; z<size[2]; ++z) {
+    for (size_t y=0; y<size[1]; ++y) {
+      for (size_t x=0; x<size[0]; ++x, ++mask) {
+        vec3u s = origin + vec3u(x,y,z);
+        if (s[0] < _dims[0] && s[1] < _dims[1] && s[2] < _dims[2]) {
+          setOccupied(s, *mask);
+        }
+      }
+    }
+  }
+
+}
+
+template <class real>
+size_t DynamicDtGrid_t<real>::update() {
+
+  _propagate(_outside);
+  _propagate(_inside);
+
+  if (_changed.empty()) { return 0; }
+
+  for (size_t i=0; i<_changed.size(); ++i) {
+
+    int idx = _changed[i];
+    _grid[idx] = _value(idx);
+    _isChanged[idx] = 0;
+
+    vec3u s = _grid.ind2sub(idx);
+    int b = ((s[2] / BRICK_SIZE * _brickDims[1] + s[1] / BRICK_SIZE) 
+             * _brickDims[0] + s[0] / BRICK_SIZE);
+
+    if (!_brickChanged[b]) {
+      _brickChanged[b] = 1;
+      _brickLo[b] = _brickHi[b] = s;
+      _changedBricks.push_back(b);
+    } else {
+      for (int d=0; d<3; ++d) {
+        _brickLo[b][d] = std::min(_brickLo[b][d], s[d]);
+        _brickHi[b][d] = std::max(_brickHi[b][d], s[d]);
+      }
+    }
+
+  }
+
+  for (size_t i=0; i<_changedBricks.size(); ++i) {
+    int b = _changedBricks[i];
+    _grid.updateRegion(_brickLo[b], _brickHi[b]);
+    _brickChanged[b] = 0;
+  }
+
+  size_t count = _changed.size();
+  _changed.clear();
+  _changedBricks.clear();
+
+  return count;
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+template <class real>
+void DynamicDtGrid_t<real>::_addSite(Field& f, int idx) {
+  f.site[idx] = idx;
+  f.sqdist[idx] = 0;
+  f.raise[idx] = 0;
+  f.queue.push(QueueEntry(0, idx));
+  _touch(idx);
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::_removeSite(Field& f, int idx) {
+  f.site[idx] = NO_SITE;
+  f.sqdist[idx] = INT_MAX;
+  f.raise[idx] = 1;
+  f.queue.push(QueueEntry(0, idx));
+  _touch(idx);
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::_propagate(Field& f) {
+
+  while (!f.queue.empty()) {
+
+    QueueEntry e = f.queue.top();
+    f.queue.pop();
+
+    int idx = e.second;
+
+    if (f.raise[idx]) {
+      _raise(f, idx);
+    } else if (_isSite(f, f.site[idx])) {
+      // skip entries superseded by a closer site
+      if (e.first <= f.sqdist[idx]) { _lower(f, idx); }
+    } else if (f.site[idx] != NO_SITE) {
+      f.site[idx] = NO_SITE;
+      f.sqdist[idx] = INT_MAX;
+      _touch(idx);
+    }
+
+  }
+
+}
+
+// clears the neighbors whose site is gone, and queues the others to
+// lower into the hole.
+template <class real>
+void DynamicDtGrid_t<real>::_raise(Field& f, int idx) {
+
+  vec3u s = _grid.ind2sub(idx);
+
+  for (size_t i=0; i<_neighbors.size(); ++i) {
+
+    const Offset& o = _neighbors[i];
+    vec3u n(s[0]+o.dx, s[1]+o.dy, s[2]+o.dz);
+    if (n[0] >= _dims[0] || n[1] >= _dims[1] || n[2] >= _dims[2]) { 
+      continue; 
+    }
+
+    int nidx = _grid.sub2ind(n);
+
+    if (f.site[nidx] == NO_SITE || f.raise[nidx]) { continue; }
+
+    f.queue.push(QueueEntry(f.sqdist[nidx], nidx));
+
+    if (!_isSite(f, f.site[nidx])) {
+      f.raise[nidx] = 1;
+      f.site[nidx] = NO_SITE;
+      f.sqdist[nidx] = INT_MAX;
+      _touch(nidx);
+    }
+
+  }
+
+  f.raise[idx] = 0;
+
+}
+
+// offers the site of idx to its neighbors.
+template <class real>
+void DynamicDtGrid_t<real>::_lower(Field& f, int idx) {
+
+  vec3u s = _grid.ind2sub(idx);
+  int site = f.site[idx];
+
+  for (size_t i=0; i<_neighbors.size(); ++i) {
+
+    const Offset& o = _neighbors[i];
+    vec3u n(s[0]+o.dx, s[1]+o.dy, s[2]+o.dz);
+    if (n[0] >= _dims[0] || n[1] >= _dims[1] || n[2] >= _dims[2]) { 
+      continue; 
+    }
+
+    int nidx = _grid.sub2ind(n);
+
+    if (f.raise[nidx]) { continue; }
+
+    int d = _sqdist(nidx, site);
+
+    if (d < f.sqdist[nidx] ||
+        (d == f.sqdist[nidx] && !_isSite(f, f.site[nidx]))) {
+      f.site[nidx] = site;
+      f.sqdist[nidx] = d;
+      f.queue.push(QueueEntry(d, nidx));
+      _touch(nidx);
+    }
+
+  }
+
+}
+
+template <class real>
+int DynamicDtGrid_t<real>::_sqdist(int a, int b) const {
+  vec3u sa = _grid.ind2sub(a), sb = _grid.ind2sub(b);
+  int d = 0;
+  for (int i=0; i<3; ++i) {
+    int di = int(sa[i]) - int(sb[i]);
+    d += di*di;
+  }
+  return d;
+}
+
+template <class real>
+void DynamicDtGrid_t<real>::_touch(int idx) {
+  if (!_isChanged[idx]) {
+    _isChanged[idx] = 1;
+    _changed.push_back(idx);
+  }
+}
+
+// the same distance computeDistsFromBinary gives: from the boundary
+// of the cell to the center of the nearest cell of the other kind.
+template <class real>
+real DynamicDtGrid_t<real>::_value(int idx) const {
+
+  const Field& f = _occupied[idx] ? _inside : _outside;
+  real cs = _grid.cellSize();
+
+  real d = (f.sqdist[idx] == INT_MAX ? 
+            sqrt(DtGrid::DT_INF) : sqrt(real(f.sqdist[idx]))) * cs;
+
+  d = std::max(d - real(0.5)*cs, real(0));
+
+  return _occupied[idx] ? -d : d;
+
+}
+
+template class DynamicDtGrid_t<float>;
+template class DynamicDtGrid_t<double>;
@@ -0,0 +1,150 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _DYNAMICDTGRID_H_
+#define _DYNAMICDTGRID_H_
+
+#include "DtGrid.h"
+#include <vector>
+#include <queue>
+
+// Keeps the signed distance field of a DtGrid up to date as cells
+// become occupied or free, touching only the cells whose distance
+// changes. This is the dynamic brushfire of Lau, Sprunk and Burgard,
+// "Efficient grid-based spatial representations for robot
+// navigation in dynamic environments" (RAS 2013): every cell stores
+// its nearest site, removing a site raises the cells that referred
+// to it, and new or surviving sites lower their neighbors again, both
+// through a priority queue on squared distance.
+//
+// Two such fields are kept, one with occupied cells as sites (giving
+// distances of free cells) and one with free cells as sites (giving
+// distances of occupied cells). Distances match computeDistsFromBinary
+// except in rare cases where brushfire propagation of nearest sites
+// picks a site slightly farther than the nearest one.
+
+template <class real>
+class DynamicDtGrid_t {
+public:
+
+  typedef DtGrid_t<real> DtGrid;
+
+  // takes the occupancy (negative distance) of grid, which should
+  // already hold a signed distance field, and recomputes grid from
+  // it so the two agree. grid must outlive this object and must not
+  // be resized while it is attached.
+  explicit DynamicDtGrid_t(DtGrid& grid);
+
+  bool occupied(const vec3u& s) const;
+
+  // queue a change of occupancy, applied by the next update().
+  void setOccupied(const vec3u& s, bool occupied);
+
+  // queue a change of every cell in the box [lo, hi].
+  void setRegion(const vec3u& lo, const vec3u& hi, bool occupied);
+
+  // queue the cells of a box with the given origin and size, from a
+  // mask of size.x()*size.y()*size.z() entries with x fastest;
+  // nonzero entries are occupied.
+  void applyMask(const vec3u& origin, const vec3u& size,
+                 const unsigned char* mask);
+
+  // propagates the queued changes and writes the cells whose
+  // distance changed into the grid, along with their gradients.
+  // Returns the number of cells written.
+  size_t update();
+
+private:
+
+  enum { NO_SITE = -1 };
+
+  // changed cells are grouped into bricks of BRICK_SIZE^3 cells, and
+  // the grid is updated over the bounding box of the changes in each
+  // brick, so that distant changes do not update the space between.
+  enum { BRICK_SIZE = 8 };
+
+  typedef std::pair<int, int> QueueEntry; // (sqdist, index)
+  typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                              std::greater<QueueEntry> > Queue;
+
+  // one unsigned brushfire field
+  struct Field {
+    std::vector<int> site;       // nearest site index, or NO_SITE
+    std::vector<int> sqdist;     // squared distance in cells to it
+    std::vector<unsigned char> raise;
+    Queue queue;
+  };
+
+  void _addSite(Field& f, int idx);
+  void _removeSite(Field& f, int idx);
+  void _propagate(Field& f);
+  void _raise(Field& f, int idx);
+  void _lower(Field& f, int idx);
+
+  bool _isSite(const Field& f, int idx) const { 
+    return idx != NO_SITE && f.site[idx] == idx;
+  }
+
+  int _sqdist(int a, int b) const;
+  void _touch(int idx);
+  real _value(int idx) const;
+
+  DtGrid& _grid;
+  vec3u _dims;
+
+  // sites of _outside are occupied cells, sites of _inside are free
+  Field _outside, _inside;
+
+  std::vector<unsigned char> _occupied;
+
+  // cells whose distance changed since the last update
+  std::vector<int> _changed;
+  std::vector<unsigned char> _isChanged;
+
+  // bounding box of the changed cells in each brick, for the bricks
+  // listed in _changedBricks.
+  vec3u _brickDims;
+  std::vector<vec3u> _brickLo, _brickHi;
+  std::vector<unsigned char> _brickChanged;
+  std::vector<int> _changedBricks;
+
+  // offsets to the 26 neighbors of a cell
+  struct Offset { int dx, dy, dz; };
+  std::vector<Offset> _neighbors;
+
+};
+
+typedef DynamicDtGrid_t<float> DynamicDtGridf;
+typedef DynamicDtGrid_t<double> DynamicDtGridd;
+
+#endif
@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _MAPPEDARRAY_H_
+#define _MAPPEDARRAY_H_
+
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Contiguous storage that either owns its elements in a std::vector
+// or refers to memory owned elsewhere, such as a mapped file.
+// Copying or resizing external storage makes an owned copy.
+
+template <class T>
+class MappedArray {
+public:
+
+  MappedArray(): _ptr(0), _size(0) {}
+
+  MappedArray(const MappedArray& other): 
+    _vec(other._ptr, other._ptr + other._size) { _update(); }
+
+  MappedArray& operator=(const MappedArray& other) {
+    if (this != &other) {
+      std::vector<T> tmp(other._ptr, other._ptr + other._size);
+      _vec.swap(tmp);
+      _update();
+    }
+    return *this;
+  }
+
+  bool empty() const { return !_size; }
+  size_t size() const { return _size; }
+
+  // true if the elements are not owned by this array
+  bool external() const { 
+    return _size && (_vec.empty() || _ptr != &_vec[0]); 
+  }
+
+  const T& operator[](size_t i) const { return _ptr[i]; }
+  T& operator[](size_t i) { return _ptr[i]; }
+
+  void clear() { 
+    std::vector<T> tmp;
+    _vec.swap(tmp);
+    _update();
+  }
+
+  void resize(size_t n, const T& value=T()) {
+    _own();
+    _vec.resize(n, value);
+    _update();
+  }
+
+  // exchanges contents with v, which always ends up owning its
+  // elements.
+  void swap(std::vector<T>& v) {
+    _own();
+    _vec.swap(v);
+    _update();
+  }
+
+  // refers to n elements at ptr, which must outlive this array or
+  // the next call that changes it.
+  void setExternal(T* ptr, size_t n) {
+    clear();
+    _ptr = ptr;
+    _size = n;
+  }
+
+private:
+
+  void _own() {
+    if (external()) {
+      std::vector<T> tmp(_ptr, _ptr + _size);
+      _vec.swap(tmp);
+      _update();
+    }
+  }
+
+  void _update() {
+    _size = _vec.size();
+    _ptr = _size ? &_vec[0] : 0;
+  }
+
+  std::vector<T> _vec;
+  T* _ptr;
+  size_t _size;
+
+};
+
+// A whole file mapped copy-on-write: unmodified pages are shared
+// with every other process mapping the same file through the page
+// cache, and writes go to private copies. Copies of a mapping start
+// out empty, so only one object ever unmaps it.
+
+class FileMapping {
+public:
+
+  FileMapping(): _addr(0), _size(0) {}
+
+  FileMapping(const FileMapping&): _addr(0), _size(0) {}
+
+  FileMapping& operator=(const FileMapping& other) {
+    if (this != &other) { unmap(); }
+    return *this;
+  }
+
+  ~FileMapping() { unmap(); }
+
+  // returns false if the file can't be opened or mapped.
+  bool map(const char* filename) {
+
+    unmap();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+
+    void* addr = mmap(0, st.st_size, PROT_READ | PROT_WRITE, 
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) { return false; }
+
+    _addr = static_cast<char*>(addr);
+    _size = st.st_size;
+
+    return true;
+
+  }
+
+  void unmap() {
+    if (_addr) { munmap(_addr, _size); }
+    _addr = 0;
+    _size = 0;
+  }
+
+  void swap(FileMapping& other) {
+    std::swap(_addr, other._addr);
+    std::swap(_size, other._size);
+  }
+
+  bool empty() const { return !_addr; }
+
+  char* data() { return _addr; }
+  const char* data() const { return _addr; }
+
+  size_t size() const { return _size; }
+
+private:
+
+  char* _addr;
+  size_t _size;
+
+};
+
+#endif
@@ -0,0 +1,324 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "SparseDtGrid.h"
+#include <math.h>
+
+template <class real, class Tstore>
+SparseDtGrid_t<real, Tstore>::SparseDtGrid_t() {
+  clear();
+}
+
+template <class real, class Tstore>
+void SparseDtGrid_t<real, Tstore>::clear() {
+  this->_clear();
+  _band = 0;
+  _scale = _invScale = 1;
+  _bdims = vec3u(0);
+  _brickIndex.clear();
+  _data.clear();
+}
+
+template <class real, class Tstore>
+void SparseDtGrid_t<real, Tstore>::_create(const vec3u& dims, 
+                                   real cellSize, 
+                                   const vec3& origin,
+                                   real band) {
+
+  clear();
+
+  this->_resize(dims, cellSize, origin);
+  if (this->empty()) { return; }
+
+  // a band narrower than a cell would leave bricks holding an
+  // obstacle boundary unallocated.
+  _band = std::max(band, cellSize);
+
+  if (std::numeric_limits<Tstore>::is_integer) {
+    _scale = _band / std::numeric_limits<Tstore>::max();
+    _invScale = 1 / _scale;
+  }
+
+  for (int i=0; i<3; ++i) {
+    _bdims[i] = (dims[i] + BRICK_SIZE - 1) / BRICK_SIZE;
+  }
+
+  _brickIndex.resize(_bdims.prod(), FAR_OUTSIDE);
+
+}
+
+template <class real, class Tstore>
+void SparseDtGrid_t<real, Tstore>::build(const DtGrid& grid, real band) {
+
+  _create(grid.dims(), grid.cellSize(), grid.origin(), band);
+  if (this->empty()) { return; }
+
+  _copyBricks(grid, vec3u(0), vec3u(0), _bdims);
+
+}
+
+template <class real, class Tstore>
+void SparseDtGrid_t<real, Tstore>::build(const vec3u& dims, 
+                                 real cellSize, 
+                                 const vec3& origin,
+                                 const Occupancy& occupancy,
+                                 real band,
+                                 size_t chunkBricks) {
+
+  _create(dims, cellSize, origin, band);
+  if (this->empty()) { return; }
+
+  chunkBricks = std::max(chunkBricks, size_t(1));
+
+  // the nearest cell of the other kind to any cell within the band
+  // is at most band + cellSize/2 away, so a margin of this many
+  // cells makes the window distances exact where they are stored.
+  size_t margin = size_t(ceil(_band / cellSize)) + 1;
+
+  DtGrid window;
+  vec3u blo, bhi;
+
+  for (blo[2]=0; blo[2]<_bdims[2]; blo[2]+=chunkBricks) {
+    for (blo[1]=0; blo[1]<_bdims[1]; blo[1]+=chunkBricks) {
+      for (blo[0]=0; blo[0]<_bdims[0]; blo[0]+=chunkBricks) {
+
+        vec3u wlo, whi;
+
+        for (int i=0; i<3; ++i) {
+          bhi[i] = std::min(blo[i] + chunkBricks, _bdims[i]);
+          size_t lo = blo[i] * BRICK_SIZE;
+          size_t hi = std::min(bhi[i] * BRICK_SIZE, dims[i]);
+          wlo[i] = lo - std::min(lo, margin);
+          whi[i] = std::min(hi + margin, dims[i]);
+        }
+
+        vec3u wdims = whi - wlo;
+
+        vec3 worigin = origin + vec3(wlo[0], wlo[1], wlo[2]) * cellSize;
+
+        window.resize(wdims[0], wdims[1], wdims[2], DtGrid::AXIS_Z,
+                      cellSize, worigin);
+
+        for (size_t z=0; z<wdims[2]; ++z) {
+          for (size_t y=0; y<wdims[1]; ++y) {
+            for (size_t x=0; x<wdims[0]; ++x) {
+              bool occ = occupancy.occupied(wlo + vec3u(x,y,z));
+              window(x,y,z) = occ ? -1 : 1;
+            }
+          }
+        }
+
+        window.computeDistsFromBinary(false);
+
+        _copyBricks(window, wlo, blo, bhi);
+
+      }
+    }
+  }
+
+}
+
+template <class real, class Tstore>
+void SparseDtGrid_t<real, Tstore>::_copyBricks(const DtGrid& src, 
+                                       const vec3u& offset,
+                                       const vec3u& blo, 
+                                       const vec3u& bhi) {
+
+  std::vector<Tstore> cells(BRICK_CELLS);
+  vec3u b;
+
+  for (b[2]=blo[2]; b[2]<bhi[2]; ++b[2]) {
+    for (b[1]=blo[1]; b[1]<bhi[1]; ++b[1]) {
+      for (b[0]=blo[0]; b[0]<bhi[0]; ++b[0]) {
+
+        bool inBand = false;
+        bool inside = false;
+        size_t l = 0;
+
+        for (size_t z=0; z<BRICK_SIZE; ++z) {
+          for (size_t y=0; y<BRICK_SIZE; ++y) {
+            for (size_t x=0; x<BRICK_SIZE; ++x, ++l) {
+              vec3u s = b*size_t(BRICK_SIZE) + vec3u(x,y,z);
+              if (s[0] >= this->_dims[0] || 
+                  s[1] >= this->_dims[1] ||
+                  s[2] >= this->_dims[2]) {
+                // padding past the edge of the grid, never read
+                cells[l] = _encode(_band);
+                continue;
+              }
+              real d = src(s - offset);
+              if (!l) { inside = (d < 0); }
+              if (fabs(d) < _band) { inBand = true; }
+              cells[l] = _encode(std::max(-_band, std::min(d, _band)));
+            }
+          }
+        }
+
+        int& idx = _brickIndex[vec3u::sub2ind(_bdims, b)];
+
+        if (inBand) {
+          idx = _data.size() / BRICK_CELLS;
+          _data.insert(_data.end(), cells.begin(), cells.end());
+        } else {
+          idx = inside ? FAR_INSIDE : FAR_OUTSIDE;
+        }
+
+      }
+    }
+  }
+
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::band() const {
+  return _band;
+}
+
+template <class real, class Tstore>
+const vec3u& SparseDtGrid_t<real, Tstore>::brickDims() const {
+  return _bdims;
+}
+
+template <class real, class Tstore>
+size_t SparseDtGrid_t<real, Tstore>::numBricks() const {
+  return _brickIndex.size();
+}
+
+template <class real, class Tstore>
+size_t SparseDtGrid_t<real, Tstore>::numAllocatedBricks() const {
+  return _data.size() / BRICK_CELLS;
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::quantizationError() const {
+  return std::numeric_limits<Tstore>::is_integer ? real(0.5)*_scale : 0;
+}
+
+template <class real, class Tstore>
+size_t SparseDtGrid_t<real, Tstore>::memoryUsage() const {
+  return (_brickIndex.capacity() * sizeof(int) + 
+          _data.capacity() * sizeof(Tstore));
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::operator()(size_t x, size_t y, size_t z) const {
+
+  size_t b = vec3u::sub2ind(_bdims, 
+                            x / BRICK_SIZE, 
+                            y / BRICK_SIZE, 
+                            z / BRICK_SIZE);
+
+  int idx = _brickIndex[b];
+
+  if (idx < 0) { 
+    return idx == FAR_INSIDE ? -_band : _band;
+  }
+
+  size_t l = (((z % BRICK_SIZE) * BRICK_SIZE + 
+               (y % BRICK_SIZE)) * BRICK_SIZE +
+              (x % BRICK_SIZE));
+
+  return _decode(_data[size_t(idx)*BRICK_CELLS + l]);
+
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::operator()(const vec3u& s) const {
+  return (*this)(s[0], s[1], s[2]);
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::sample(const vec3& v) const {
+  return _sample(v, 0);
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::sample(const vec3& v, vec3& gradient) const {
+  return _sample(v, &gradient);
+}
+
+template <class real, class Tstore>
+real SparseDtGrid_t<real, Tstore>::_sample(const vec3& v, vec3* grad) const {
+
+  if (this->empty()) { 
+    if (grad) { *grad = vec3(0); }
+    return 0;
+  }
+
+  vec3u fs;
+  vec3 alpha;
+
+  this->sampleCoeffs(v, fs, alpha);
+
+  vec3u cs = fs;
+  for (int j=0; j<3; ++j) {
+    cs[j] = std::min(fs[j]+1, this->_dims[j]-1);
+  }
+
+  real f = 0;
+  vec3 g(0);
+
+  for (int i=0; i<8; ++i) {
+
+    int dx = i & 1, dy = (i >> 1) & 1, dz = (i >> 2) & 1;
+
+    real c = (*this)(dx ? cs[0] : fs[0],
+                     dy ? cs[1] : fs[1],
+                     dz ? cs[2] : fs[2]);
+
+    real wx = dx ? 1-alpha[0] : alpha[0];
+    real wy = dy ? 1-alpha[1] : alpha[1];
+    real wz = dz ? 1-alpha[2] : alpha[2];
+
+    f += wx*wy*wz*c;
+
+    if (grad) {
+      g[0] += (dx ? c : -c) * wy*wz;
+      g[1] += (dy ? c : -c) * wx*wz;
+      g[2] += (dz ? c : -c) * wx*wy;
+    }
+
+  }
+
+  if (grad) { *grad = g / this->_cellSize; }
+
+  return f;
+
+}
+
+template class SparseDtGrid_t<float>;
+template class SparseDtGrid_t<double>;
+template class SparseDtGrid_t<float, int16_t>;
+template class SparseDtGrid_t<double, int16_t>;
+template class SparseDtGrid_t<float, int8_t>;
+template class SparseDtGrid_t<double, int8_t>;
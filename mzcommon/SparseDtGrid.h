@@ -0,0 +1,167 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _SPARSEDTGRID_H_
+#define _SPARSEDTGRID_H_
+
+#include "DtGrid.h"
+#include <vector>
+#include <limits>
+#include <stdint.h>
+
+// A signed distance field that only stores distances within a band
+// around obstacles. The grid is divided into cubic bricks of
+// BRICK_SIZE^3 cells, and a brick is allocated only if some cell in
+// it is within band of an obstacle boundary. Every other cell reads
+// as +band (or -band deep inside an obstacle), and stored distances
+// are clamped to the same range so that sampling is continuous
+// across brick borders.
+//
+// This is enough for cost functions that vanish beyond some distance
+// (see Map2D::distToCost), and takes memory proportional to the
+// obstacle surface instead of the workspace volume. Gradients are
+// not stored; sample() returns the gradient of the trilinear
+// interpolant instead.
+//
+// Distances are stored as Tstore. An integer Tstore quantizes them
+// to steps of band / numeric_limits<Tstore>::max(), which shrinks the
+// working set 2-4x over floats at the cost of that much error.
+
+template <class real, class Tstore=real>
+class SparseDtGrid_t: public Grid3_t<real> {
+public:
+
+  typedef vec3_t<real> vec3;
+  typedef DtGrid_t<real> DtGrid;
+
+  enum { BRICK_SIZE = 8 };
+
+  // source of occupancy for building without a dense grid.
+  class Occupancy {
+  public:
+    virtual ~Occupancy() {}
+    virtual bool occupied(const vec3u& s) const =0;
+  };
+
+  SparseDtGrid_t();
+
+  void clear();
+
+  // copies the band of an already computed dense grid.
+  void build(const DtGrid& grid, real band);
+
+  // computes the same distances as computeDistsFromBinary would on a
+  // dense grid of the given dimensions, one window of
+  // chunkBricks^3 bricks (plus a margin of band) at a time.
+  void build(const vec3u& dims, real cellSize, const vec3& origin,
+             const Occupancy& occupancy, real band,
+             size_t chunkBricks=8);
+
+  real band() const;
+
+  const vec3u& brickDims() const;
+
+  size_t numBricks() const;
+
+  size_t numAllocatedBricks() const;
+
+  // the largest error introduced by quantization
+  real quantizationError() const;
+
+  // bytes of distance and index storage
+  size_t memoryUsage() const;
+
+  real operator()(const vec3u& s) const;
+
+  real operator()(size_t x, size_t y, size_t z) const;
+
+  real sample(const vec3& v) const;
+
+  real sample(const vec3& v, vec3& gradient) const;
+
+private:
+
+  enum { 
+    BRICK_CELLS = BRICK_SIZE*BRICK_SIZE*BRICK_SIZE,
+    FAR_OUTSIDE = -1,
+    FAR_INSIDE = -2,
+  };
+
+  void _create(const vec3u& dims, real cellSize, const vec3& origin,
+               real band);
+
+  // stores the bricks in [blo, bhi) from src, whose cell s is cell
+  // s+offset of this grid.
+  void _copyBricks(const DtGrid& src, const vec3u& offset,
+                   const vec3u& blo, const vec3u& bhi);
+
+  real _sample(const vec3& v, vec3* gradient) const;
+
+  Tstore _encode(real d) const {
+    if (std::numeric_limits<Tstore>::is_integer) {
+      return Tstore(floor(d*_invScale + real(0.5)));
+    } else {
+      return Tstore(d);
+    }
+  }
+
+  real _decode(Tstore q) const {
+    return std::numeric_limits<Tstore>::is_integer ? q*_scale : real(q);
+  }
+
+  real _band;
+
+  // size of a quantization step and its inverse, 1 if not quantized
+  real _scale;
+  real _invScale;
+
+  vec3u _bdims;
+
+  // per brick, the start of its cells in _data divided by
+  // BRICK_CELLS, or FAR_OUTSIDE/FAR_INSIDE if not allocated
+  std::vector<int> _brickIndex;
+
+  std::vector<Tstore> _data;
+
+};
+
+typedef SparseDtGrid_t<float> SparseDtGridf;
+typedef SparseDtGrid_t<double> SparseDtGridd;
+
+typedef SparseDtGrid_t<float, int16_t> SparseDtGrid16f;
+typedef SparseDtGrid_t<double, int16_t> SparseDtGrid16d;
+
+typedef SparseDtGrid_t<float, int8_t> SparseDtGrid8f;
+typedef SparseDtGrid_t<double, int8_t> SparseDtGrid8d;
+
+#endif
@@ -0,0 +1,344 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#include "TriMeshBVH.h"
+#include <algorithm>
+
+template <class real>
+TriMeshBVH_t<real>::TriMeshBVH_t() {}
+
+template <class real>
+TriMeshBVH_t<real>::TriMeshBVH_t(const TriMesh3& mesh, 
+                                 const Transform3* transform) {
+  build(mesh, transform);
+}
+
+template <class real>
+void TriMeshBVH_t<real>::clear() {
+  _verts.clear();
+  _faces.clear();
+  _nodes.clear();
+}
+
+template <class real>
+bool TriMeshBVH_t<real>::empty() const {
+  return _faces.empty();
+}
+
+template <class real>
+size_t TriMeshBVH_t<real>::numTriangles() const {
+  return _faces.size();
+}
+
+template <class real>
+const Box3_t<real>& TriMeshBVH_t<real>::bbox() const {
+  static const Box3 none;
+  return _nodes.empty() ? none : _nodes[0].box;
+}
+
+template <class real>
+class CentroidLess {
+public:
+  const std::vector< vec3_t<real> >& centroids;
+  int axis;
+  CentroidLess(const std::vector< vec3_t<real> >& c, int a): 
+    centroids(c), axis(a) {}
+  bool operator()(size_t a, size_t b) const {
+    return centroids[a][axis] < centroids[b][axis];
+  }
+};
+
+template <class real>
+void TriMeshBVH_t<real>::build(const TriMesh3& mesh, 
+                               const Transform3* transform) {
+
+  clear();
+
+  size_t n = mesh.faces.size();
+  if (!n) { return; }
+
+  std::vector<vec3> verts(3*n), centroids(n);
+  std::vector<size_t> order(n);
+
+  for (size_t f=0; f<n; ++f) {
+    vec3 c(0);
+    for (int i=0; i<3; ++i) {
+      vec3 v = mesh.verts[mesh.faces[f].vidx[i]];
+      if (transform) { v = transform->transformFwd(v); }
+      verts[3*f+i] = v;
+      c += v;
+    }
+    centroids[f] = c / real(3);
+    order[f] = f;
+  }
+
+  _nodes.reserve(2*n/LEAF_SIZE + 1);
+  _nodes.push_back(Node());
+  _build(0, 0, n, order, centroids, verts);
+
+  _verts.resize(3*n);
+  _faces.resize(n);
+
+  for (size_t i=0; i<n; ++i) {
+    for (int j=0; j<3; ++j) { _verts[3*i+j] = verts[3*order[i]+j]; }
+    _faces[i] = order[i];
+  }
+
+}
+
+// splits at the median centroid along the longest axis of the
+// centroid bounds.
+template <class real>
+void TriMeshBVH_t<real>::_build(size_t node, size_t begin, size_t end,
+                                std::vector<size_t>& order,
+                                const std::vector<vec3>& centroids,
+                                const std::vector<vec3>& verts) {
+
+  Box3 box, cbox;
+
+  for (size_t i=begin; i<end; ++i) {
+    for (int j=0; j<3; ++j) { box.addPoint(verts[3*order[i]+j]); }
+    cbox.addPoint(centroids[order[i]]);
+  }
+
+  _nodes[node].box = box;
+
+  if (end - begin <= LEAF_SIZE) {
+    _nodes[node].first = begin;
+    _nodes[node].count = end - begin;
+    return;
+  }
+
+  vec3 extent = cbox.p1 - cbox.p0;
+  int axis = 0;
+  for (int j=1; j<3; ++j) {
+    if (extent[j] > extent[axis]) { axis = j; }
+  }
+
+  size_t mid = (begin + end) / 2;
+  std::nth_element(order.begin()+begin, order.begin()+mid, 
+                   order.begin()+end, 
+                   CentroidLess<real>(centroids, axis));
+
+  size_t child = _nodes.size();
+  _nodes.push_back(Node());
+  _nodes.push_back(Node());
+
+  _nodes[node].first = child;
+  _nodes[node].count = 0;
+
+  _build(child,   begin, mid, order, centroids, verts);
+  _build(child+1, mid,   end, order, centroids, verts);
+
+}
+
+template <class real>
+static inline real boxDist2(const Box3_t<real>& box, const vec3_t<real>& p) {
+  real d2 = 0;
+  for (int j=0; j<3; ++j) {
+    real d = std::max(std::max(box.p0[j] - p[j], p[j] - box.p1[j]), real(0));
+    d2 += d*d;
+  }
+  return d2;
+}
+
+// closest point to p on triangle abc, from Ericson, "Real-Time
+// Collision Detection", section 5.1.5.
+template <class real>
+static vec3_t<real> closestOnTriangle(const vec3_t<real>& p,
+                                      const vec3_t<real>& a,
+                                      const vec3_t<real>& b,
+                                      const vec3_t<real>& c) {
+
+  typedef vec3_t<real> vec3;
+
+  vec3 ab = b - a, ac = c - a, ap = p - a;
+
+  real d1 = vec3::dot(ab, ap), d2 = vec3::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) { return a; }
+
+  vec3 bp = p - b;
+  real d3 = vec3::dot(ab, bp), d4 = vec3::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) { return b; }
+
+  real vc = d1*d4 - d3*d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    return a + ab * (d1 / (d1 - d3));
+  }
+
+  vec3 cp = p - c;
+  real d5 = vec3::dot(ab, cp), d6 = vec3::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) { return c; }
+
+  real vb = d5*d2 - d1*d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    return a + ac * (d2 / (d2 - d6));
+  }
+
+  real va = d3*d6 - d5*d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+
+  real denom = 1 / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+
+}
+
+template <class real>
+real TriMeshBVH_t<real>::closestPoint(const vec3& p, real maxDist,
+                                      vec3& closest, size_t& face) const {
+
+  if (_nodes.empty()) { return maxDist; }
+
+  real best2 = maxDist*maxDist;
+  bool found = false;
+
+  std::vector<size_t> stack;
+  stack.push_back(0);
+
+  while (!stack.empty()) {
+
+    const Node& node = _nodes[stack.back()];
+    stack.pop_back();
+
+    if (boxDist2(node.box, p) >= best2) { continue; }
+
+    if (node.count) {
+
+      for (size_t i=node.first; i<node.first+node.count; ++i) {
+        vec3 c = closestOnTriangle(p, _vert(i,0), _vert(i,1), _vert(i,2));
+        real d2 = (c - p).norm2();
+        if (d2 < best2) {
+          best2 = d2;
+          closest = c;
+          face = _faces[i];
+          found = true;
+        }
+      }
+
+    } else {
+
+      // visit the nearer child first
+      size_t c0 = node.first, c1 = node.first+1;
+      if (boxDist2(_nodes[c0].box, p) < boxDist2(_nodes[c1].box, p)) {
+        std::swap(c0, c1);
+      }
+      stack.push_back(c0);
+      stack.push_back(c1);
+
+    }
+
+  }
+
+  return found ? sqrt(best2) : maxDist;
+
+}
+
+// which of the two directions of an edge owns the points on it
+template <class real>
+static inline bool ownsEdge(real du, real dv) {
+  return dv > 0 || (dv == 0 && du < 0);
+}
+
+template <class real>
+void TriMeshBVH_t<real>::lineHits(const vec3& p, int axis,
+                                  std::vector<Hit>& hits) const {
+
+  if (_nodes.empty()) { return; }
+
+  const int u = (axis+1) % 3, v = (axis+2) % 3;
+
+  std::vector<size_t> stack;
+  stack.push_back(0);
+
+  while (!stack.empty()) {
+
+    const Node& node = _nodes[stack.back()];
+    stack.pop_back();
+
+    if (p[u] < node.box.p0[u] || p[u] > node.box.p1[u] ||
+        p[v] < node.box.p0[v] || p[v] > node.box.p1[v]) {
+      continue;
+    }
+
+    if (!node.count) {
+      stack.push_back(node.first);
+      stack.push_back(node.first+1);
+      continue;
+    }
+
+    for (size_t i=node.first; i<node.first+node.count; ++i) {
+
+      const vec3* t[3] = { &_vert(i,0), &_vert(i,1), &_vert(i,2) };
+
+      // twice the signed area of the triangle projected along axis,
+      // which is also its normal along axis
+      real area = (((*t[1])[u]-(*t[0])[u]) * ((*t[2])[v]-(*t[0])[v]) -
+                   ((*t[1])[v]-(*t[0])[v]) * ((*t[2])[u]-(*t[0])[u]));
+
+      if (!area) { continue; }
+
+      int orient = area > 0 ? 1 : -1;
+      if (area < 0) { std::swap(t[1], t[2]); area = -area; }
+
+      // edge functions, weights of the vertex opposite each edge
+      real w[3];
+      bool inside = true;
+
+      for (int k=0; k<3 && inside; ++k) {
+        const vec3& a = *t[(k+1)%3];
+        const vec3& b = *t[(k+2)%3];
+        real du = b[u]-a[u], dv = b[v]-a[v];
+        w[k] = du * (p[v]-a[v]) - dv * (p[u]-a[u]);
+        inside = (w[k] > 0 || (w[k] == 0 && ownsEdge(du, dv)));
+      }
+
+      if (!inside) { continue; }
+
+      Hit h;
+      h.t = (w[0]*(*t[0])[axis] + w[1]*(*t[1])[axis] + 
+             w[2]*(*t[2])[axis]) / (w[0]+w[1]+w[2]);
+      h.orient = orient;
+      h.face = _faces[i];
+
+      hits.push_back(h);
+
+    }
+
+  }
+
+}
+
+template class TriMeshBVH_t<float>;
+template class TriMeshBVH_t<double>;
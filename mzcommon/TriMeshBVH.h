@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef _TRIMESHBVH_H_
+#define _TRIMESHBVH_H_
+
+#include "TriMesh3.h"
+#include "Transform3.h"
+#include <vector>
+
+// A bounding volume hierarchy over the triangles of a TriMesh3, for
+// closest point queries and for casting axis aligned lines through
+// the mesh. The triangles are copied (and optionally transformed),
+// so the mesh need not outlive the hierarchy.
+
+template <class real>
+class TriMeshBVH_t {
+public:
+
+  typedef vec3_t<real> vec3;
+  typedef Box3_t<real> Box3;
+  typedef TriMesh3_t<real> TriMesh3;
+  typedef Transform3_t<real> Transform3;
+
+  // a line crossing a triangle at parameter t along the axis;
+  // orient is the sign of the triangle normal along the axis.
+  struct Hit {
+    real t;
+    int orient;
+    size_t face;
+    bool operator<(const Hit& h) const { return t < h.t; }
+  };
+
+  TriMeshBVH_t();
+
+  explicit TriMeshBVH_t(const TriMesh3& mesh, 
+                        const Transform3* transform=0);
+
+  void build(const TriMesh3& mesh, const Transform3* transform=0);
+
+  void clear();
+
+  bool empty() const;
+
+  size_t numTriangles() const;
+
+  const Box3& bbox() const;
+
+  // returns the distance from p to the closest point on the mesh if
+  // it is less than maxDist, setting closest and face; otherwise
+  // returns maxDist and leaves them alone.
+  real closestPoint(const vec3& p, real maxDist,
+                    vec3& closest, size_t& face) const;
+
+  // appends every crossing of the line through p parallel to axis.
+  // Points on an edge or vertex shared by two triangles cross
+  // exactly one of them.
+  void lineHits(const vec3& p, int axis, std::vector<Hit>& hits) const;
+
+private:
+
+  enum { LEAF_SIZE = 4 };
+
+  // leaves hold count triangles starting at first, inner nodes have
+  // count zero and children first and first+1.
+  struct Node {
+    Box3 box;
+    size_t first;
+    size_t count;
+  };
+
+  void _build(size_t node, size_t begin, size_t end,
+              std::vector<size_t>& order,
+              const std::vector<vec3>& centroids,
+              const std::vector<vec3>& verts);
+
+  const vec3& _vert(size_t tri, int i) const { return _verts[3*tri+i]; }
+
+  std::vector<vec3> _verts;    // three per triangle, in leaf order
+  std::vector<size_t> _faces;  // original face index of each triangle
+  std::vector<Node> _nodes;
+
+};
+
+typedef TriMeshBVH_t<float> TriMeshBVHf;
+typedef TriMeshBVH_t<double> TriMeshBVHd;
+
+#endif
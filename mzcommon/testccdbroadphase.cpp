@@ -0,0 +1,276 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+// Checks the pairs found by BroadPhase against brute force over the
+// same boxes, and against the Checker for every pair of objects.
+// Prints each failed check and returns nonzero if there were any.
+
+#include "CCDBroadPhase.h"
+#include "mersenne.h"
+#include <stdio.h>
+#include <set>
+
+using namespace ccdw;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, const char* detail="") {
+  if (!ok) {
+    printf("FAIL: %s %s\n", what, detail);
+    ++failures;
+  }
+}
+
+static ccd_real_t uniform(ccd_real_t lo, ccd_real_t hi) {
+  return lo + (hi-lo)*mt_genrand_real1();
+}
+
+static vec3 randomVec(ccd_real_t lo, ccd_real_t hi) {
+  return vec3(uniform(lo, hi), uniform(lo, hi), uniform(lo, hi));
+}
+
+static quat randomRotation() {
+  return quat::fromAxisAngle(vec3::normalize(randomVec(-1, 1)),
+                             uniform(0, M_PI));
+}
+
+// spheres, boxes and capsules at random poses in the unit cube.
+// shapes holds what the objects point to.
+static void randomScene(size_t n, std::vector<Convex*>& shapes,
+                        std::vector<TransformedConvex*>& objects) {
+  for (size_t i=0; i<n; ++i) {
+    Convex* c;
+    switch (i % 3) {
+    case 0: c = sphere(uniform(0.01, 0.04)); break;
+    case 1: c = new Box(randomVec(0.01, 0.06)); break;
+    default: c = capsule(uniform(0.01, 0.05), uniform(0.005, 0.02)); break;
+    }
+    shapes.push_back(c);
+    objects.push_back(transform(c, Transform3(randomRotation(),
+                                              randomVec(0, 1))));
+  }
+}
+
+static void freeScene(std::vector<Convex*>& shapes,
+                      std::vector<TransformedConvex*>& objects) {
+  for (size_t i=0; i<objects.size(); ++i) { delete objects[i]; }
+  for (size_t i=0; i<shapes.size(); ++i) { delete shapes[i]; }
+  objects.clear();
+  shapes.clear();
+}
+
+static void move(TransformedConvex* c, ccd_real_t step) {
+  c->xform = Transform3(quat::fromAxisAngle(vec3(0, 0, 1), step) * 
+                        c->xform.rotation(),
+                        c->xform.translation() + randomVec(-step, step));
+}
+
+// the same test as the tree uses
+static bool overlaps(const AABB& a, const AABB& b, ccd_real_t dmin) {
+  for (int i=0; i<3; ++i) {
+    if (a.p0[i] > b.p1[i] + dmin || b.p0[i] > a.p1[i] + dmin) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// true if the enlarged box of the proxy holds the object
+static bool bounded(const BroadPhase& bp, size_t proxy) {
+  const Convex* c = bp.convex(proxy);
+  vec3 ctr;
+  c->center(ctr);
+  const AABB& box = bp.bounds(proxy);
+  for (int i=0; i<3; ++i) {
+    if (ctr[i] - c->maxDist() < box.p0[i] ||
+        ctr[i] + c->maxDist() > box.p1[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+typedef std::set< std::pair<size_t, size_t> > PairSet;
+
+static void testSelfPairs() {
+
+  mt_init_genrand(49);
+
+  std::vector<Convex*> shapes;
+  std::vector<TransformedConvex*> objects;
+  randomScene(300, shapes, objects);
+
+  const size_t none = size_t(-1);
+  const ccd_real_t dmin = 0.02;
+
+  BroadPhase bp(0.05);
+  std::vector<size_t> proxies(objects.size());
+  for (size_t i=0; i<objects.size(); ++i) {
+    proxies[i] = bp.add(objects[i], i%7 ? 0 : 1 + int(i%3));
+  }
+
+  Checker checker;
+  bool sameSet = true, ordered = true, inBounds = true, complete = true;
+
+  for (int iter=0; iter<20; ++iter) {
+
+    for (size_t i=0; i<objects.size(); ++i) {
+      if (proxies[i] == none) { continue; }
+      move(objects[i], 0.01);
+      bp.update(proxies[i]);
+      inBounds = inBounds && bounded(bp, proxies[i]);
+    }
+
+    // removing and adding again reuses proxies
+    if (iter == 8) {
+      for (size_t i=0; i<objects.size(); i+=3) {
+        bp.remove(proxies[i]);
+        proxies[i] = none;
+      }
+    } else if (iter == 14) {
+      for (size_t i=0; i<objects.size(); i+=3) {
+        proxies[i] = bp.add(objects[i], 0);
+      }
+    }
+
+    std::vector<ProxyPair> pairs;
+    bp.selfPairs(pairs, dmin);
+
+    PairSet got;
+    for (size_t k=0; k<pairs.size(); ++k) {
+      const ProxyPair& p = pairs[k];
+      ordered = ordered && p.proxy1 < p.proxy2 &&
+        p.c1 == bp.convex(p.proxy1) && p.c2 == bp.convex(p.proxy2);
+      got.insert(std::make_pair(p.proxy1, p.proxy2));
+    }
+    sameSet = sameSet && got.size() == pairs.size();
+
+    PairSet want;
+    for (size_t i=0; i<objects.size(); ++i) {
+      for (size_t j=0; j<objects.size(); ++j) {
+        const size_t a = proxies[i], b = proxies[j];
+        if (a == none || b == none || a >= b) { continue; }
+        const int g = bp.group(a);
+        if (g && g == bp.group(b)) { continue; }
+        if (overlaps(bp.bounds(a), bp.bounds(b), dmin)) {
+          want.insert(std::make_pair(a, b));
+        }
+        // nothing within dmin may be missed
+        if (checker.intersect(objects[i], objects[j], dmin) &&
+            !got.count(std::make_pair(a, b))) {
+          complete = false;
+        }
+      }
+    }
+    sameSet = sameSet && got == want;
+
+  }
+
+  check(sameSet, "selfPairs differs from brute force");
+  check(ordered, "selfPairs returned a badly formed pair");
+  check(inBounds, "a proxy box does not hold its object");
+  check(complete, "selfPairs missed a pair within dmin");
+
+  freeScene(shapes, objects);
+
+}
+
+static void testTrees() {
+
+  mt_init_genrand(149);
+
+  std::vector<Convex*> shapes, worldShapes;
+  std::vector<TransformedConvex*> objects, world;
+  randomScene(100, shapes, objects);
+  randomScene(400, worldShapes, world);
+
+  const ccd_real_t dmin = 0.01;
+
+  BroadPhase robot(0.02), other;
+  std::vector<size_t> robotProxies, otherProxies;
+  for (size_t i=0; i<objects.size(); ++i) { 
+    robotProxies.push_back(robot.add(objects[i], 1));
+  }
+  for (size_t i=0; i<world.size(); ++i) { 
+    otherProxies.push_back(other.add(world[i]));
+  }
+
+  // groups are not compared across trees
+  std::vector<ProxyPair> pairs;
+  robot.pairs(other, pairs, dmin);
+
+  PairSet got, want;
+  for (size_t k=0; k<pairs.size(); ++k) {
+    got.insert(std::make_pair(pairs[k].proxy1, pairs[k].proxy2));
+  }
+  for (size_t i=0; i<robotProxies.size(); ++i) {
+    for (size_t j=0; j<otherProxies.size(); ++j) {
+      const size_t a = robotProxies[i], b = otherProxies[j];
+      if (overlaps(robot.bounds(a), other.bounds(b), dmin)) {
+        want.insert(std::make_pair(a, b));
+      }
+    }
+  }
+  check(got.size() == pairs.size() && got == want,
+        "pairs differs from brute force");
+
+  const AABB box(vec3(0.3, 0.4, 0.2), vec3(0.6, 0.5, 0.7));
+  std::vector<size_t> hits;
+  other.query(box, hits);
+  std::set<size_t> gotHits(hits.begin(), hits.end()), wantHits;
+  for (size_t j=0; j<otherProxies.size(); ++j) {
+    const size_t b = otherProxies[j];
+    if (overlaps(other.bounds(b), box, 0)) { wantHits.insert(b); }
+  }
+  check(gotHits.size() == hits.size() && gotHits == wantHits,
+        "query differs from brute force");
+
+  freeScene(shapes, objects);
+  freeScene(worldShapes, world);
+
+}
+
+int main(int argc, char** argv) {
+
+  testSelfPairs();
+  testTrees();
+
+  if (failures) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+
+  printf("all checks passed\n");
+  return 0;
+
+}
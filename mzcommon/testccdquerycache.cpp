@@ -0,0 +1,177 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+// Checks that QueryCache answers queries of moving objects the same
+// way as the Checker does without it. Prints each failed check and
+// returns nonzero if there were any.
+
+#include "CCDQueryCache.h"
+#include "mersenne.h"
+#include <stdio.h>
+
+using namespace ccdw;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, const char* detail="") {
+  if (!ok) {
+    printf("FAIL: %s %s\n", what, detail);
+    ++failures;
+  }
+}
+
+static ccd_real_t uniform(ccd_real_t lo, ccd_real_t hi) {
+  return lo + (hi-lo)*mt_genrand_real1();
+}
+
+static vec3 randomVec(ccd_real_t lo, ccd_real_t hi) {
+  return vec3(uniform(lo, hi), uniform(lo, hi), uniform(lo, hi));
+}
+
+static quat randomRotation() {
+  return quat::fromAxisAngle(vec3::normalize(randomVec(-1, 1)),
+                             uniform(0, M_PI));
+}
+
+static void move(TransformedConvex* c, ccd_real_t step) {
+  c->xform = Transform3(quat::fromAxisAngle(vec3(0, 0, 1), step) * 
+                        c->xform.rotation(),
+                        c->xform.translation() + randomVec(-step, step));
+}
+
+static const char* queryName(QueryType qtype) {
+  switch (qtype) {
+  case QUERY_INTERSECT: return "intersect";
+  case QUERY_SEPARATION: return "separation";
+  default: return "penetration";
+  }
+}
+
+static void testQueries(QueryType qtype) {
+
+  mt_init_genrand(50 + qtype);
+
+  // spheres, boxes and capsules at random poses in the unit cube
+  std::vector<Convex*> shapes;
+  std::vector<TransformedConvex*> objects;
+  for (size_t i=0; i<150; ++i) {
+    Convex* c;
+    switch (i % 3) {
+    case 0: c = sphere(uniform(0.01, 0.04)); break;
+    case 1: c = new Box(randomVec(0.01, 0.06)); break;
+    default: c = capsule(uniform(0.01, 0.05), uniform(0.005, 0.02)); break;
+    }
+    shapes.push_back(c);
+    objects.push_back(transform(c, Transform3(randomRotation(),
+                                              randomVec(0, 1))));
+  }
+
+  BroadPhase bp(0.02);
+  for (size_t i=0; i<objects.size(); ++i) { bp.add(objects[i]); }
+
+  Checker checker;
+  QueryCache cache(&checker);
+
+  // answers within tol of dmin may go either way
+  const ccd_real_t dmin = 0.03, tol = 1e-3;
+  bool same = true, reported = true;
+  size_t total = 0;
+
+  for (int iter=0; iter<60; ++iter) {
+
+    for (size_t i=0; i<objects.size(); ++i) {
+      move(objects[i], 0.003);
+    }
+
+    // a large jump must not be answered from the cache
+    if (iter == 30) {
+      objects[0]->xform.setTranslation(randomVec(0, 1));
+    }
+
+    bp.updateAll();
+
+    std::vector<ProxyPair> pairs;
+    bp.selfPairs(pairs, dmin);
+
+    for (size_t k=0; k<pairs.size(); ++k) {
+
+      const Convex* c1 = pairs[k].c1;
+      const Convex* c2 = pairs[k].c2;
+
+      Report r1, r2;
+      bool a = checker.query(qtype, &r1, c1, c2, dmin);
+      bool b = cache.query(qtype, &r2, c1, c2, dmin);
+      ++total;
+
+      if (a != b &&
+          checker.intersect(c1, c2, dmin + tol) ==
+          checker.intersect(c1, c2, dmin - tol)) {
+        same = false;
+      }
+
+      if (a && b && (r1.flags != r2.flags || 
+                     r2.c1 != c1 || r2.c2 != c2)) {
+        reported = false;
+      }
+
+    }
+
+  }
+
+  const char* what = queryName(qtype);
+
+  check(same, "cached queries differ:", what);
+  check(reported, "cached reports differ:", what);
+  check(cache.queries() == total, "wrong query count:", what);
+  check(cache.skipped() > 0, "no query was skipped:", what);
+
+  for (size_t i=0; i<objects.size(); ++i) { delete objects[i]; }
+  for (size_t i=0; i<shapes.size(); ++i) { delete shapes[i]; }
+
+}
+
+int main(int argc, char** argv) {
+
+  testQueries(QUERY_INTERSECT);
+  testQueries(QUERY_SEPARATION);
+  testQueries(QUERY_PENETRATION);
+
+  if (failures) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+
+  printf("all checks passed\n");
+  return 0;
+
+}
@@ -0,0 +1,953 @@
+/*
+* Copyright (c) 2008-2014, Matt Zucker
+*
+* This file is provided under the following "BSD-style" License:
+*
+* Redistribution and use in source and binary forms, with or
+* without modification, are permitted provided that the following
+* conditions are met:
+*
+* * Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above
+* copyright notice, this list of conditions and the following
+* disclaimer in the documentation and/or other materials provided
+* with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+* CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+* INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+* CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+* USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+* AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+* LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+* ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+// Checks the distance transforms and storage variants of DtGrid
+// against brute force references and against each other. Prints
+// each failed check and returns nonzero if there were any.
+
+#include "DtGrid.h"
+#include "DtGridPyramid.h"
+#include "DynamicDtGrid.h"
+#include "SparseDtGrid.h"
+#include "TriMeshBVH.h"
+#include "mersenne.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, const char* detail="") {
+  if (!ok) {
+    printf("FAIL: %s %s\n", what, detail);
+    ++failures;
+  }
+}
+
+// true if a and b hold the same bits in every cell
+static bool sameValues(const DtGridf& a, const DtGridf& b) {
+  if (a.size() != b.size()) { return false; }
+  for (size_t i=0; i<a.size(); ++i) {
+    if (memcmp(&a[i], &b[i], sizeof(float))) { return false; }
+  }
+  return true;
+}
+
+static bool sameGradients(const DtGridf& a, const DtGridf& b) {
+  if (a.size() != b.size()) { return false; }
+  for (size_t i=0; i<a.size(); ++i) {
+    vec3f ga = a.gradient(i), gb = b.gradient(i);
+    if (memcmp(&ga, &gb, sizeof(vec3f))) { return false; }
+  }
+  return true;
+}
+
+static bool close(float a, float b, float tol=1e-5) {
+  return fabs(a-b) <= tol*(1+fabs(b));
+}
+
+// a grid of cell size 0.1 with occupied (negative) cells at random
+static void randomGrid(size_t nx, size_t ny, size_t nz, 
+                       double density, unsigned long seed,
+                       DtGridf& grid) {
+  grid.resize(nx, ny, nz, DtGridf::AXIS_Z, 0.1, vec3f(0,0,0));
+  mt_init_genrand(seed);
+  for (size_t i=0; i<grid.size(); ++i) {
+    grid[i] = (mt_genrand_real1() < density) ? -1 : 1;
+  }
+}
+
+// computeDistsFromBinary by brute force: the distance from each cell
+// center to the nearest center of a cell of the other kind, less half
+// a cell, negative for occupied cells.
+static void bruteBinary(const DtGridf& occ, std::vector<float>& dists) {
+
+  dists.resize(occ.size());
+
+  for (size_t i=0; i<occ.size(); ++i) {
+    vec3u si = occ.ind2sub(i);
+    bool inside = occ[i] <= 0;
+    double best = HUGE_VAL;
+    for (size_t j=0; j<occ.size(); ++j) {
+      if ((occ[j] <= 0) == inside) { continue; }
+      vec3u sj = occ.ind2sub(j);
+      double d2 = 0;
+      for (int k=0; k<3; ++k) {
+        double dk = double(si[k]) - double(sj[k]);
+        d2 += dk*dk;
+      }
+      best = std::min(best, d2);
+    }
+    double d = (best == HUGE_VAL ? HUGE_VAL : 
+                std::max(sqrt(best)*occ.cellSize() - 0.5*occ.cellSize(),
+                         0.0));
+    dists[i] = inside ? -d : d;
+  }
+
+}
+
+static void compareBinary(const DtGridf& occ, const char* what) {
+
+  std::vector<float> ref;
+  bruteBinary(occ, ref);
+
+  DtGridf grid = occ;
+  grid.computeDistsFromBinary();
+
+  size_t bad = 0;
+  for (size_t i=0; i<grid.size(); ++i) {
+    if (ref[i] == HUGE_VAL || ref[i] == -HUGE_VAL) {
+      if (fabs(grid[i]) < 1e10 || (grid[i] < 0) != (ref[i] < 0)) { ++bad; }
+    } else if (!close(grid[i], ref[i])) {
+      ++bad;
+    }
+  }
+
+  check(bad == 0, "computeDistsFromBinary vs brute force:", what);
+
+}
+
+// user-033: the parallel, blocked EDT
+static void testEDT() {
+
+  const size_t dims[][3] = {
+    { 31, 27, 1 }, { 13, 11, 9 }, { 1, 17, 5 }, { 8, 1, 1 }
+  };
+  const double densities[] = { 0.02, 0.3, 0.7 };
+
+  char what[128];
+  DtGridf occ;
+
+  for (size_t d=0; d<sizeof(dims)/sizeof(dims[0]); ++d) {
+    for (size_t k=0; k<3; ++k) {
+      randomGrid(dims[d][0], dims[d][1], dims[d][2], 
+                 densities[k], 17+d, occ);
+      snprintf(what, sizeof(what), "%ux%ux%u density %g",
+               unsigned(dims[d][0]), unsigned(dims[d][1]), 
+               unsigned(dims[d][2]), densities[k]);
+      compareBinary(occ, what);
+    }
+  }
+
+  // grids large enough to be split across threads must not depend
+  // on the number of threads
+  const size_t big[][3] = { { 300, 200, 1 }, { 48, 40, 36 } };
+  const size_t threads[] = { 3, 7 };
+
+  for (size_t b=0; b<2; ++b) {
+
+    randomGrid(big[b][0], big[b][1], big[b][2], 0.05, 5+b, occ);
+
+    DtGridf::setNumThreads(1);
+    DtGridf ref = occ;
+    ref.computeDistsFromBinary();
+
+    for (size_t t=0; t<2; ++t) {
+      DtGridf::setNumThreads(threads[t]);
+      DtGridf grid = occ;
+      grid.computeDistsFromBinary();
+      snprintf(what, sizeof(what), "%ux%ux%u at %u threads",
+               unsigned(big[b][0]), unsigned(big[b][1]), 
+               unsigned(big[b][2]), unsigned(threads[t]));
+      check(sameValues(grid, ref) && sameGradients(grid, ref),
+            "threaded EDT differs from one thread:", what);
+    }
+
+  }
+
+  DtGridf::setNumThreads(0);
+
+}
+
+// computeDists by brute force: cells closer than 0.87 cells to the
+// surface keep their value, the others get the distance between
+// centers to the nearest such cell, keeping their sign.
+static void bruteDists(const DtGridf& init, std::vector<float>& dists) {
+
+  const float inf = DtGridf::DT_INF;
+  const float cs = init.cellSize();
+
+  std::vector<size_t> sites;
+  for (size_t i=0; i<init.size(); ++i) {
+    if (fabs(init[i]) != inf && fabs(init[i]) < 0.87*cs) {
+      sites.push_back(i);
+    }
+  }
+
+  dists.resize(init.size());
+
+  for (size_t i=0; i<init.size(); ++i) {
+    float v = init[i];
+    if (fabs(v) != inf && fabs(v) < 0.87*cs) { 
+      dists[i] = v;
+      continue; 
+    }
+    vec3u si = init.ind2sub(i);
+    double best = HUGE_VAL;
+    for (size_t j=0; j<sites.size(); ++j) {
+      vec3u sj = init.ind2sub(sites[j]);
+      double d2 = 0;
+      for (int k=0; k<3; ++k) {
+        double dk = double(si[k]) - double(sj[k]);
+        d2 += dk*dk;
+      }
+      best = std::min(best, d2);
+    }
+    float d = sqrt(best)*cs;
+    dists[i] = signbit(v) ? -d : d;
+  }
+
+}
+
+// user-034: the single sweep signed EDT
+static void testSignedEDT() {
+
+  DtGridf occ;
+
+  // no cells of the other kind at all
+  randomGrid(9, 7, 5, 0, 1, occ);
+  compareBinary(occ, "empty grid");
+  randomGrid(9, 7, 5, 1, 1, occ);
+  compareBinary(occ, "full grid");
+
+  // a sphere with exact distances near its surface, and an inside
+  // cell at -0, whose sign must survive
+  const float inf = DtGridf::DT_INF;
+  const vec3f center(1.2, 1.0, 0.9);
+  const float radius = 0.55;
+
+  DtGridf init;
+  init.resize(24, 20, 18, DtGridf::AXIS_Z, 0.1, vec3f(0,0,0));
+
+  for (size_t i=0; i<init.size(); ++i) {
+    float d = (init.cellCenter(init.ind2sub(i)) - center).norm() - radius;
+    if (fabs(d) < init.cellSize()) {
+      init[i] = d;
+    } else {
+      init[i] = d < 0 ? -inf : inf;
+    }
+  }
+
+  size_t zero = init.sub2ind(12, 10, 9 - 5);
+  init[zero] = -0.0f;
+
+  std::vector<float> ref;
+  bruteDists(init, ref);
+
+  DtGridf grid = init;
+  grid.computeDists();
+
+  size_t bad = 0;
+  for (size_t i=0; i<grid.size(); ++i) {
+    if (!close(grid[i], ref[i]) || 
+        signbit(grid[i]) != signbit(ref[i])) { ++bad; }
+  }
+
+  check(bad == 0, "computeDists vs brute force");
+  check(grid[zero] == 0 && signbit(grid[zero]), 
+        "computeDists lost the sign of -0");
+
+}
+
+// values and stored gradients agree to within rounding
+static bool closeGrids(const DtGridf& a, const DtGridf& b) {
+  if (a.size() != b.size()) { return false; }
+  for (size_t i=0; i<a.size(); ++i) {
+    if (!close(a[i], b[i])) { return false; }
+    vec3f ga = a.gradient(i), gb = b.gradient(i);
+    for (int k=0; k<3; ++k) {
+      if (!close(ga[k], gb[k])) { return false; }
+    }
+  }
+  return true;
+}
+
+// user-035: incremental updates must match a full recompute
+static void testDynamic() {
+
+  const size_t dims[][3] = { { 200, 200, 1 }, { 40, 36, 32 } };
+
+  char what[128];
+
+  for (size_t d=0; d<2; ++d) {
+
+    DtGridf grid;
+    randomGrid(dims[d][0], dims[d][1], dims[d][2], 0.01, 3+d, grid);
+    grid.computeDistsFromBinary();
+
+    DynamicDtGridf dyn(grid);
+
+    vec3u top(dims[d][0]-1, dims[d][1]-1, dims[d][2]-1);
+
+    for (int round=0; round<6; ++round) {
+
+      if (round % 2) {
+        // two small edits in opposite corners
+        bool occ = (round % 4 == 1);
+        dyn.setRegion(vec3u(0,0,0), vec3u(1,1,0), occ);
+        dyn.setRegion(top - vec3u(1,1,0), top, occ);
+      } else {
+        for (int k=0; k<40; ++k) {
+          vec3u s(mt_genrand_int32() % dims[d][0],
+                  mt_genrand_int32() % dims[d][1],
+                  mt_genrand_int32() % dims[d][2]);
+          dyn.setOccupied(s, !dyn.occupied(s));
+        }
+      }
+
+      dyn.update();
+
+      DtGridf full = grid;
+      full.computeDistsFromBinary();
+
+      snprintf(what, sizeof(what), "%ux%ux%u round %d",
+               unsigned(dims[d][0]), unsigned(dims[d][1]), 
+               unsigned(dims[d][2]), round);
+      check(closeGrids(grid, full), 
+            "DynamicDtGrid differs from a full recompute:", what);
+
+    }
+
+  }
+
+}
+
+static float clampBand(float d, float band) {
+  return std::max(-band, std::min(d, band));
+}
+
+// the occupancy of the negative cells of a grid
+class GridOccupancy: public SparseDtGridf::Occupancy {
+public:
+  const DtGridf& grid;
+  GridOccupancy(const DtGridf& g): grid(g) {}
+  virtual bool occupied(const vec3u& s) const { return grid(s) <= 0; }
+};
+
+// random obstacles and a slab through the middle of the grid
+static void sparseScene(size_t nx, size_t ny, size_t nz,
+                        unsigned long seed, DtGridf& occ) {
+  randomGrid(nx, ny, nz, nz > 1 ? 0.0002 : 0.002, seed, occ);
+  for (size_t z=0; z<nz; ++z) {
+    for (size_t y=ny/3; y<ny/3+4; ++y) {
+      for (size_t x=0; x<nx/2; ++x) {
+        occ(x, y, z) = -1;
+      }
+    }
+  }
+}
+
+// user-036: both ways of building a SparseDtGrid reproduce the
+// clamped dense distances
+static void testSparse() {
+
+  const size_t dims[][3] = { { 100, 90, 1 }, { 37, 30, 26 } };
+  const float band = 0.35;
+
+  char what[128];
+
+  for (size_t d=0; d<2; ++d) {
+
+    DtGridf occ;
+    sparseScene(dims[d][0], dims[d][1], dims[d][2], 11+d, occ);
+
+    DtGridf dense = occ;
+    dense.computeDistsFromBinary();
+
+    SparseDtGridf fromDense, fromOcc;
+    fromDense.build(dense, band);
+    fromOcc.build(occ.dims(), occ.cellSize(), occ.origin(),
+                  GridOccupancy(occ), band, 2);
+
+    size_t bad[2] = { 0, 0 };
+    for (size_t i=0; i<dense.size(); ++i) {
+      vec3u s = dense.ind2sub(i);
+      float ref = clampBand(dense[i], band);
+      if (fromDense(s) != ref) { ++bad[0]; }
+      if (fromOcc(s) != ref) { ++bad[1]; }
+    }
+
+    snprintf(what, sizeof(what), "%ux%ux%u", unsigned(dims[d][0]), 
+             unsigned(dims[d][1]), unsigned(dims[d][2]));
+
+    check(bad[0] == 0, "SparseDtGrid built from a dense grid:", what);
+    check(bad[1] == 0, "SparseDtGrid built from occupancy:", what);
+    check(fromDense.numAllocatedBricks() < fromDense.numBricks(),
+          "SparseDtGrid allocated every brick:", what);
+
+    // sampling matches a dense grid holding the clamped values
+    DtGridf clamped = dense;
+    for (size_t i=0; i<clamped.size(); ++i) {
+      clamped[i] = clampBand(clamped[i], band);
+    }
+
+    size_t badSample = 0;
+    for (int k=0; k<2000; ++k) {
+      vec3f p = dense.origin();
+      for (int a=0; a<3; ++a) {
+        p[a] += mt_genrand_real1() * dims[d][a] * dense.cellSize();
+      }
+      if (!close(fromDense.sample(p), clamped.sample(p))) { ++badSample; }
+    }
+
+    check(badSample == 0, "SparseDtGrid::sample:", what);
+
+  }
+
+}
+
+// the largest difference between a quantized grid and the clamped
+// dense distances, over every cell
+template <class Sparse>
+static float quantizedError(const DtGridf& dense, float band) {
+  Sparse q;
+  q.build(dense, band);
+  float err = 0;
+  for (size_t i=0; i<dense.size(); ++i) {
+    float ref = clampBand(dense[i], band);
+    err = std::max(err, float(fabs(q(dense.ind2sub(i)) - ref)));
+  }
+  return err - q.quantizationError();
+}
+
+// user-037: quantized storage stays within half a step
+static void testQuantized() {
+
+  const float band = 0.35;
+
+  DtGridf dense;
+  sparseScene(37, 30, 26, 13, dense);
+  dense.computeDistsFromBinary();
+
+  // allow for float rounding of the step itself
+  const float tol = 1e-6;
+
+  check(quantizedError<SparseDtGrid16f>(dense, band) <= tol,
+        "16-bit SparseDtGrid exceeds its quantization error");
+  check(quantizedError<SparseDtGrid8f>(dense, band) <= tol,
+        "8-bit SparseDtGrid exceeds its quantization error");
+
+}
+
+static vec3f randomPoint(const DtGridf& grid) {
+  vec3f p = grid.origin();
+  for (int a=0; a<3; ++a) {
+    p[a] += mt_genrand_real1() * grid.dims()[a] * grid.cellSize();
+  }
+  return p;
+}
+
+// every query gives the same bits on a and b
+static bool sameQueries(const DtGridf& a, const DtGridf& b) {
+
+  const size_t n = 500;
+  std::vector<vec3f> pts(n);
+  for (size_t i=0; i<n; ++i) { pts[i] = randomPoint(a); }
+
+  std::vector<float> va(n), vb(n);
+  std::vector<vec3f> ga(n), gb(n);
+
+  a.sampleBatch(&pts[0], n, &va[0], &ga[0]);
+  b.sampleBatch(&pts[0], n, &vb[0], &gb[0]);
+
+  if (memcmp(&va[0], &vb[0], n*sizeof(float)) ||
+      memcmp(&ga[0], &gb[0], n*sizeof(vec3f))) { return false; }
+
+  for (size_t i=0; i+1<n; ++i) {
+
+    vec3f g1, g2;
+    float v1 = a.sample(pts[i], g1);
+    float v2 = b.sample(pts[i], g2);
+    if (memcmp(&v1, &v2, sizeof(float)) || 
+        memcmp(&g1, &g2, sizeof(vec3f))) { return false; }
+
+    vec3f m1, m2;
+    v1 = a.lineMin(pts[i], pts[i+1], m1, g1);
+    v2 = b.lineMin(pts[i], pts[i+1], m2, g2);
+    if (memcmp(&v1, &v2, sizeof(float)) || 
+        memcmp(&m1, &m2, sizeof(vec3f)) ||
+        memcmp(&g1, &g2, sizeof(vec3f))) { return false; }
+
+  }
+
+  return true;
+
+}
+
+static bool sameGrids(const DtGridf& a, const DtGridf& b) {
+  return sameValues(a, b) && sameGradients(a, b) && sameQueries(a, b);
+}
+
+static const char* layoutName(DtGridf::Layout layout) {
+  switch (layout) {
+  case DtGridf::LAYOUT_LINEAR: return "linear";
+  case DtGridf::LAYOUT_BRICKED: return "bricked";
+  default: return "morton";
+  }
+}
+
+static const DtGridf::Layout layouts[3] = {
+  DtGridf::LAYOUT_LINEAR, DtGridf::LAYOUT_BRICKED, DtGridf::LAYOUT_MORTON
+};
+
+static const char* tmpFile = "testdtgrid.tmp";
+
+// user-039: every layout gives the same results as the linear one
+static void testLayouts() {
+
+  DtGridf occ;
+  randomGrid(37, 30, 26, 0.01, 21, occ);
+
+  DtGridf linear = occ;
+  linear.computeDistsFromBinary();
+
+  for (int l=1; l<3; ++l) {
+
+    const char* what = layoutName(layouts[l]);
+
+    DtGridf grid = linear;
+    grid.setLayout(layouts[l]);
+    check(grid.layout() == layouts[l] && sameGrids(grid, linear), 
+          "setLayout changed the grid:", what);
+
+    grid = occ;
+    grid.setLayout(layouts[l]);
+    grid.computeDistsFromBinary();
+    check(grid.layout() == layouts[l] && sameGrids(grid, linear),
+          "EDT in layout differs:", what);
+
+    linear.save(tmpFile);
+    DtGridf loaded;
+    loaded.setLayout(layouts[l]);
+    loaded.load(tmpFile);
+    check(loaded.layout() == layouts[l] && sameGrids(loaded, linear),
+          "load into layout differs:", what);
+
+    grid.save(tmpFile);
+    loaded = DtGridf();
+    loaded.load(tmpFile);
+    check(loaded.layout() == DtGridf::LAYOUT_LINEAR && 
+          sameGrids(loaded, linear),
+          "save from layout differs:", what);
+
+  }
+
+  remove(tmpFile);
+
+}
+
+// user-038: sampleBatch gives the same bits as sample() in every
+// layout, with and without gradients
+static void testSampleBatch() {
+
+  DtGridf linear;
+  randomGrid(29, 34, 23, 0.01, 23, linear);
+  linear.computeDistsFromBinary();
+
+  // an odd count so the last block is partial, with some points
+  // pushed outside the grid to hit the clamped corners
+  const size_t n = 517;
+  const float c = linear.cellSize();
+  std::vector<vec3f> pts(n);
+  for (size_t i=0; i<n; ++i) { 
+    pts[i] = randomPoint(linear); 
+    if (i % 7 == 0) { pts[i] -= vec3f(2.5*c, 0.5*c, 1.5*c); }
+    if (i % 11 == 0) { pts[i] += vec3f(0.5*c, 2.5*c, 1.5*c); }
+  }
+
+  for (int l=0; l<3; ++l) {
+
+    const char* what = layoutName(layouts[l]);
+
+    DtGridf grid = linear;
+    grid.setLayout(layouts[l]);
+
+    std::vector<float> vg(n), vn(n), vs(n);
+    std::vector<vec3f> gb(n), gs(n);
+
+    grid.sampleBatch(&pts[0], n, &vg[0], &gb[0]);
+    grid.sampleBatch(&pts[0], n, &vn[0], 0);
+
+    for (size_t i=0; i<n; ++i) {
+      vs[i] = grid.sample(pts[i], gs[i]);
+    }
+
+    check(!memcmp(&vg[0], &vs[0], n*sizeof(float)) &&
+          !memcmp(&gb[0], &gs[0], n*sizeof(vec3f)),
+          "sampleBatch with gradients differs from sample:", what);
+
+    for (size_t i=0; i<n; ++i) { vs[i] = grid.sample(pts[i]); }
+
+    check(!memcmp(&vn[0], &vs[0], n*sizeof(float)),
+          "sampleBatch without gradients differs from sample:", what);
+
+  }
+
+}
+
+// user-042: each coarse cell is a lower bound on the fine cells it
+// covers, and levels are picked by cell size
+static void testPyramid() {
+
+  DtGridf occ;
+  randomGrid(37, 30, 26, 0.01, 31, occ);
+
+  for (int l=0; l<3; ++l) {
+
+    const char* what = layoutName(layouts[l]);
+
+    DtGridf grid = occ;
+    grid.setLayout(layouts[l]);
+    grid.computeDistsFromBinary();
+
+    DtGridPyramidf pyramid;
+    pyramid.build(grid, 5);
+
+    check(pyramid.numLevels() == 5 && &pyramid.level(0) == &grid,
+          "pyramid has the wrong levels:", what);
+
+    for (size_t i=1; i<pyramid.numLevels(); ++i) {
+
+      const DtGridf& fine = pyramid.level(i-1);
+      const DtGridf& coarse = pyramid.level(i);
+      const vec3u& fdims = fine.dims();
+      const vec3u& cdims = coarse.dims();
+
+      bool ok = (coarse.layout() == grid.layout() &&
+                 coarse.cellSize() == 2*fine.cellSize());
+
+      for (int a=0; a<3; ++a) { 
+        ok = ok && cdims[a] == (fdims[a] + 1) / 2; 
+      }
+
+      for (size_t z=0; ok && z<fdims[2]; ++z) {
+        for (size_t y=0; y<fdims[1]; ++y) {
+          for (size_t x=0; x<fdims[0]; ++x) {
+            if (coarse(x/2, y/2, z/2) > fine(x, y, z)) { ok = false; }
+          }
+        }
+      }
+
+      check(ok, "coarse cell exceeds a fine cell:", what);
+
+    }
+
+  }
+
+  DtGridf grid = occ;
+  grid.computeDistsFromBinary();
+
+  DtGridPyramidf pyramid;
+  pyramid.build(grid, 4);
+
+  const float c = grid.cellSize();
+  check(pyramid.levelForSpacing(0) == 0 &&
+        pyramid.levelForSpacing(1.5*c) == 0 &&
+        pyramid.levelForSpacing(2*c) == 1 &&
+        pyramid.levelForSpacing(3*c) == 1 &&
+        pyramid.levelForSpacing(4*c) == 2 &&
+        pyramid.levelForSpacing(8*c) == 3 &&
+        pyramid.levelForSpacing(100*c) == 3,
+        "levelForSpacing picked the wrong level");
+
+  // building stops once a level is a single cell
+  DtGridf tiny;
+  randomGrid(3, 3, 3, 0.1, 37, tiny);
+  tiny.computeDistsFromBinary();
+  pyramid.build(tiny, 10);
+  check(pyramid.numLevels() == 3 && pyramid.level(2).dims().prod() == 1 &&
+        pyramid.levelForSpacing(100*c) == 2,
+        "pyramid of a tiny grid has the wrong levels");
+
+  pyramid.clear();
+  check(pyramid.numLevels() == 0 && pyramid.levelForSpacing(c) == 0,
+        "cleared pyramid is not empty");
+
+}
+
+// user-040: binary files round trip in every layout
+// byte offsets of header fields in the binary format
+enum { axOffset = 24, dimsOffset = 40, dataCountOffset = 136 };
+
+static const uint32_t* gridAx(const DtGridf& grid) {
+  static uint32_t ax[3];
+  int r = grid.referenceAxis();
+  ax[0] = (r + 1) % 3;
+  ax[1] = (r + 2) % 3;
+  ax[2] = r;
+  return ax;
+}
+
+// saves grid, overwrites size bytes of the file at offset, and
+// tries to load it back
+static bool loadCorrupt(const DtGridf& grid, long offset, 
+                        const void* bytes, size_t size) {
+  if (!grid.saveBinary(tmpFile)) { return false; }
+  FILE* fp = fopen(tmpFile, "r+b");
+  if (!fp) { return false; }
+  fseek(fp, offset, SEEK_SET);
+  fwrite(bytes, 1, size, fp);
+  fclose(fp);
+  DtGridf loaded;
+  return loaded.loadBinary(tmpFile);
+}
+
+static void testBinary() {
+
+  DtGridf linear;
+  randomGrid(29, 23, 17, 0.01, 23, linear);
+  linear.computeDistsFromBinary();
+
+  for (int l=0; l<3; ++l) {
+
+    const char* what = layoutName(layouts[l]);
+
+    DtGridf grid = linear;
+    grid.setLayout(layouts[l]);
+
+    check(grid.saveBinary(tmpFile), "saveBinary failed:", what);
+
+    DtGridf loaded;
+    check(loaded.loadBinary(tmpFile) && loaded.layout() == layouts[l] &&
+          sameGrids(loaded, linear),
+          "loadBinary differs:", what);
+
+    // load() tells the formats apart
+    DtGridf viaLoad;
+    check(viaLoad.load(tmpFile) && sameGrids(viaLoad, linear),
+          "load of a binary file differs:", what);
+
+    // writing to a mapped grid must not change the file
+    loaded[0] = 42;
+    DtGridf again;
+    check(again.loadBinary(tmpFile) && sameGrids(again, linear),
+          "writing to a mapped grid changed the file:", what);
+
+    // without stored gradients, they are computed on load
+    DtGridf noGrad = grid;
+    noGrad.computeDistsFromBinary(false);
+    check(noGrad.saveBinary(tmpFile), "saveBinary failed:", what);
+    check(loaded.loadBinary(tmpFile) && sameGrids(loaded, linear),
+          "loadBinary without gradients differs:", what);
+
+  }
+
+  // a truncated file is rejected
+  FILE* fp = fopen(tmpFile, "wb");
+  if (fp) {
+    fwrite("MZDTGRID", 1, 8, fp);
+    fclose(fp);
+  }
+  DtGridf bad;
+  check(!bad.loadBinary(tmpFile), "loadBinary accepted a bad file");
+
+  // so are corrupt header fields, before anything is allocated; a
+  // cube makes swapped axes agree with the height map dims
+  DtGridf cube;
+  randomGrid(16, 16, 16, 0.01, 29, cube);
+  cube.computeDistsFromBinary();
+
+  const uint32_t badAx[3] = { 7, 1, 2 };
+  const uint32_t swappedAx[3] = { 1, 0, 2 };
+  const uint64_t hugeDims[3] = { 1 << 20, 1 << 20, 1 << 10 };
+  const uint64_t zeroDims[3] = { 16, 16, 0 };
+  const uint64_t hugeCount = uint64_t(1) << 62;
+
+  check(!loadCorrupt(cube, axOffset, badAx, sizeof(badAx)),
+        "loadBinary accepted an axis out of range");
+  check(!loadCorrupt(cube, axOffset, swappedAx, sizeof(swappedAx)),
+        "loadBinary accepted swapped axes");
+  check(!loadCorrupt(cube, dimsOffset, hugeDims, sizeof(hugeDims)),
+        "loadBinary accepted huge dims");
+  check(!loadCorrupt(cube, dimsOffset, zeroDims, sizeof(zeroDims)),
+        "loadBinary accepted an empty dim");
+  check(!loadCorrupt(cube, dataCountOffset, &hugeCount, sizeof(hugeCount)),
+        "loadBinary accepted a huge data count");
+
+  // rewriting the true values loads, so the offsets above are right
+  const uint64_t dims[3] = { 16, 16, 16 };
+  const uint64_t count = cube.dims().prod();
+  check(loadCorrupt(cube, axOffset, gridAx(cube), 3*sizeof(uint32_t)) &&
+        loadCorrupt(cube, dimsOffset, dims, sizeof(dims)) &&
+        loadCorrupt(cube, dataCountOffset, &count, sizeof(count)),
+        "loadBinary rejected an unchanged header");
+
+  remove(tmpFile);
+
+}
+
+// an axis aligned box with outward facing triangles
+static void boxMesh(const vec3f& lo, const vec3f& hi, TriMesh3f& mesh) {
+  for (int i=0; i<8; ++i) {
+    mesh.addVertex((i & 1) ? hi[0] : lo[0],
+                   (i & 2) ? hi[1] : lo[1],
+                   (i & 4) ? hi[2] : lo[2]);
+  }
+  static const size_t tris[12][3] = {
+    { 0, 4, 6 }, { 0, 6, 2 }, { 1, 3, 7 }, { 1, 7, 5 },
+    { 0, 1, 5 }, { 0, 5, 4 }, { 2, 6, 7 }, { 2, 7, 3 },
+    { 0, 2, 3 }, { 0, 3, 1 }, { 4, 5, 7 }, { 4, 7, 6 },
+  };
+  for (int t=0; t<12; ++t) {
+    mesh.addTriangle(tris[t][0], tris[t][1], tris[t][2]);
+  }
+}
+
+static double boxDist(const vec3f& lo, const vec3f& hi, const vec3f& p) {
+  double out2 = 0, in = HUGE_VAL;
+  for (int k=0; k<3; ++k) {
+    double d = std::max(double(lo[k]) - p[k], double(p[k]) - hi[k]);
+    if (d > 0) { out2 += d*d; }
+    in = std::min(in, -d);
+  }
+  return out2 > 0 ? sqrt(out2) : -in;
+}
+
+static double segmentDist(const vec3d& p, const vec3d& a, const vec3d& b) {
+  vec3d ab = b-a;
+  double t = vec3d::dot(p-a, ab) / ab.norm2();
+  t = std::max(0.0, std::min(1.0, t));
+  return (a + ab*t - p).norm();
+}
+
+// the distance from p to triangle abc: to its plane if p projects
+// inside it, otherwise to the nearest edge.
+static double triangleDist(const vec3d& p, const vec3d& a,
+                           const vec3d& b, const vec3d& c) {
+  vec3d n = vec3d::cross(b-a, c-a);
+  double h = vec3d::dot(p-a, n) / n.norm();
+  vec3d q = p - n*(vec3d::dot(p-a, n) / n.norm2());
+  if (vec3d::dot(vec3d::cross(b-a, q-a), n) >= 0 &&
+      vec3d::dot(vec3d::cross(c-b, q-b), n) >= 0 &&
+      vec3d::dot(vec3d::cross(a-c, q-c), n) >= 0) {
+    return fabs(h);
+  }
+  return std::min(segmentDist(p, a, b),
+                  std::min(segmentDist(p, b, c), segmentDist(p, c, a)));
+}
+
+// user-041: distances to a mesh and the triangle BVH
+static void testMesh() {
+
+  vec3f lo(0.73f, 0.61f, 0.52f), hi(2.27f, 2.14f, 1.66f);
+  TriMesh3f box;
+  boxMesh(lo, hi, box);
+
+  DtGridf grid;
+  grid.resize(30, 28, 24, DtGridf::AXIS_Z, 0.1, vec3f(0,0,0));
+
+  const float band = 0.35f;
+  grid.computeDistsFromMesh(box, band);
+
+  bool exact = true, signs = true;
+  for (size_t i=0; i<grid.size(); ++i) {
+    double d = boxDist(lo, hi, grid.cellCenter(grid.ind2sub(i)));
+    if (fabs(d) <= band && fabs(grid[i] - d) > 1e-6 * (1 + fabs(d))) {
+      exact = false;
+    }
+    if ((d < 0) != (grid[i] < 0)) { signs = false; }
+  }
+  check(exact, "computeDistsFromMesh differs from the box inside the band");
+  check(signs, "computeDistsFromMesh has the wrong sign");
+
+  // a less regular mesh: the box with its vertices jittered
+  mt_init_genrand(41);
+  TriMesh3f mesh = box;
+  for (size_t v=0; v<mesh.verts.size(); ++v) {
+    for (int k=0; k<3; ++k) {
+      mesh.verts[v][k] += 0.2f * float(mt_genrand_real1() - 0.5);
+    }
+  }
+  mesh.addMesh(box);
+
+  TriMeshBVHf bvh(mesh);
+
+  bool same = true, far = true;
+  for (int n=0; n<2000; ++n) {
+
+    vec3f p = randomPoint(grid);
+
+    double best = HUGE_VAL;
+    for (size_t f=0; f<mesh.faces.size(); ++f) {
+      const size_t* v = mesh.faces[f].vidx;
+      best = std::min(best, triangleDist(vec3d(p), vec3d(mesh.verts[v[0]]),
+                                         vec3d(mesh.verts[v[1]]),
+                                         vec3d(mesh.verts[v[2]])));
+    }
+
+    vec3f closest;
+    size_t face = mesh.faces.size();
+    float d = bvh.closestPoint(p, 10, closest, face);
+    if (face >= mesh.faces.size() || !close(d, best) ||
+        !close((closest - p).norm(), best)) {
+      same = false;
+    }
+
+    // beyond maxDist nothing is found
+    size_t none = mesh.faces.size();
+    if (bvh.closestPoint(p, 0.5f*d, closest, none) != 0.5f*d ||
+        none != mesh.faces.size()) {
+      far = false;
+    }
+
+  }
+  check(same, "TriMeshBVH closestPoint differs from brute force");
+  check(far, "TriMeshBVH closestPoint found a point beyond maxDist");
+
+}
+
+int main(int argc, char** argv) {
+
+  testEDT();
+  testSignedEDT();
+  testDynamic();
+  testSparse();
+  testQuantized();
+  testLayouts();
+  testSampleBatch();
+  testPyramid();
+  testBinary();
+  testMesh();
+
+  if (failures) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+
+  printf("all checks passed\n");
+  return 0;
+
+}
@@ -19,6 +19,8 @@ find_library(PNG_LIBRARY png)
 find_library(EXPAT_LIBRARY expat)
 find_library(GLUT_LIBRARY glut)
 
+find_package(Threads)
+
 #use this to find the FindNLopt.cmake file.
 set( CMAKE_MODULE_PATH ${CMAKE_MODULE_PATH} "${CMAKE_CURRENT_LIST_DIR}")
 find_package(NLopt)
@@ -28,11 +30,39 @@ endif()
 
 pkg_search_module(EIGEN3 REQUIRED eigen3>=3)
 pkg_search_module(CAIRO cairo)
+pkg_search_module(CCD ccd)
 
 if (CAIRO_FOUND)
 add_definitions(-DMZ_HAVE_CAIRO)
 endif ()
 
+# the wrappers need the GJK distance and separation queries, which
+# not every libccd has, so make sure they compile and link first.
+if (CCD_FOUND)
+include(CheckCXXSourceCompiles)
+set(CMAKE_REQUIRED_INCLUDES ${CCD_INCLUDE_DIRS})
+set(CMAKE_REQUIRED_LIBRARIES ${CCD_LDFLAGS})
+check_cxx_source_compiles("
+#include <ccd/ccd.h>
+int main() {
+  ccd_t ccd;
+  CCD_INIT(&ccd);
+  ccd_vec3_t sep;
+  return int(ccdGJKDist(0, 0, &ccd) + ccd.dist_tolerance) +
+         ccdGJKSeparate(0, 0, &ccd, &sep);
+}" CCD_HAS_GJK_DIST)
+unset(CMAKE_REQUIRED_INCLUDES)
+unset(CMAKE_REQUIRED_LIBRARIES)
+if (NOT CCD_HAS_GJK_DIST)
+message(STATUS "libccd lacks ccdGJKDist/ccdGJKSeparate, not building the CCD wrappers")
+set(CCD_FOUND FALSE)
+endif ()
+endif ()
+
+if (CCD_FOUND)
+include_directories(${CCD_INCLUDE_DIRS})
+endif ()
+
 include_directories(${EIGEN3_INCLUDE_DIRS})
 
 if (CMAKE_BUILD_TYPE STREQUAL "Debug")
@@ -41,8 +71,6 @@ else()
     add_definitions( -DRELEASE )
 endif()
 
-add_definitions( -DDO_TIMING )
-
 set(CMAKE_C_FLAGS "-Wall -g -fPIC")
 set(CMAKE_CXX_FLAGS "-Wall -g -fPIC")
 